@@ -1,8 +1,24 @@
 #include "calculate_distances_agent.hpp"
+#include <algorithm>
 #include <cmath>
+#include <limits>
+#include <memory>
+#include <unordered_map>
 #include <string>
 #include <vector>
 
+#include "utils/action_parameters.hpp"
+#include "utils/action_progress.hpp"
+#include "utils/agent_metrics.hpp"
+#include "utils/distance_kernel.hpp"
+#include "utils/distance_matrix.hpp"
+#include "utils/distance_writer.hpp"
+#include "utils/incremental_state.hpp"
+#include "utils/numeric_link.hpp"
+#include "utils/result_links.hpp"
+#include "utils/road_network.hpp"
+#include "utils/village_scope.hpp"
+
 using namespace ambulance_module;
 
 ScAddr CalculateDistancesAgent::GetActionClass() const
@@ -12,66 +28,250 @@ ScAddr CalculateDistancesAgent::GetActionClass() const
 
 ScResult CalculateDistancesAgent::DoProgram(ScAction & action)
 {
-  struct Node { ScAddr addr; double x; double y; };
-  std::vector<Node> nodes;
-  
-  //ищем деревни
-  ScIterator3Ptr it3 = m_context.CreateIterator3(
-      AmbulanceKeynodes::concept_village, ScType::ConstPermPosArc, ScType::Unknown);//класс деревень, дуга принадлежности, неизвестная деревня
-  
-  while(it3->Next()) {
-      ScAddr village = it3->Get(2);//получаем адрес деревни
-      
-      auto GetValue = [&](ScAddr const & rel) -> double {
-        ScIterator5Ptr const it5 = m_context.CreateIterator5(
-            village,//деревня
-            ScType::ConstCommonArc,//дуга общего вида
-            ScType::NodeLink,//ссылка где чило
-            ScType::ConstPermPosArc,//принадлежности
-            rel);//отношение(nrel_coordinate_x или nrel_coordinate_y)
-
-        if (it5->Next()) {
-            ScAddr const linkAddr = it5->Get(2);//получаем адрес где число
-            std::string content_str;
-            m_context.GetLinkContent(linkAddr, content_str);//копируем значение в строку
-            try { return std::stod(content_str); } catch (...) { return 0.0; }
-        } //stod это текст в число
-        return -1.0;
-      };
-
-      double valX = GetValue(AmbulanceKeynodes::nrel_coordinate_x);
-      double valY = GetValue(AmbulanceKeynodes::nrel_coordinate_y);
-      //если найдены, то добавляем в вектор
-      if (valX != -1.0 && valY != -1.0)
-          nodes.push_back({village, valX, valY});
+  //rrel_villages или прямоугольник сужают действие до части деревень
+  ActionParameters const parameters(m_context, action);
+  VillageScope scope;
+  ActionProgress progress(m_context, action);
+  std::string error;
+  if (!scope.Read(m_context, parameters, error) || !progress.Read(parameters, error))
+  {
+    m_logger.Error(error);
+    return action.FinishWithError();
   }
 
-  if (nodes.empty()) {
+  AgentMetrics metrics(m_context, GetActionClass());
+  metrics.Start(AgentPhase::Load);
+
+  //снимок деревень из кэша модуля или только деревни области действия
+  VillageLoadReport report;
+  std::shared_ptr<VillageSnapshot const> const snapshot = scope.Acquire(m_context, report);
+  VillageSnapshot const & nodes = *snapshot;
+  if (report.Skipped() > 0)
+      m_logger.Warning("Skipped villages with incomplete or malformed data. " + report.ToString());
+
+  if (nodes.Empty()) {
       m_logger.Error("No villages found.");
       return action.FinishWithError();
   }
+  metrics.Add(AgentCounter::VillagesLoaded, nodes.Size());
+
+  KernelPrecision const precision = parameters.HasMode(AmbulanceKeynodes::mode_single_precision)
+                                        ? KernelPrecision::Fast
+                                        : KernelPrecision::Exact;
+  std::vector<double> row(nodes.Size());
+
+  //mode_road_metric - время по дорогам вместо расстояния по прямой
+  std::shared_ptr<RoadMetric const> const roads =
+      parameters.HasMode(AmbulanceKeynodes::mode_road_metric) ? RoadMetric::Acquire(m_context, nodes) : nullptr;
+
+  //расстояния от i до всех j > i; запись дуг чередуется со строками, время этапов копится
+  auto const FillRow = [&](size_t i, size_t rest) {
+      metrics.Start(AgentPhase::Compute);
+      if (roads != nullptr) {
+          for (size_t k = 0; k < rest; ++k)
+              row[k] = roads->At(i, i + 1 + k);
+          return;
+      }
+      DistanceKernel::Row(&nodes.x[i + 1], &nodes.y[i + 1], rest, nodes.x[i], nodes.y[i], row.data(), precision);
+  };
+
+  if (parameters.HasMode(AmbulanceKeynodes::mode_distance_matrix))
+  {
+      //вся матрица в одной ссылке вместо дуг на каждую пару
+      DistanceMatrix matrix(
+          nodes.addrs, precision == KernelPrecision::Fast ? MatrixPrecision::Float : MatrixPrecision::Double);
+      progress.Begin(DistanceMatrix::PairCount(nodes.Size()));
+      size_t pairsDone = 0;
+      size_t filledRows = 0;
+      for (size_t i = 0; i < nodes.Size(); ++i) {
+          size_t const rest = nodes.Size() - i - 1;
+          FillRow(i, rest);
+          for (size_t k = 0; k < rest; ++k)
+              matrix.Set(i, i + 1 + k, row[k]);
+          pairsDone += rest;
+          filledRows = i + 1;
+          if (filledRows < nodes.Size() && !progress.Proceed(pairsDone))
+              break;
+      }
+      if (progress.IsCancelled()) {
+          m_logger.Info("Distance calculation cancelled. Pairs: " + std::to_string(pairsDone));
+          return action.FinishUnsuccessfully();
+      }
+      //по бюджету: непосчитанные пары - бесконечность, как недостижимые
+      for (size_t i = filledRows; i < nodes.Size(); ++i)
+          for (size_t j = i + 1; j < nodes.Size(); ++j)
+              matrix.Set(i, j, std::numeric_limits<double>::infinity());
+
+      metrics.Start(AgentPhase::Write);
+      ScAddr const link = matrix.GenerateLink(m_context);
+      ScAddr const arc = m_context.GenerateConnector(ScType::ConstCommonArc, action, link);//действие => матрица
+      ScAddr const relArc = m_context.GenerateConnector(
+          ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_distance_matrix, arc);
+
+      ScStructure resultStruct = m_context.GenerateStructure();
+      resultStruct << link << arc << relArc << AmbulanceKeynodes::nrel_distance_matrix;
+      metrics.Add(AgentCounter::PairsEvaluated, pairsDone);
+      metrics.Add(AgentCounter::ElementsWritten, 3 + progress.Finish(resultStruct));
+      metrics.AttachIfRequested(parameters, action, resultStruct);
+      action.SetResult(resultStruct);
+
+      if (progress.IsOutOfTime())
+          m_logger.Warning("Time budget exhausted, distance matrix is incomplete. Pairs: " + std::to_string(pairsDone));
+      m_logger.Info("Distance matrix calculated. Pairs: " + std::to_string(pairsDone));
+      return action.FinishSuccessfully();
+  }
+
+  //mode_upsert - существующие дуги пар обновляются на месте, дубликаты удаляются
+  bool upsert = parameters.HasMode(AmbulanceKeynodes::mode_upsert);
+  //первая запись состояния фиксируется, только если дошла до последней пары
+  bool commitState = false;
+
+  //состояние модуля между действиями: после первой записи переписываются только пары сдвинутых деревень;
+  //при состоянии дуги всегда обновляются на месте - они могли остаться от прошлых запусков
+  std::shared_ptr<IncrementalState> const state = IncrementalState::GetActive();
+  if (state != nullptr)
+  {
+      upsert = true;
+      //значения по дорогам и с одинарной точностью состояние не отслеживает
+      if (roads != nullptr || precision == KernelPrecision::Fast)
+          state->InvalidateDistances();
+      //для части деревень состояние не трогаем
+      else if (!scope.IsRestricted())
+      {
+          bool firstWrite = false;
+          std::vector<size_t> const moved = state->FindMovedSinceDistances(nodes, firstWrite);
+          if (!firstWrite)
+          {
+              metrics.Start(AgentPhase::Write);
+              ScResult const result = WriteMovedDistances(action, nodes, moved, metrics);
+              state->CommitDistances(nodes);
+              return result;
+          }
+          commitState = true;
+      }
+  }
+
+  //дуги пишутся пакетами, а не по одной
+  DistanceWriter writer(m_context);
+  size_t updated = 0;
+  size_t erased = 0;
+  progress.Begin(DistanceMatrix::PairCount(nodes.Size()));
+  size_t pairsDone = 0;
+  for (size_t i = 0; i < nodes.Size(); ++i) {//перебираем все деревни
+      //считаем дистанции до всех деревень, кроме тех что уже прошли
+      size_t const rest = nodes.Size() - i - 1;
+      FillRow(i, rest);
+      metrics.Start(AgentPhase::Write);
+
+      std::unordered_map<ScAddr::HashType, ScAddr> existing;
+      if (upsert)
+          existing = ResultLinks::CollectDistances(m_context, nodes.addrs[i], &erased);
+
+      for (size_t k = 0; k < rest; ++k) {
+          //недостижимые по дорогам пары не записываются
+          if (std::isinf(row[k]))
+              continue;
+
+          auto const it = existing.find(nodes.addrs[i + 1 + k].Hash());
+          if (it != existing.end()) {
+              NumericLink::Write(m_context, it->second, row[k]);
+              ++updated;
+              continue;
+          }
+          writer.Add(nodes.addrs[i], nodes.addrs[i + 1 + k], row[k]);
+      }
+      pairsDone += rest;
+      if (i + 1 < nodes.Size() && !progress.Proceed(pairsDone))
+          break;
+  }
+  //уже посчитанные строки записываются и при отмене - дуги пар верны сами по себе
+  writer.Flush();
+  metrics.Add(AgentCounter::PairsEvaluated, pairsDone);
+  metrics.Add(AgentCounter::ElementsWritten, writer.GetWrittenCount() * DistanceWriter::kElementsPerPair + updated);
+  if (progress.IsCancelled()) {
+      m_logger.Info("Distance calculation cancelled. Pairs: " + std::to_string(pairsDone));
+      return action.FinishUnsuccessfully();
+  }
+  if (commitState && !progress.IsOutOfTime())
+      state->CommitDistances(nodes);
+
+  //дуги пар в результат не входят; с mode_metrics результатом становятся замеры,
+  //а действие, прерванное по бюджету, отмечается приближенным
+  if (progress.IsOutOfTime() || parameters.HasMode(AmbulanceKeynodes::mode_metrics)) {
+      ScStructure resultStruct = m_context.GenerateStructure();
+      metrics.Add(AgentCounter::ElementsWritten, progress.Finish(resultStruct));
+      if (parameters.HasMode(AmbulanceKeynodes::mode_metrics))
+          metrics.Attach(action, resultStruct);
+      action.SetResult(resultStruct);
+  }
+  else
+      progress.Publish();
+  if (progress.IsOutOfTime())
+      m_logger.Warning(
+          "Time budget exhausted, distances are written for part of the pairs. Pairs: " + std::to_string(pairsDone));
 
-  for (size_t i = 0; i < nodes.size(); ++i) {//перебираем все деревни
-      for (size_t j = i + 1; j < nodes.size(); ++j) {//перебираем все деревни, кроме тех что уже прошли
-          double dist = std::hypot(nodes[i].x - nodes[j].x, nodes[i].y - nodes[j].y); //считаем дистанцию
-          
-          ScAddr link = m_context.GenerateLink(ScType::NodeLink);//создаем место хранения дистанции
-          m_context.SetLinkContent(link, std::to_string(dist));//записываем дистанцию
-          
-          //создаем ребро графа
-          ScAddr commonArc = m_context.GenerateConnector(
-              ScType::ConstCommonArc, nodes[i].addr, nodes[j].addr);
-              //дорога,деревня,деревня
-          
-          m_context.GenerateConnector(
-              ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_distance, commonArc);//помечаем дорогу как дистанция
-           
-           //привязываем число к ребру дистанции
-          m_context.GenerateConnector(
-               ScType::ConstPermPosArc, link, commonArc); 
+  if (upsert)
+      m_logger.Info(
+          "Distances upserted. Updated: " + std::to_string(updated) + ", new: "
+          + std::to_string(writer.GetWrittenCount()) + ", duplicates removed: " + std::to_string(erased));
+  else
+      m_logger.Info("Distances calculated. Pairs: " + std::to_string(writer.GetWrittenCount()));
+  return action.FinishSuccessfully();
+}
+
+ScResult CalculateDistancesAgent::WriteMovedDistances(
+    ScAction & action,
+    VillageSnapshot const & nodes,
+    std::vector<size_t> const & moved,
+    AgentMetrics & metrics)
+{
+  std::unordered_map<ScAddr::HashType, size_t> index;
+  index.reserve(nodes.Size());
+  for (size_t i = 0; i < nodes.Size(); ++i)
+      index.emplace(nodes.addrs[i].Hash(), i);
+
+  std::vector<char> isMoved(nodes.Size(), 0);
+  for (size_t const i : moved)
+      isMoved[i] = 1;
+
+  std::vector<double> row(nodes.Size());
+  std::vector<char> hasArc(nodes.Size(), 0);
+  size_t rewritten = 0;
+  DistanceWriter writer(m_context);
+  //moved упорядочен по возрастанию: пару двух сдвинутых деревень обрабатывает меньший индекс
+  for (size_t const v : moved) {
+      DistanceKernel::Row(nodes.x.data(), nodes.y.data(), nodes.Size(), nodes.x[v], nodes.y[v], row.data());
+      std::fill(hasArc.begin(), hasArc.end(), 0);
+
+      //существующие дуги расстояний деревни в обе стороны: переписываем значение в ссылке
+      for (auto const & [partnerHash, link] : ResultLinks::CollectDistances(m_context, nodes.addrs[v])) {
+          auto const partner = index.find(partnerHash);
+          if (partner == index.end())
+              continue;//деревни уже нет в снимке
+          size_t const u = partner->second;
+          hasArc[u] = 1;
+          if (!(isMoved[u] && u < v) && NumericLink::Write(m_context, link, row[u]))
+              ++rewritten;
       }
+
+      //пары без дуги (новая деревня) создаются как обычно
+      for (size_t u = 0; u < nodes.Size(); ++u) {
+          if (u != v && !hasArc[u] && !(isMoved[u] && u < v))
+              writer.Add(nodes.addrs[v], nodes.addrs[u], row[u]);
+      }
+  }
+  writer.Flush();
+  metrics.Add(AgentCounter::PairsEvaluated, moved.size() * nodes.Size());
+  metrics.Add(AgentCounter::ElementsWritten, writer.GetWrittenCount() * DistanceWriter::kElementsPerPair + rewritten);
+
+  if (ActionParameters(m_context, action).HasMode(AmbulanceKeynodes::mode_metrics)) {
+      ScStructure resultStruct = m_context.GenerateStructure();
+      metrics.Attach(action, resultStruct);
+      action.SetResult(resultStruct);
   }
 
-  m_logger.Info("Distances calculated.");
+  m_logger.Info(
+      "Distances updated. Moved villages: " + std::to_string(moved.size()) + ", rewritten: " + std::to_string(rewritten)
+      + ", new pairs: " + std::to_string(writer.GetWrittenCount()));
   return action.FinishSuccessfully();
 }
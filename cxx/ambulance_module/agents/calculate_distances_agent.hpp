@@ -1,8 +1,12 @@
 #pragma once
 
+#include <vector>
+
 #include <sc-memory/sc_agent.hpp>
 
 #include "keynodes/ambulance_keynodes.hpp"
+#include "utils/agent_metrics.hpp"
+#include "utils/village_loader.hpp"
 
 namespace ambulance_module
 {
@@ -13,6 +17,14 @@ public:
   ScAddr GetActionClass() const override;
 
   ScResult DoProgram(ScAction & action) override;
+
+private:
+  //переписывает только пары с участием сдвинутых деревень
+  ScResult WriteMovedDistances(
+      ScAction & action,
+      VillageSnapshot const & nodes,
+      std::vector<size_t> const & moved,
+      AgentMetrics & metrics);
 };
 
 } 
@@ -1,12 +1,36 @@
 #include "find_center_agent.hpp"
+#include <algorithm>
 #include <cmath>
 #include <limits>
-#include <vector>
+#include <memory>
+#include <numeric>
 #include <string>
-#include <algorithm>
+#include <vector>
+
+#include "utils/action_parameters.hpp"
+#include "utils/action_progress.hpp"
+#include "utils/agent_metrics.hpp"
+#include "utils/candidate_ranking.hpp"
+#include "utils/candidate_search.hpp"
+#include "utils/convex_hull.hpp"
+#include "utils/distance_kernel.hpp"
+#include "utils/grid_coreset.hpp"
+#include "utils/incremental_state.hpp"
+#include "utils/numeric_link.hpp"
+#include "utils/result_links.hpp"
+#include "utils/road_network.hpp"
+#include "utils/village_scope.hpp"
 
 using namespace ambulance_module;
 
+namespace
+{
+
+//с этого размера поиск по выпуклой оболочке включается без mode_convex_hull
+size_t const kHullSearchThreshold = 2048;
+
+}
+
 ScAddr FindCenterAgent::GetActionClass() const
 {
   return AmbulanceKeynodes::action_find_graph_center;
@@ -15,86 +39,239 @@ ScAddr FindCenterAgent::GetActionClass() const
 ScResult FindCenterAgent::DoProgram(ScAction & action)
 {
   ScAddr const actionNode = action;
-  
-  struct VillageData { ScAddr addr; double x; double y; };
-  std::vector<VillageData> villages;
-  
-    //ищем деревни
-  ScIterator3Ptr it3 = m_context.CreateIterator3(
-      AmbulanceKeynodes::concept_village, ScType::ConstPermPosArc, ScType::Unknown);//класс деревень, дуга принадлежности, неизвестная деревня
-  
-  while(it3->Next()) {
-      ScAddr village = it3->Get(2);//получаем адрес деревни
-      
-      auto GetValue = [&](ScAddr const & rel) -> double {
-        ScIterator5Ptr const it5 = m_context.CreateIterator5(
-            village,//деревня
-            ScType::ConstCommonArc,//дуга общего вида
-            ScType::NodeLink,//ссылка где чило
-            ScType::ConstPermPosArc,//принадлежности
-            rel);//отношение(nrel_coordinate_x или nrel_coordinate_y)
-
-        if (it5->Next()) {
-            ScAddr const linkAddr = it5->Get(2);//получаем адрес где число
-            std::string content_str;
-            m_context.GetLinkContent(linkAddr, content_str);//копируем значение в строку
-            try { return std::stod(content_str); } catch (...) { return 0.0; }
-        } //stod это текст в число
-        return -1.0;
-      };
-
-      double valX = GetValue(AmbulanceKeynodes::nrel_coordinate_x);
-      double valY = GetValue(AmbulanceKeynodes::nrel_coordinate_y);
-            //если найдены, то добавляем в вектор
-      if (valX != -1.0 && valY != -1.0)
-          villages.push_back({village, valX, valY});
+  //rrel_villages или прямоугольник сужают действие до части деревень
+  ActionParameters const parameters(m_context, action);
+  VillageScope scope;
+  std::string error;
+  //rrel_top_k - кроме центра записать k лучших кандидатов с эксцентриситетами
+  size_t topK = 0;
+  //отмена, бюджет времени и публикация хода
+  ActionProgress progress(m_context, actionNode);
+  //mode_approximate / rrel_accuracy - поиск по ячейкам сетки с оценкой погрешности
+  double accuracy = 0.0;
+  if (!scope.Read(m_context, parameters, error) || !CandidateRanking::ReadCount(parameters, topK, error)
+      || !progress.Read(parameters, error) || !GridCoreset::ReadAccuracy(parameters, accuracy, error))
+  {
+    m_logger.Error(error);
+    return action.FinishWithError();
   }
+
+  AgentMetrics metrics(m_context, GetActionClass());
+  metrics.Start(AgentPhase::Load);
   
-  if (villages.empty()) {
+  //снимок деревень из кэша модуля или только деревни области действия
+  VillageLoadReport report;
+  std::shared_ptr<VillageSnapshot const> const snapshot = scope.Acquire(m_context, report);
+  VillageSnapshot const & villages = *snapshot;
+  if (report.Skipped() > 0)
+      m_logger.Warning("Skipped villages with incomplete or malformed data. " + report.ToString());
+  
+  if (villages.Empty()) {
       m_logger.Error("No villages found.");
       return action.FinishWithError();
   }
+  metrics.Add(AgentCounter::VillagesLoaded, villages.Size());
+
+  KernelPrecision const precision = parameters.HasMode(AmbulanceKeynodes::mode_single_precision)
+                                        ? KernelPrecision::Fast
+                                        : KernelPrecision::Exact;
 
-  double minMaxDist = std::numeric_limits<double>::max(); 
-  ScAddr centerNode;
-  bool centerFound = false;
+  //mode_road_metric - время по дорогам вместо расстояния по прямой
+  std::shared_ptr<RoadMetric const> const roads =
+      parameters.HasMode(AmbulanceKeynodes::mode_road_metric) ? RoadMetric::Acquire(m_context, villages) : nullptr;
+  if (roads != nullptr && !roads->IsConnected())
+      m_logger.Warning("Road graph is disconnected. Some eccentricities are infinite.");
+  //границы по ячейкам верны только для расстояния по прямой
+  bool const approximate = accuracy > 0.0 && roads == nullptr;
+  if (accuracy > 0.0 && roads != nullptr)
+      m_logger.Warning("Approximation needs straight-line distances. Running exact search.");
+  metrics.Start(AgentPhase::Compute);
 
+  //состояние модуля между действиями: пересчитываются только строки изменившихся деревень;
+  //оно ведется по всем деревням, поэтому для части деревень не используется
+  std::shared_ptr<IncrementalState> const state = IncrementalState::GetActive();
+  bool const incremental = state != nullptr && roads == nullptr && precision == KernelPrecision::Exact
+                           && !scope.IsRestricted() && !approximate
+                           && !parameters.HasMode(AmbulanceKeynodes::mode_convex_hull);
+
+  //самая дальняя деревня всегда вершина выпуклой оболочки, поэтому на больших входах
+  //эксцентриситет считается только по вершинам: O(n log n + n*h) вместо O(n^2);
+  //для дорог это неверно, там оболочка не используется
+  double const * targetX = villages.x.data();
+  double const * targetY = villages.y.data();
+  size_t targetCount = villages.Size();
+  std::vector<double> hullX;
+  std::vector<double> hullY;
+  if (roads == nullptr && !incremental
+      && (parameters.HasMode(AmbulanceKeynodes::mode_convex_hull) || villages.Size() >= kHullSearchThreshold))
+  {
+      std::vector<size_t> const hull = ConvexHull::Build(villages.x, villages.y);
+      hullX.reserve(hull.size());
+      hullY.reserve(hull.size());
+      for (size_t const index : hull) {
+          hullX.push_back(villages.x[index]);
+          hullY.push_back(villages.y[index]);
+      }
+      targetX = hullX.data();
+      targetY = hullY.data();
+      targetCount = hull.size();
+      m_logger.Debug("Convex hull search. Hull vertices: " + std::to_string(targetCount));
+  }
+
+  //максимальное расстояние от v1 до всех v2 (до себя 0, на максимум не влияет)
+  auto const Eccentricity = [&](size_t i) {
+      if (roads != nullptr)
+          return roads->RowMax(i);
+      return DistanceKernel::RowMax(targetX, targetY, targetCount, villages.x[i], villages.y[i], precision);
+  };
+
+  std::vector<double> eccentricities;
+  CandidateResult center;
+  std::vector<CandidateResult> ranking;
+  double errorBound = 0.0;
+  if (incremental)
+  {
+      IncrementalView const view = state->Sync(villages);
+      m_logger.Debug("Incremental center search. Recomputed rows: " + std::to_string(view.recomputedRows));
+      eccentricities = view.eccentricities;
+      metrics.Add(AgentCounter::PairsEvaluated, view.recomputedRows * villages.Size());
+      center = {view.center, eccentricities[view.center], villages.addrs[view.center].Hash()};
+      if (topK > 0)
+          ranking = CandidateSearch::RankScores(villages.addrs, eccentricities, topK);
+  }
+  else if (approximate)
+  {
+      //точно оцениваются только деревни ячеек, чья нижняя граница в пределах допуска от лучшего;
+      //эксцентриситеты остальных не записываются
+      GridCoreset const coreset(villages.x.data(), villages.y.data(), nullptr, villages.Size(), accuracy);
+      eccentricities.assign(villages.Size(), std::numeric_limits<double>::quiet_NaN());
+      CoresetSearchResult const search = coreset.Search(
+          *ThreadPool::GetShared(),
+          villages.addrs,
+          PlacementObjective::Center,
+          [&](size_t i)
+          {
+            eccentricities[i] = Eccentricity(i);
+            return eccentricities[i];
+          },
+          std::max<size_t>(topK, 1));
+      ranking = search.ranking;
+      errorBound = search.errorBound;
+      if (!ranking.empty())
+          center = ranking.front();
+      m_logger.Debug(
+          "Approximate center search. Cells: " + std::to_string(coreset.GetCellCount()) + ", evaluated: "
+          + std::to_string(search.evaluated) + " of " + std::to_string(villages.Size()));
+      metrics.Add(
+          AgentCounter::PairsEvaluated,
+          coreset.GetCellCount() * coreset.GetCellCount() + search.evaluated * targetCount);
+  }
+  else
+  {
+      //эксцентриситеты считаются параллельно блоками, ищем минимум среди максимумов;
+      //k лучших копятся в ограниченных кучах потоков; между блоками - отмена, бюджет и ход
+      std::shared_ptr<ThreadPool> const pool = ThreadPool::GetShared();
+      size_t const perCandidate = roads != nullptr ? villages.Size() : targetCount;
+      std::vector<size_t> order(villages.Size());
+      std::iota(order.begin(), order.end(), 0);
+      if (progress.HasBudget())
+      {
+          //центр близок к середине охватывающего прямоугольника - с нее и начинаем
+          auto const [minX, maxX] = std::minmax_element(villages.x.begin(), villages.x.end());
+          auto const [minY, maxY] = std::minmax_element(villages.y.begin(), villages.y.end());
+          order = CandidateSearch::OrderByDistance(
+              villages.x.data(), villages.y.data(), villages.Size(), (*minX + *maxX) / 2, (*minY + *maxY) / 2);
+      }
+
+      size_t evaluated = villages.Size();
+      progress.Begin(villages.Size() * perCandidate);
+      ranking = CandidateSearch::RankChunked(
+          *pool,
+          villages.addrs,
+          order,
+          eccentricities,
+          Eccentricity,
+          std::max<size_t>(topK, 1),
+          ActionProgress::SuggestChunk(perCandidate, CandidateSearch::kGrain * pool->GetThreadCount()),
+          [&](size_t done)
+          {
+            evaluated = done;
+            return progress.Proceed(done * perCandidate);
+          });
+      if (!ranking.empty())
+          center = ranking.front();
+      metrics.Add(AgentCounter::PairsEvaluated, evaluated * perCandidate);
+  }
+
+  if (progress.IsCancelled()) {
+      m_logger.Warning("Graph center search cancelled.");
+      return action.FinishUnsuccessfully();
+  }
+  if (!center.Found()) return action.FinishWithError();
+
+  metrics.Start(AgentPhase::Write);
   ScStructure resultStruct = m_context.GenerateStructure();
 
-  for (const auto& v1 : villages) {//перебирем все деревни
-      double maxDistForV1 = 0.0;
-      
-      for (const auto& v2 : villages) {//измеряем расстояние от v1 до всех v2
-          if (v1.addr == v2.addr) continue;
-          double d = std::hypot(v1.x - v2.x, v1.y - v2.y);//считаем расстояние(гипотенуза)
-          if (d > maxDistForV1) maxDistForV1 = d;//сравниваем с максимальным
+  bool const upsert = parameters.HasMode(AmbulanceKeynodes::mode_upsert);
+  size_t rewritten = 0;
+  size_t written = 0;
+  for (size_t i = 0; i < villages.Size(); ++i) {//перебирем все деревни
+      //после остановки по бюджету у части деревень эксцентриситета нет
+      if (std::isnan(eccentricities[i]))
+          continue;
+      if (incremental) {
+          //существующая ссылка переписывается, только если значение изменилось
+          ScAddr link, arc;
+          if (state->WriteEccentricity(m_context, villages.addrs[i], eccentricities[i], link, arc))
+              ++rewritten;
+          resultStruct << link << arc;
+          continue;
+      }
+      if (upsert) {
+          //mode_upsert - старая ссылка обновляется на месте
+          ScAddr link, arc;
+          //новая ссылка - три элемента, существующая только переписывается
+          written += ResultLinks::UpsertProperty(
+                         m_context, villages.addrs[i], AmbulanceKeynodes::nrel_eccentricity, eccentricities[i], link, arc)
+                         ? 3
+                         : 1;
+          resultStruct << link << arc;
+          continue;
       }
 
 //записываем макисмальное расстояние для v1
-      ScAddr link = m_context.GenerateLink(ScType::NodeLink);
-      m_context.SetLinkContent(link, std::to_string(maxDistForV1));
+      ScAddr link = NumericLink::Generate(m_context, eccentricities[i]);
       
       //создаем связь между эксцентриситетом и максимального расстояния
-      ScAddr arc = m_context.GenerateConnector(ScType::ConstCommonArc, v1.addr, link);
+      ScAddr arc = m_context.GenerateConnector(ScType::ConstCommonArc, villages.addrs[i], link);
       m_context.GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_eccentricity, arc);
       resultStruct << link << arc;
-//ищем минимум среди максимумов
-      if (maxDistForV1 < minMaxDist) {
-          minMaxDist = maxDistForV1;
-          centerNode = v1.addr;//записываем вершину как центр графа
-          centerFound = true;
-      }
+      written += 3;
   }
+  if (incremental)
+      m_logger.Debug("Eccentricity links written: " + std::to_string(rewritten));
 
-  if (!centerFound) return action.FinishWithError();
+  ScAddr const centerNode = villages.addrs[center.index];
+  double const minMaxDist = center.score;
   
   //связываем действие наъхождения центра с центром
   ScAddr resArc = m_context.GenerateConnector(ScType::ConstCommonArc, actionNode, centerNode);//общая дуга, действие, центр
   m_context.GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_graph_center, resArc);//принадлежности, отношение центра, результат
   
   resultStruct << centerNode << resArc << AmbulanceKeynodes::nrel_graph_center;
+  if (topK > 0)
+      written += CandidateRanking::Write(m_context, actionNode, villages.addrs, ranking, resultStruct);
+  if (approximate)
+      written += GridCoreset::WriteErrorBound(m_context, actionNode, errorBound, resultStruct);
+  written += progress.Finish(resultStruct);
+  if (progress.IsOutOfTime())
+      m_logger.Warning("Time budget exhausted. The center is the best among evaluated villages.");
+  metrics.Add(AgentCounter::ElementsWritten, written + rewritten + 2);
+  metrics.AttachIfRequested(parameters, actionNode, resultStruct);
   action.SetResult(resultStruct);
 
   m_logger.Info("Graph Center found. Radius: " + std::to_string(minMaxDist));
+  if (approximate)
+      m_logger.Info("Approximate radius. Error bound: " + std::to_string(errorBound));
   return action.FinishSuccessfully();
 }
@@ -0,0 +1,116 @@
+#include "find_nearby_villages_agent.hpp"
+
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "utils/action_parameters.hpp"
+#include "utils/agent_metrics.hpp"
+#include "utils/spatial_index.hpp"
+#include "utils/village_cache.hpp"
+
+using namespace ambulance_module;
+
+ScAddr FindNearbyVillagesAgent::GetActionClass() const
+{
+  return AmbulanceKeynodes::action_find_nearby_villages;
+}
+
+ScResult FindNearbyVillagesAgent::DoProgram(ScAction & action)
+{
+  ScAddr const actionNode = action;
+
+  //аргумент - деревня или любая вершина с nrel_coordinate_x/y (например, станция)
+  ScAddr const origin = action.GetArgument(1);
+  if (!origin.IsValid())
+  {
+    m_logger.Error("Action has no origin argument.");
+    return action.FinishWithError();
+  }
+
+  ActionParameters const parameters(m_context, action);
+  double radius = std::numeric_limits<double>::infinity();
+  double count = 0.0;
+  bool const hasRadius = parameters.ReadNumber(AmbulanceKeynodes::rrel_radius, radius);
+  bool const hasCount = parameters.ReadNumber(AmbulanceKeynodes::rrel_neighbour_count, count);
+  if ((!hasRadius && !hasCount) || (hasRadius && !(radius >= 0.0)) || (hasCount && !(count >= 1.0)))
+  {
+    m_logger.Error("Set a non-negative rrel_radius or a positive rrel_neighbour_count.");
+    return action.FinishWithError();
+  }
+
+  AgentMetrics metrics(m_context, GetActionClass());
+  metrics.Start(AgentPhase::Load);
+
+  //берем снимок деревень из кэша модуля
+  VillageLoadReport report;
+  std::shared_ptr<VillageSnapshot const> const snapshot = VillageCache::Acquire(m_context, report);
+  if (report.Skipped() > 0)
+    m_logger.Warning("Skipped villages with incomplete or malformed data. " + report.ToString());
+
+  metrics.Start(AgentPhase::Compute);
+  std::shared_ptr<SpatialIndex const> const index = SpatialIndex::Acquire(snapshot);
+  VillageSnapshot const & villages = index->GetVillages();
+  metrics.Add(AgentCounter::VillagesLoaded, villages.Size());
+
+  double origin2D[2] = {0.0, 0.0};
+  size_t const originIndex = villages.IndexOf(origin);
+  if (originIndex < villages.Size())
+  {
+    origin2D[0] = villages.x[originIndex];
+    origin2D[1] = villages.y[originIndex];
+  }
+  else
+  {
+    ScAddr const relations[] = {AmbulanceKeynodes::nrel_coordinate_x, AmbulanceKeynodes::nrel_coordinate_y};
+    VillageRecordStatus statuses[2];
+    VillageLoader::ReadProperties(m_context, origin, relations, 2, origin2D, statuses);
+    if (statuses[0] != VillageRecordStatus::Ok || statuses[1] != VillageRecordStatus::Ok)
+    {
+      m_logger.Error("Origin has no valid coordinates.");
+      return action.FinishWithError();
+    }
+  }
+  double const originX = origin2D[0];
+  double const originY = origin2D[1];
+
+  //k ближайших (сама деревня-аргумент не считается), при заданном радиусе - только внутри него
+  std::vector<size_t> found;
+  if (hasCount)
+  {
+    size_t const limit = static_cast<size_t>(count) + (originIndex < villages.Size() ? 1 : 0);
+    found = index->GetTree().KNearest(originX, originY, limit);
+  }
+  else
+    found = index->GetTree().Radius(originX, originY, radius);
+
+  metrics.Start(AgentPhase::Write);
+  ScStructure resultStructure = m_context.GenerateStructure();
+  resultStructure << AmbulanceKeynodes::nrel_nearby_village;
+  size_t written = 0;
+  for (size_t const i : found)
+  {
+    if (i == originIndex)
+      continue;
+    if (hasCount && written == static_cast<size_t>(count))
+      break;
+    if (hasRadius && std::hypot(villages.x[i] - originX, villages.y[i] - originY) > radius)
+      break;//результаты упорядочены по расстоянию
+
+    //действие => nrel_nearby_village: деревня
+    ScAddr const arc = m_context.GenerateConnector(ScType::ConstCommonArc, actionNode, villages.addrs[i]);
+    ScAddr const relArc =
+        m_context.GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_nearby_village, arc);
+    resultStructure << villages.addrs[i] << arc << relArc;
+    ++written;
+  }
+
+  metrics.Add(AgentCounter::PairsEvaluated, found.size());
+  metrics.Add(AgentCounter::ElementsWritten, written * 2);
+  metrics.AttachIfRequested(parameters, actionNode, resultStructure);
+  action.SetResult(resultStructure);
+  m_logger.Info("Nearby villages found: " + std::to_string(written));
+  return action.FinishSuccessfully();
+}
@@ -1,12 +1,37 @@
 #include "find_optimal_agent.hpp" // Исправлен хедер
 
-#include <cmath>
-#include <limits>
-#include <vector>
+#include <algorithm>
+#include <memory>
+#include <numeric>
 #include <string>
+#include <utility>
+#include <vector>
+
+#include "utils/action_parameters.hpp"
+#include "utils/action_progress.hpp"
+#include "utils/agent_metrics.hpp"
+#include "utils/candidate_ranking.hpp"
+#include "utils/candidate_search.hpp"
+#include "utils/distance_kernel.hpp"
+#include "utils/geometric_median.hpp"
+#include "utils/grid_coreset.hpp"
+#include "utils/incremental_state.hpp"
+#include "utils/kd_tree.hpp"
+#include "utils/numeric_link.hpp"
+#include "utils/road_network.hpp"
+#include "utils/village_scope.hpp"
+#include "utils/weighted_grid.hpp"
 
 using namespace ambulance_module;
 
+namespace
+{
+
+//с этого размера отсечение по медиане включается без mode_pruned_median
+size_t const kPrunedSearchThreshold = 2048;
+
+}
+
 ScAddr FindOptimalAgent::GetActionClass() const
 {
   return AmbulanceKeynodes::action_find_optimal_station;
@@ -15,118 +40,271 @@ ScAddr FindOptimalAgent::GetActionClass() const
 ScResult FindOptimalAgent::DoProgram(ScAction & action)
 {
   ScAddr const actionNode = action;
-  
-  struct VillageData
+  //rrel_villages или прямоугольник сужают действие до части деревень
+  ActionParameters const parameters(m_context, action);
+  VillageScope scope;
+  std::string error;
+  //rrel_top_k - кроме победителя записать k лучших кандидатов со счетами
+  size_t topK = 0;
+  //отмена, бюджет времени и публикация хода
+  ActionProgress progress(m_context, actionNode);
+  //mode_approximate / rrel_accuracy - поиск по ячейкам сетки с оценкой погрешности
+  double accuracy = 0.0;
+  if (!scope.Read(m_context, parameters, error) || !CandidateRanking::ReadCount(parameters, topK, error)
+      || !progress.Read(parameters, error) || !GridCoreset::ReadAccuracy(parameters, accuracy, error))
   {
-    ScAddr addr;
-    double x;
-    double y;
-    int population;
-  };
+    m_logger.Error(error);
+    return action.FinishWithError();
+  }
 
-  std::vector<VillageData> villages;
-  ScAddrVector allVillageNodes;
-    //ищем деревни
-  ScIterator3Ptr const it3 = m_context.CreateIterator3(
-  //класс деревень, дуга принадлежности, неизвестная деревня
-      AmbulanceKeynodes::concept_village,
-      ScType::ConstPermPosArc,
-      ScType::Unknown);
-
-//записываем адреса
-  while (it3->Next())
+  AgentMetrics metrics(m_context, GetActionClass());
+  metrics.Start(AgentPhase::Load);
+  
+  //снимок деревень с населением из кэша модуля или только деревни области действия;
+  //состояние модуля синхронизируется с полным снимком, как у агента центра
+  VillageLoadReport report;
+  std::shared_ptr<VillageSnapshot const> all;
+  std::shared_ptr<VillageSnapshot const> const snapshot = scope.AcquireWeighted(m_context, report, &all);
+  VillageSnapshot const & villages = *snapshot;
+
+  if (report.total == 0)
   {
-    ScAddr const villageAddr = it3->Get(2);
-    allVillageNodes.push_back(villageAddr);
+    m_logger.Error("No villages found in the knowledge base.");
+    return action.FinishWithError();
   }
 
-  if (allVillageNodes.empty())
+  if (report.Skipped() > 0)
+    m_logger.Warning("Skipped villages with incomplete or malformed data. " + report.ToString());
+
+  if (villages.Empty())
   {
-    m_logger.Error("No villages found in the knowledge base.");
+    m_logger.Error("No valid village data found.");
     return action.FinishWithError();
   }
+  metrics.Add(AgentCounter::VillagesLoaded, villages.Size());
+
+  KernelPrecision const precision = parameters.HasMode(AmbulanceKeynodes::mode_single_precision)
+                                        ? KernelPrecision::Fast
+                                        : KernelPrecision::Exact;
 
-  for (ScAddr const & villageAddr : allVillageNodes)
+  //mode_road_metric - время по дорогам вместо расстояния по прямой
+  std::shared_ptr<RoadMetric const> const roads =
+      parameters.HasMode(AmbulanceKeynodes::mode_road_metric) ? RoadMetric::Acquire(m_context, villages) : nullptr;
+  if (roads != nullptr && !roads->IsConnected())
+    m_logger.Warning("Road graph is disconnected. Villages that cannot reach everyone get an infinite score.");
+  metrics.Start(AgentPhase::Compute);
+
+  //счет = сумма (дистанция * кол-во людей) по всем деревням
+  auto const Score = [&](size_t c)
   {
-    double x = 0.0;
-    double y = 0.0;
-    int pop = 0;
-    bool dataFound = true;
-
-    auto GetValue = [&](ScAddr const & rel) -> double {
-      ScIterator5Ptr const it5 = m_context.CreateIterator5(
-          villageAddr,//деревня
-          ScType::ConstCommonArc, //дуга общего вида
-          ScType::NodeLink, //ссылка на число
-          ScType::ConstPermPosArc,//пинадлежности
-          rel);//отношение
-
-      if (it5->Next())
-      {
-        ScAddr const linkAddr = it5->Get(2);
-        std::string content_str;
-        m_context.GetLinkContent(linkAddr, content_str);
-        try
-        {
-          return std::stod(content_str);
-        }
-        catch (...)
-        {
-          return 0.0;
-        }
-      }
-      return -1.0;
-    };
+    if (roads != nullptr)
+      return roads->RowWeightedSum(c, villages.population.data());
+    return DistanceKernel::RowWeightedSum(
+        villages.x.data(),
+        villages.y.data(),
+        villages.population.data(),
+        villages.Size(),
+        villages.x[c],
+        villages.y[c],
+        precision);
+  };
+
+  //медиана и границы отсечения опираются на евклидову геометрию, для дорог - только полный перебор
+  bool const continuous = roads == nullptr && parameters.HasMode(AmbulanceKeynodes::mode_continuous_median);
+  //непрерывная медиана и так дешева, приближение заменяет перебор и отсечение
+  bool const approximate = accuracy > 0.0 && roads == nullptr && !continuous;
+  if (accuracy > 0.0 && roads != nullptr)
+    m_logger.Warning("Approximation needs straight-line distances. Running exact search.");
+
+  //состояние модуля между действиями: суммы обновляются только для изменившихся деревень (только для всех деревень)
+  std::shared_ptr<IncrementalState> const state = IncrementalState::GetActive();
+  bool const incremental = state != nullptr && roads == nullptr && !continuous && !approximate
+                           && precision == KernelPrecision::Exact
+                           && !parameters.HasMode(AmbulanceKeynodes::mode_pruned_median) && !scope.IsRestricted();
 
-    double valX = GetValue(AmbulanceKeynodes::nrel_coordinate_x);
-    double valY = GetValue(AmbulanceKeynodes::nrel_coordinate_y);
-    double valPop = GetValue(AmbulanceKeynodes::nrel_population);
+  bool const pruned =
+      roads == nullptr && !incremental && !approximate
+      && (parameters.HasMode(AmbulanceKeynodes::mode_pruned_median) || villages.Size() >= kPrunedSearchThreshold);
 
-    if (valX == -1.0 || valY == -1.0 || valPop == -1.0)
+  MedianPoint median;
+  if (continuous || pruned)
+    median = GeometricMedian::Solve(
+        villages.x.data(), villages.y.data(), villages.population.data(), villages.Size());
+
+  CandidateResult best;
+  //лучшие кандидаты копятся в ограниченной куче прямо в цикле оценки
+  std::vector<CandidateResult> ranking;
+  double errorBound = 0.0;
+  std::shared_ptr<ThreadPool> const pool = ThreadPool::GetShared();
+  if (incremental)
+  {
+    IncrementalView const view = state->Sync(*all);
+    m_logger.Debug("Incremental median search. Recomputed rows: " + std::to_string(view.recomputedRows));
+    //деревни с населением идут в том же порядке, что и в полном снимке
+    std::vector<double> scores;
+    scores.reserve(villages.Size());
+    for (size_t i = 0; i < all->Size(); ++i)
     {
-      m_logger.Warning("Incomplete data for village with addr: " + std::to_string(villageAddr.Hash()));
-      continue; 
+      if (all->HasPopulation(i))
+        scores.push_back(view.scores[i]);
     }
-
-    villages.push_back({villageAddr, valX, valY, (int)valPop});
+    size_t const optimal =
+        view.optimal
+        - size_t(std::lower_bound(all->unweighted.cbegin(), all->unweighted.cend(), view.optimal)
+                 - all->unweighted.cbegin());
+    best = {optimal, scores[optimal], villages.addrs[optimal].Hash()};
+    if (topK > 0)
+      ranking = CandidateSearch::RankScores(villages.addrs, scores, topK);
+    metrics.Add(AgentCounter::PairsEvaluated, view.recomputedRows * all->Size());
   }
-
-  if (villages.empty())
+  else if (continuous)
   {
-    m_logger.Error("No valid village data found.");
-    return action.FinishWithError();
+    //непрерывная медиана привязывается к ближайшей деревне;
+    //рейтинг - k ближайших к медиане деревень, упорядоченных по своему счету
+    KdTree const tree(villages.x.data(), villages.y.data(), villages.Size());
+    size_t const nearest = tree.Nearest(median.x, median.y);
+    best = {nearest, Score(nearest), villages.addrs[nearest].Hash()};
+    metrics.Add(AgentCounter::PairsEvaluated, villages.Size());
+    if (topK > 0)
+    {
+      TopCandidates top(topK);
+      for (size_t const candidate : tree.KNearest(median.x, median.y, topK))
+        top.Offer({candidate, candidate == nearest ? best.score : Score(candidate), villages.addrs[candidate].Hash()});
+      ranking = top.TakeSorted();
+      metrics.Add(AgentCounter::PairsEvaluated, ranking.size() * villages.Size());
+    }
+  }
+  else if (approximate)
+  {
+    //ячейки с центрами масс населения: точно оцениваются только деревни ячеек,
+    //чья нижняя граница в пределах допуска от лучшего счета
+    GridCoreset const coreset(
+        villages.x.data(), villages.y.data(), villages.population.data(), villages.Size(), accuracy);
+    CoresetSearchResult const search =
+        coreset.Search(*pool, villages.addrs, PlacementObjective::Median, Score, std::max<size_t>(topK, 1));
+    ranking = search.ranking;
+    errorBound = search.errorBound;
+    if (!ranking.empty())
+      best = ranking.front();
+    m_logger.Debug(
+        "Approximate median search. Cells: " + std::to_string(coreset.GetCellCount()) + ", evaluated: "
+        + std::to_string(search.evaluated) + " of " + std::to_string(villages.Size()));
+    metrics.Add(
+        AgentCounter::PairsEvaluated,
+        coreset.GetCellCount() * coreset.GetCellCount() + search.evaluated * villages.Size());
   }
+  else if (pruned)
+  {
+    //точно оцениваются только кандидаты, чья нижняя граница не хуже текущего лучшего;
+    //обход от ближайших к медиане, чтобы хороший результат нашелся сразу
+    double totalPopulation = 0.0;
+    for (double const population : villages.population)
+      totalPopulation += population;
 
-  double minScore = std::numeric_limits<double>::max();
-  ScAddr bestVillageAddr;
-  bool found = false;
+    std::vector<double> toMedian(villages.Size());
+    DistanceKernel::Row(
+        villages.x.data(), villages.y.data(), villages.Size(), median.x, median.y, toMedian.data());
+    std::vector<size_t> order(villages.Size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(
+        order.begin(),
+        order.end(),
+        [&](size_t a, size_t b)
+        {
+          return toMedian[a] < toMedian[b] || (toMedian[a] == toMedian[b] && a < b);
+        });
 
-//пережираем все деревни на кандидата для станции
-  for (const auto & candidate : villages)
-  {
-    double currentScore = 0.0;
+    //границы от дешевой к дорогой: треугольник через медиану, грубая и мелкая сетки
+    size_t const cellsPerAxis = WeightedGrid::SuggestCellsPerAxis(villages.Size());
+    WeightedGrid const coarse(
+        villages.x.data(), villages.y.data(), villages.population.data(), villages.Size(), cellsPerAxis);
+    WeightedGrid const fine(
+        villages.x.data(), villages.y.data(), villages.population.data(), villages.Size(), cellsPerAxis * 3);
 
-    for (const auto & target : villages)
+    size_t evaluated = 0;
+    ranking = CandidateSearch::RankOrdered(
+        *pool,
+        villages.addrs,
+        order,
+        [&](size_t c, double threshold)
+        {
+          //score(c) >= W * |c - m| - score(m) для любой точки m
+          return totalPopulation * toMedian[c] - median.cost > threshold
+                 || coarse.LowerBound(villages.x[c], villages.y[c]) > threshold
+                 || fine.LowerBound(villages.x[c], villages.y[c]) > threshold;
+        },
+        Score,
+        precision == KernelPrecision::Fast ? 1e-5 : 1e-9,
+        std::max<size_t>(topK, 1),
+        evaluated);
+    if (!ranking.empty())
+      best = ranking.front();
+    m_logger.Debug(
+        "Pruned median search. Evaluated " + std::to_string(evaluated) + " of " + std::to_string(villages.Size()));
+    //строка до медианы и строки оцененных кандидатов
+    metrics.Add(AgentCounter::PairsEvaluated, (evaluated + 1) * villages.Size());
+  }
+  else
+  {
+    //кандидаты оцениваются параллельно блоками, лучшие результаты потоков сливаются детерминированно;
+    //с бюджетом времени первыми идут деревни у центра масс населения - рядом с ним и лежит медиана
+    std::vector<size_t> order(villages.Size());
+    std::iota(order.begin(), order.end(), 0);
+    if (progress.HasBudget())
     {
-    //ищем дистанцию
-      double dist = std::hypot(candidate.x - target.x, candidate.y - target.y);
-      currentScore += dist * target.population;//счет = дистанция * кол-во людей
+      double totalPopulation = 0.0;
+      double centerX = 0.0;
+      double centerY = 0.0;
+      for (size_t i = 0; i < villages.Size(); ++i)
+      {
+        totalPopulation += villages.population[i];
+        centerX += villages.population[i] * villages.x[i];
+        centerY += villages.population[i] * villages.y[i];
+      }
+      if (totalPopulation > 0.0)
+        order = CandidateSearch::OrderByDistance(
+            villages.x.data(),
+            villages.y.data(),
+            villages.Size(),
+            centerX / totalPopulation,
+            centerY / totalPopulation);
     }
 
-//сравниваем с мин счетом
-    if (currentScore < minScore)
-    {
-      minScore = currentScore;
-      bestVillageAddr = candidate.addr;//записываем текущего побидителя
-      found = true;
-    }
+    std::vector<double> scores;
+    size_t evaluated = villages.Size();
+    progress.Begin(villages.Size() * villages.Size());
+    ranking = CandidateSearch::RankChunked(
+        *pool,
+        villages.addrs,
+        order,
+        scores,
+        Score,
+        std::max<size_t>(topK, 1),
+        ActionProgress::SuggestChunk(villages.Size(), CandidateSearch::kGrain * pool->GetThreadCount()),
+        [&](size_t done)
+        {
+          evaluated = done;
+          return progress.Proceed(done * villages.Size());
+        });
+    if (!ranking.empty())
+      best = ranking.front();
+    metrics.Add(AgentCounter::PairsEvaluated, evaluated * villages.Size());
   }
 
-  if (!found)
+  if (progress.IsCancelled())
+  {
+    m_logger.Warning("Optimal station search cancelled.");
+    return action.FinishUnsuccessfully();
+  }
+  if (!best.Found())
   {
     return action.FinishWithError();
   }
 
+  metrics.Start(AgentPhase::Write);
+  ScAddr const bestVillageAddr = villages.addrs[best.index];//победитель
+  double const minScore = best.score;
+
   ScStructure resultStructure = m_context.GenerateStructure();
 
 //создаем дугу от действия к победителю
@@ -142,10 +320,50 @@ ScResult FindOptimalAgent::DoProgram(ScAction & action)
       resultArc);//прошлая дуга
 
   resultStructure << bestVillageAddr << resultArc << relArc << AmbulanceKeynodes::nrel_optimal_location;
+  metrics.Add(AgentCounter::ElementsWritten, 2);
+
+  if (continuous)
+  {
+    //точка медианы: действие => nrel_geometric_median: точка (с координатами)
+    ScAddr const point = m_context.GenerateNode(ScType::ConstNode);
+    ScAddr const medianArc = m_context.GenerateConnector(ScType::ConstCommonArc, actionNode, point);
+    ScAddr const medianRelArc =
+        m_context.GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_geometric_median, medianArc);
+    resultStructure << point << medianArc << medianRelArc << AmbulanceKeynodes::nrel_geometric_median;
+
+    std::pair<ScAddr, double> const coordinates[] = {
+        {AmbulanceKeynodes::nrel_coordinate_x, median.x}, {AmbulanceKeynodes::nrel_coordinate_y, median.y}};
+    for (auto const & [relation, value] : coordinates)
+    {
+      ScAddr const link = NumericLink::Generate(m_context, value);
+      ScAddr const arc = m_context.GenerateConnector(ScType::ConstCommonArc, point, link);
+      ScAddr const relArc = m_context.GenerateConnector(ScType::ConstPermPosArc, relation, arc);
+      resultStructure << link << arc << relArc << relation;
+    }
+    //точка, ее дуга с отношением и по три элемента на координату
+    metrics.Add(AgentCounter::ElementsWritten, 9);
+  }
+
+  if (topK > 0)
+    metrics.Add(
+        AgentCounter::ElementsWritten,
+        CandidateRanking::Write(m_context, actionNode, villages.addrs, ranking, resultStructure));
+
+  if (approximate)
+    metrics.Add(
+        AgentCounter::ElementsWritten,
+        GridCoreset::WriteErrorBound(m_context, actionNode, errorBound, resultStructure));
+
+  metrics.Add(AgentCounter::ElementsWritten, progress.Finish(resultStructure));
+  if (progress.IsOutOfTime())
+    m_logger.Warning("Time budget exhausted. The station is the best among evaluated villages.");
 
+  metrics.AttachIfRequested(parameters, actionNode, resultStructure);
   action.SetResult(resultStructure);
   
   m_logger.Info("Optimal station found. Min weighted score: " + std::to_string(minScore));
+  if (approximate)
+    m_logger.Info("Approximate score. Error bound: " + std::to_string(errorBound));
 
   return action.FinishSuccessfully();
 }
@@ -1,9 +1,14 @@
 #include "find_problem_zones_agent.hpp"
-#include <cmath>
-#include <vector>
+#include <memory>
 #include <string>
-#include <numeric>
-#include <tuple> 
+#include <vector>
+
+#include "utils/action_parameters.hpp"
+#include "utils/agent_metrics.hpp"
+#include "utils/grid_coreset.hpp"
+#include "utils/problem_zones.hpp"
+#include "utils/road_network.hpp"
+#include "utils/village_scope.hpp"
 
 using namespace ambulance_module;
 
@@ -15,99 +20,80 @@ ScAddr FindProblemZonesAgent::GetActionClass() const
 ScResult FindProblemZonesAgent::DoProgram(ScAction & action)
 {
   ScAddr const actionNode = action;
-
-  ScAddr optimalStation;
-  bool stationFound = false;
-
-  // Ищем любую дугу помеченную как nrel_optimal_location
-  ScIterator3Ptr itOpt = m_context.CreateIterator3(
-      AmbulanceKeynodes::nrel_optimal_location,//отношение "Оптимальное расположение"
-      ScType::ConstPermPosArc,//принадлежности
-      ScType::Unknown //неизвестная дуга между action и village, котрая помечена отношением
-  );
-
-  while (itOpt->Next())
+  //rrel_villages или прямоугольник сужают действие до части деревень
+  ActionParameters const parameters(m_context, action);
+  VillageScope scope;
+  std::string error;
+  if (!scope.Read(m_context, parameters, error))
   {
-      ScAddr resultArc = itOpt->Get(2);//адрес дуги
-      
-      //кортеж 
-      auto [source, target] = m_context.GetConnectorIncidentElements(resultArc);
-      // source - действие, target - найденная оптимальная деревня
-      
-      //проверяем что target это деревня 
-      if (m_context.CheckConnector(
-          AmbulanceKeynodes::concept_village, target, ScType::ConstPermPosArc)) 
-      {
-          optimalStation = target;
-          stationFound = true;
-          break;
-      }
+    m_logger.Error(error);
+    return action.FinishWithError();
   }
 
-  if (!stationFound)
+  AgentMetrics metrics(m_context, GetActionClass());
+  metrics.Start(AgentPhase::Load);
+
+  //снимок деревень из кэша модуля или только деревни области действия
+  VillageLoadReport report;
+  std::shared_ptr<VillageSnapshot const> const snapshot = scope.Acquire(m_context, report);
+  VillageSnapshot const & villages = *snapshot;
+  if (report.Skipped() > 0)
+      m_logger.Warning("Skipped villages with incomplete or malformed data. " + report.ToString());
+  metrics.Add(AgentCounter::VillagesLoaded, villages.Size());
+
+  ProblemZoneSettings settings;
+  if (!ProblemZones::ReadSettings(parameters, settings, error)
+      || !GridCoreset::ReadAccuracy(parameters, settings.accuracy, error))
   {
-      m_logger.Error("Optimal station not found. Run FindOptimalAgent first.");
+      m_logger.Error(error);
       return action.FinishWithError();
   }
 
-  //считываем координаты оптимальной станции
-  auto GetCoord = [&](ScAddr const & node, ScAddr const & rel) -> double {
-      ScIterator5Ptr it = m_context.CreateIterator5(
-          node, ScType::ConstCommonArc, ScType::NodeLink, ScType::ConstPermPosArc, rel);
-      if (it->Next()) {
-          std::string str;
-          m_context.GetLinkContent(it->Get(2), str);
-          try { return std::stod(str); } catch(...) { return 0.0; }
-      }
-      return 0.0;
-  };
-
-  double optX = GetCoord(optimalStation, AmbulanceKeynodes::nrel_coordinate_x);
-  double optY = GetCoord(optimalStation, AmbulanceKeynodes::nrel_coordinate_y);
-
-  //считываем остальные деревни
-  struct VillageDist { ScAddr addr; double dist; };
-  std::vector<VillageDist> list;
-  double totalDist = 0;
-
-  ScIterator3Ptr itV = m_context.CreateIterator3(
-      AmbulanceKeynodes::concept_village, ScType::ConstPermPosArc, ScType::Unknown);
-  
-  while(itV->Next())
+  //порог считается от оптимальной станции, покрытие - по элементам concept_ambulance_station
+  std::vector<size_t> stations;
+  if (settings.coverage)
+      stations = ProblemZones::CollectStations(m_context, villages);
+  else if (size_t const optimal = ProblemZones::FindOptimalStation(m_context, villages); optimal != ProblemZones::kNone)
+      stations.push_back(optimal);
+  if (stations.empty())
   {
-      ScAddr v = itV->Get(2);//адрес деревни
-      if (v == optimalStation) continue;
-//получаем координаты
-      double x = GetCoord(v, AmbulanceKeynodes::nrel_coordinate_x);
-      double y = GetCoord(v, AmbulanceKeynodes::nrel_coordinate_y);
-      //считаем дистанцию между оптимальной и текущей
-      double d = std::hypot(x - optX, y - optY);
-      list.push_back({v, d});//добавляем в вектор хранения адресов и дистанций
-      totalDist += d;//общая сумма расстояний
+      m_logger.Error(
+          settings.coverage ? "No villages in concept_ambulance_station. Run PlaceStationsAgent first."
+                            : "Optimal station not found. Run FindOptimalAgent first.");
+      return action.FinishWithError();
   }
 
-  if (list.empty()) return action.FinishSuccessfully();
-
-  double avgDist = totalDist / list.size();//среднее расстояние для деревень
-  double threshold = avgDist * 1.5; //критерий плохой зоны
-
-  m_logger.Info("Average distance: " + std::to_string(avgDist) + 
-                ", Threshold: " + std::to_string(threshold));
-
-  ScStructure resultStruct = m_context.GenerateStructure();
+  //mode_road_metric - время по дорогам вместо расстояния по прямой
+  std::shared_ptr<RoadMetric const> const roads =
+      parameters.HasMode(AmbulanceKeynodes::mode_road_metric) ? RoadMetric::Acquire(m_context, villages) : nullptr;
+
+  //приближение опирается на евклидово расстояние до оптимальной станции
+  if (settings.accuracy > 0.0 && (settings.coverage || roads != nullptr))
+      m_logger.Warning(
+          "Approximation applies to the threshold mode with straight-line distances only. Running exact search.");
+
+  metrics.Start(AgentPhase::Compute);
+  ProblemZoneResult const zones = ProblemZones::Find(settings, villages, stations, roads.get());
+  //порог - строка одной станции; покрытие по дорогам - строка каждой станции, по прямой - ближайшая через дерево
+  metrics.Add(AgentCounter::PairsEvaluated, villages.Size() * (roads != nullptr ? stations.size() : 1));
+
+  if (zones.coverage)
+      m_logger.Info(
+          "Stations: " + std::to_string(stations.size()) + ", uncovered villages: "
+          + std::to_string(zones.zones.size()) + ", uncovered population: "
+          + std::to_string(zones.uncoveredPopulation));
+  else
+      m_logger.Info(
+          "Threshold: " + std::to_string(zones.threshold) + ", problem zones: " + std::to_string(zones.zones.size()));
+  if (zones.approximate)
+      m_logger.Info("Approximate threshold. Error bound: " + std::to_string(zones.errorBound));
 
   //помечаем проблемные зоны
-  for (const auto& item : list)//проходимся по вектору с деревнями и дистанциями 
-  {
-      if (item.dist > threshold)
-      {
-          ScAddr resArc = m_context.GenerateConnector(ScType::ConstCommonArc, actionNode, item.addr);//создаем дугу между действием и далекой деревней
-          m_context.GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_problem_zone, resArc);//помечаем дугу как проблемная зона
-          resultStruct << item.addr << resArc << AmbulanceKeynodes::nrel_problem_zone;
-          
-          m_logger.Info("Problem zone found! Distance: " + std::to_string(item.dist));
-      }
-  }
+  metrics.Start(AgentPhase::Write);
+  ScStructure resultStruct = m_context.GenerateStructure();
+  ProblemZones::Write(m_context, actionNode, villages, zones, resultStruct);
+  metrics.Add(AgentCounter::ElementsWritten, ProblemZones::CountWritten(zones));
+  metrics.AttachIfRequested(parameters, actionNode, resultStruct);
 
   action.SetResult(resultStruct);
   return action.FinishSuccessfully();
@@ -0,0 +1,66 @@
+#include "import_villages_agent.hpp"
+
+#include <string>
+#include <vector>
+
+#include "utils/action_parameters.hpp"
+#include "utils/agent_metrics.hpp"
+#include "utils/village_import.hpp"
+
+using namespace ambulance_module;
+
+ScAddr ImportVillagesAgent::GetActionClass() const
+{
+  return AmbulanceKeynodes::action_import_villages;
+}
+
+ScResult ImportVillagesAgent::DoProgram(ScAction & action)
+{
+  ScAddr const actionNode = action;
+
+  std::string path;
+  ScAddr const pathLink = action.GetArgument(1);
+  if (!pathLink.IsValid() || !m_context.GetElementType(pathLink).IsLink()
+      || !m_context.GetLinkContent(pathLink, path) || path.empty())
+  {
+    m_logger.Error("Action has no link with a file path.");
+    return action.FinishWithError();
+  }
+
+  AgentMetrics metrics(m_context, GetActionClass());
+  metrics.Start(AgentPhase::Load);
+
+  std::vector<ImportedVillage> villages;
+  VillageImportReport report;
+  std::string error;
+  if (!VillageImport::ParseFile(path, villages, report, error))
+  {
+    m_logger.Error("Cannot import villages: " + error);
+    return action.FinishWithError();
+  }
+  if (report.malformed > 0)
+    m_logger.Warning("Skipped malformed records. " + report.ToString());
+  metrics.Add(AgentCounter::VillagesLoaded, villages.size());
+
+  metrics.Start(AgentPhase::Write);
+  ScAddrVector created;
+  VillageImport::Write(m_context, villages, report, &created);
+  if (!report.conflicting.empty())
+  {
+    std::string ids;
+    for (std::string const & id : report.conflicting)
+      ids += (ids.empty() ? "" : ", ") + id;
+    m_logger.Warning("Skipped records whose identifier belongs to an element that is not a village: " + ids);
+  }
+  metrics.Add(AgentCounter::ElementsWritten, created.size() * VillageImport::kElementsPerVillage);
+
+  //в результат попадают только узлы деревень, их свойства находятся по ним
+  ScStructure resultStruct = m_context.GenerateStructure();
+  for (ScAddr const & village : created)
+    resultStruct << village;
+  metrics.AttachIfRequested(ActionParameters(m_context, action), actionNode, resultStruct);
+  action.SetResult(resultStruct);
+
+  m_logger.Info("Villages imported from " + path + ". " + report.ToString());
+  return action.FinishSuccessfully();
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <sc-memory/sc_agent.hpp>
+
+#include "keynodes/ambulance_keynodes.hpp"
+
+namespace ambulance_module
+{
+
+//массовый импорт деревень из CSV или бинарного файла; аргумент - ссылка с путем к файлу
+class ImportVillagesAgent : public ScActionInitiatedAgent
+{
+public:
+  ScAddr GetActionClass() const override;
+
+  ScResult DoProgram(ScAction & action) override;
+};
+
+}
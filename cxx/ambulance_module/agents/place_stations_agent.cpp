@@ -0,0 +1,163 @@
+#include "place_stations_agent.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "utils/action_parameters.hpp"
+#include "utils/action_progress.hpp"
+#include "utils/agent_metrics.hpp"
+#include "utils/station_placement.hpp"
+#include "utils/village_scope.hpp"
+
+using namespace ambulance_module;
+
+namespace
+{
+
+//число станций без rrel_station_count
+size_t const kDefaultStationCount = 2;
+
+//снимает отметки concept_ambulance_station, поставленные прошлыми размещениями: такие отметки лежат
+//в структурах результатов действий action_place_stations, отметки вручную туда не попадают
+size_t EraseEarlierPlacement(ScMemoryContext & context, ScAddr const & currentAction)
+{
+  std::vector<ScAddr> placed;
+  ScIterator3Ptr const itTags =
+      context.CreateIterator3(AmbulanceKeynodes::concept_ambulance_station, ScType::ConstPermPosArc, ScType::Unknown);
+  while (itTags->Next())
+  {
+    ScAddr const tag = itTags->Get(1);
+    bool byPlacement = false;
+    ScIterator3Ptr const itStructures =
+        context.CreateIterator3(ScType::ConstNodeStructure, ScType::ConstPermPosArc, tag);
+    while (!byPlacement && itStructures->Next())
+    {
+      //действие => nrel_result: структура
+      ScIterator5Ptr const itActions = context.CreateIterator5(
+          ScType::ConstNode, ScType::ConstCommonArc, itStructures->Get(0), ScType::ConstPermPosArc,
+          ScKeynodes::nrel_result);
+      while (!byPlacement && itActions->Next())
+        byPlacement = itActions->Get(0) != currentAction
+                      && context.CheckConnector(
+                          AmbulanceKeynodes::action_place_stations, itActions->Get(0), ScType::ConstPermPosArc);
+    }
+    if (byPlacement)
+      placed.push_back(tag);
+  }
+
+  for (ScAddr const & tag : placed)
+    context.EraseElement(tag);
+  return placed.size();
+}
+
+}
+
+ScAddr PlaceStationsAgent::GetActionClass() const
+{
+  return AmbulanceKeynodes::action_place_stations;
+}
+
+ScResult PlaceStationsAgent::DoProgram(ScAction & action)
+{
+  ScAddr const actionNode = action;
+  //rrel_villages или прямоугольник сужают действие до части деревень
+  ActionParameters const parameters(m_context, action);
+  VillageScope scope;
+  ActionProgress progress(m_context, actionNode);
+  std::string error;
+  if (!scope.Read(m_context, parameters, error) || !progress.Read(parameters, error))
+  {
+    m_logger.Error(error);
+    return action.FinishWithError();
+  }
+
+  AgentMetrics metrics(m_context, GetActionClass());
+  metrics.Start(AgentPhase::Load);
+
+  //снимок деревень с населением из кэша модуля или только деревни области действия
+  VillageLoadReport report;
+  std::shared_ptr<VillageSnapshot const> const snapshot = scope.AcquireWeighted(m_context, report);
+  VillageSnapshot const & villages = *snapshot;
+  if (report.Skipped() > 0)
+    m_logger.Warning("Skipped villages with incomplete or malformed data. " + report.ToString());
+
+  if (villages.Empty())
+  {
+    m_logger.Error("No valid village data found.");
+    return action.FinishWithError();
+  }
+  metrics.Add(AgentCounter::VillagesLoaded, villages.Size());
+
+  double const requested = parameters.GetNumber(AmbulanceKeynodes::rrel_station_count, kDefaultStationCount);
+  if (!(requested >= 1.0))
+  {
+    m_logger.Error("Station count must be a positive number.");
+    return action.FinishWithError();
+  }
+  size_t const stationCount = static_cast<size_t>(requested);
+
+  //mode_p_center - минимизировать худшее расстояние, иначе - сумму расстояний с весом населения
+  PlacementObjective const objective = parameters.HasMode(AmbulanceKeynodes::mode_p_center)
+                                           ? PlacementObjective::Center
+                                           : PlacementObjective::Median;
+
+  metrics.Start(AgentPhase::Compute);
+  StationPlacement const placement(
+      villages.x.data(), villages.y.data(), villages.population.data(), villages.Size(), objective);
+  //ход - число обменов из наибольшего допустимого; каждое промежуточное размещение допустимо
+  progress.Begin(StationPlacement::kDefaultMaxSwaps);
+  PlacementResult const result = placement.Solve(
+      *ThreadPool::GetShared(),
+      stationCount,
+      StationPlacement::kDefaultMaxSwaps,
+      StationPlacement::kDefaultSeed,
+      [&progress](size_t swaps)
+      {
+        return progress.Proceed(swaps);
+      });
+  metrics.Add(AgentCounter::PairsEvaluated, result.pairsEvaluated);
+  if (progress.IsCancelled())
+  {
+    m_logger.Info("Station placement cancelled. Swaps: " + std::to_string(result.swaps));
+    return action.FinishUnsuccessfully();
+  }
+
+  metrics.Start(AgentPhase::Write);
+  //новое размещение заменяет прошлые: их станции больше не входят в покрытие
+  size_t const replaced = EraseEarlierPlacement(m_context, actionNode);
+  ScStructure resultStructure = m_context.GenerateStructure();
+  resultStructure << AmbulanceKeynodes::nrel_ambulance_station << AmbulanceKeynodes::concept_ambulance_station;
+
+  for (size_t const station : result.stations)
+  {
+    ScAddr const village = villages.addrs[station];
+
+    //действие => nrel_ambulance_station: деревня
+    ScAddr const arc = m_context.GenerateConnector(ScType::ConstCommonArc, actionNode, village);
+    ScAddr const relArc =
+        m_context.GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_ambulance_station, arc);
+    resultStructure << village << arc << relArc;
+
+    //деревня становится станцией скорой помощи; отметка, поставленная вручную, остается чужой
+    //и в результат не входит, чтобы следующее размещение ее не сняло
+    bool const tagged = m_context.CheckConnector(
+        AmbulanceKeynodes::concept_ambulance_station, village, ScType::ConstPermPosArc);
+    if (!tagged)
+      resultStructure << m_context.GenerateConnector(
+          ScType::ConstPermPosArc, AmbulanceKeynodes::concept_ambulance_station, village);
+    metrics.Add(AgentCounter::ElementsWritten, tagged ? 2 : 3);
+  }
+
+  metrics.Add(AgentCounter::ElementsWritten, progress.Finish(resultStructure));
+  if (!result.complete)
+    m_logger.Warning("Time budget exhausted, placement is the best found before the stop.");
+  metrics.AttachIfRequested(parameters, actionNode, resultStructure);
+  action.SetResult(resultStructure);
+
+  m_logger.Info(
+      "Placed " + std::to_string(result.stations.size()) + " stations. Cost: " + std::to_string(result.cost)
+      + ", swaps: " + std::to_string(result.swaps) + ", earlier stations untagged: " + std::to_string(replaced));
+
+  return action.FinishSuccessfully();
+}
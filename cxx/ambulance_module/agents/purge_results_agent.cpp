@@ -0,0 +1,125 @@
+#include "purge_results_agent.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "utils/incremental_state.hpp"
+#include "utils/result_links.hpp"
+
+using namespace ambulance_module;
+
+namespace
+{
+
+//дуги из множества relation (relation -> дуга)
+std::vector<ScAddr> CollectRelationArcs(ScMemoryContext & context, ScAddr const & relation)
+{
+  std::vector<ScAddr> arcs;
+  ScIterator3Ptr const it3 = context.CreateIterator3(relation, ScType::ConstPermPosArc, ScType::ConstCommonArc);
+  while (it3->Next())
+    arcs.push_back(it3->Get(2));
+  return arcs;
+}
+
+}  // namespace
+
+ScAddr PurgeResultsAgent::GetActionClass() const
+{
+  return AmbulanceKeynodes::action_purge_results;
+}
+
+ScResult PurgeResultsAgent::DoProgram(ScAction & action)
+{
+  //сначала собираем, потом удаляем: итераторы не должны видеть изменений
+  size_t erased = 0;
+  m_context.BeginEventsPending();
+
+  //расстояния между деревнями: дуга и ссылка со значением
+  for (ScAddr const & arc : CollectRelationArcs(m_context, AmbulanceKeynodes::nrel_distance))
+  {
+    ResultLinks::EraseDistance(m_context, arc);
+    ++erased;
+  }
+
+  //значения-ссылки: деревня/действие => отношение: ссылка
+  for (ScAddr const & relation :
+       {AmbulanceKeynodes::nrel_eccentricity,
+        AmbulanceKeynodes::nrel_distance_matrix,
+        AmbulanceKeynodes::nrel_uncovered_population,
+        AmbulanceKeynodes::nrel_metrics,
+        AmbulanceKeynodes::nrel_progress,
+        AmbulanceKeynodes::nrel_progress_total,
+        AmbulanceKeynodes::nrel_error_bound})
+  {
+    for (ScAddr const & arc : CollectRelationArcs(m_context, relation))
+    {
+      auto const [source, link] = m_context.GetConnectorIncidentElements(arc);
+      m_context.EraseElement(link);
+      m_context.EraseElement(arc);
+      ++erased;
+    }
+  }
+
+  //точка медианы вместе со своими координатами
+  for (ScAddr const & arc : CollectRelationArcs(m_context, AmbulanceKeynodes::nrel_geometric_median))
+  {
+    auto const [source, point] = m_context.GetConnectorIncidentElements(arc);
+    std::vector<ScAddr> links;
+    ScIterator3Ptr const itLinks = m_context.CreateIterator3(point, ScType::ConstCommonArc, ScType::NodeLink);
+    while (itLinks->Next())
+      links.push_back(itLinks->Get(2));
+    for (ScAddr const & link : links)
+      m_context.EraseElement(link);
+    m_context.EraseElement(point);
+    ++erased;
+  }
+
+  //рейтинг кандидатов: кортеж с ролями мест и ссылками счетов; деревни-участники остаются
+  for (ScAddr const & arc : CollectRelationArcs(m_context, AmbulanceKeynodes::nrel_candidate_ranking))
+  {
+    auto const [source, tuple] = m_context.GetConnectorIncidentElements(arc);
+    std::vector<ScAddr> links;
+    ScIterator3Ptr const itMembers = m_context.CreateIterator3(tuple, ScType::ConstPermPosArc, ScType::ConstNode);
+    while (itMembers->Next())
+    {
+      //дуга участника => nrel_candidate_score: ссылка
+      ScIterator5Ptr const itScore = m_context.CreateIterator5(
+          itMembers->Get(1),
+          ScType::ConstCommonArc,
+          ScType::NodeLink,
+          ScType::ConstPermPosArc,
+          AmbulanceKeynodes::nrel_candidate_score);
+      while (itScore->Next())
+        links.push_back(itScore->Get(2));
+    }
+    for (ScAddr const & link : links)
+      m_context.EraseElement(link);
+    m_context.EraseElement(tuple);
+    ++erased;
+  }
+
+  //ответы действий на деревни: сами деревни остаются, удаляется только дуга от действия
+  for (ScAddr const & relation :
+       {AmbulanceKeynodes::nrel_graph_center,
+        AmbulanceKeynodes::nrel_optimal_location,
+        AmbulanceKeynodes::nrel_problem_zone,
+        AmbulanceKeynodes::nrel_ambulance_station,
+        AmbulanceKeynodes::nrel_nearby_village})
+  {
+    for (ScAddr const & arc : CollectRelationArcs(m_context, relation))
+    {
+      m_context.EraseElement(arc);
+      ++erased;
+    }
+  }
+
+  m_context.EndEventsPending();
+
+  //ссылки, которые помнит инкрементальное состояние, удалены
+  if (std::shared_ptr<IncrementalState> const state = IncrementalState::GetActive())
+    state->ForgetWrittenResults();
+
+  m_logger.Info("Results purged. Erased: " + std::to_string(erased));
+  return action.FinishSuccessfully();
+}
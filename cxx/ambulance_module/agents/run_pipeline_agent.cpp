@@ -0,0 +1,269 @@
+#include "run_pipeline_agent.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "utils/action_parameters.hpp"
+#include "utils/agent_metrics.hpp"
+#include "utils/candidate_search.hpp"
+#include "utils/distance_kernel.hpp"
+#include "utils/distance_matrix.hpp"
+#include "utils/distance_writer.hpp"
+#include "utils/incremental_state.hpp"
+#include "utils/numeric_link.hpp"
+#include "utils/problem_zones.hpp"
+#include "utils/result_links.hpp"
+#include "utils/road_network.hpp"
+#include "utils/village_scope.hpp"
+
+using namespace ambulance_module;
+
+namespace
+{
+
+//сколько значений расстояний держим в блоке строк (8 МБ): строки блока считаются параллельно,
+//а дуги по ним пишутся последовательно
+size_t const kBlockValues = size_t(1) << 20;
+
+}
+
+ScAddr RunPipelineAgent::GetActionClass() const
+{
+  return AmbulanceKeynodes::action_run_pipeline;
+}
+
+ScResult RunPipelineAgent::DoProgram(ScAction & action)
+{
+  ScAddr const actionNode = action;
+  //rrel_villages или прямоугольник сужают действие до части деревень
+  ActionParameters const parameters(m_context, action);
+  VillageScope scope;
+  std::string error;
+  if (!scope.Read(m_context, parameters, error))
+  {
+    m_logger.Error(error);
+    return action.FinishWithError();
+  }
+
+  AgentMetrics metrics(m_context, GetActionClass());
+  metrics.Start(AgentPhase::Load);
+
+  //снимок загружается один раз на все этапы
+  VillageLoadReport report;
+  std::shared_ptr<VillageSnapshot const> const snapshot = scope.Acquire(m_context, report);
+  VillageSnapshot const & villages = *snapshot;
+  if (report.Skipped() > 0)
+    m_logger.Warning("Skipped villages with incomplete or malformed data. " + report.ToString());
+
+  if (villages.Empty())
+  {
+    m_logger.Error("No valid village data found.");
+    return action.FinishWithError();
+  }
+
+  metrics.Add(AgentCounter::VillagesLoaded, villages.Size());
+
+  KernelPrecision const precision = parameters.HasMode(AmbulanceKeynodes::mode_single_precision)
+                                        ? KernelPrecision::Fast
+                                        : KernelPrecision::Exact;
+  //при состоянии модуля дуги и ссылки всегда обновляются на месте, как у отдельных агентов
+  std::shared_ptr<IncrementalState> const state = IncrementalState::GetActive();
+  bool const upsert = parameters.HasMode(AmbulanceKeynodes::mode_upsert) || state != nullptr;
+  bool const asMatrix = parameters.HasMode(AmbulanceKeynodes::mode_distance_matrix);
+
+  //параметры проблемных зон проверяются до записи результатов
+  ProblemZoneSettings settings;
+  if (!ProblemZones::ReadSettings(parameters, settings, error))
+  {
+    m_logger.Error(error);
+    return action.FinishWithError();
+  }
+
+  //mode_road_metric - время по дорогам вместо расстояния по прямой
+  std::shared_ptr<RoadMetric const> const roads =
+      parameters.HasMode(AmbulanceKeynodes::mode_road_metric) ? RoadMetric::Acquire(m_context, villages) : nullptr;
+  if (roads != nullptr && !roads->IsConnected())
+    m_logger.Warning("Road graph is disconnected. Some eccentricities and scores are infinite.");
+
+  size_t const size = villages.Size();
+  std::vector<double> eccentricities(size, 0.0);
+  std::vector<double> scores(size, 0.0);
+
+  DistanceMatrix matrix;
+  if (asMatrix)
+    matrix = DistanceMatrix(
+        villages.addrs, precision == KernelPrecision::Fast ? MatrixPrecision::Float : MatrixPrecision::Double);
+  DistanceWriter writer(m_context);
+  size_t updated = 0;
+  size_t erased = 0;
+
+  //один проход по строкам: из строки i берутся эксцентриситет, взвешенная сумма и пары j > i
+  std::shared_ptr<ThreadPool> const pool = ThreadPool::GetShared();
+  size_t const blockRows = std::max<size_t>(1, std::min(size, kBlockValues / size));
+  std::vector<double> block(blockRows * size);
+  for (size_t start = 0; start < size; start += blockRows)
+  {
+    size_t const rows = std::min(blockRows, size - start);
+    metrics.Start(AgentPhase::Compute);
+    pool->ParallelFor(
+        rows,
+        1,
+        [&](size_t begin, size_t end, size_t)
+        {
+          for (size_t r = begin; r < end; ++r)
+          {
+            size_t const i = start + r;
+            double * row = &block[r * size];
+            if (roads != nullptr)
+              roads->Row(i, row);
+            else
+              DistanceKernel::Row(
+                  villages.x.data(), villages.y.data(), size, villages.x[i], villages.y[i], row, precision);
+
+            double eccentricity = 0.0;
+            double score = 0.0;
+            for (size_t j = 0; j < size; ++j)
+            {
+              eccentricity = std::max(eccentricity, row[j]);
+              //деревня без жителей не влияет на сумму, даже если недостижима (0 * inf = NaN)
+              if (villages.population[j] > 0.0)
+                score += villages.population[j] * row[j];
+            }
+            eccentricities[i] = eccentricity;
+            scores[i] = score;
+          }
+        });
+
+    metrics.Start(AgentPhase::Write);
+    for (size_t r = 0; r < rows; ++r)
+    {
+      size_t const i = start + r;
+      double const * row = &block[r * size];
+      if (asMatrix)
+      {
+        for (size_t j = i + 1; j < size; ++j)
+          matrix.Set(i, j, row[j]);
+        continue;
+      }
+
+      //mode_upsert - существующие дуги пар обновляются на месте, дубликаты удаляются
+      std::unordered_map<ScAddr::HashType, ScAddr> existing;
+      if (upsert)
+        existing = ResultLinks::CollectDistances(m_context, villages.addrs[i], &erased);
+
+      for (size_t j = i + 1; j < size; ++j)
+      {
+        //недостижимые по дорогам пары не записываются
+        if (std::isinf(row[j]))
+          continue;
+
+        auto const it = existing.find(villages.addrs[j].Hash());
+        if (it != existing.end())
+        {
+          NumericLink::Write(m_context, it->second, row[j]);
+          ++updated;
+          continue;
+        }
+        writer.Add(villages.addrs[i], villages.addrs[j], row[j]);
+      }
+    }
+  }
+  writer.Flush();
+
+  //точные расстояния всех пар совпадают с тем, что записал бы агент расстояний; иначе его следующая запись полная
+  if (state != nullptr && !asMatrix)
+  {
+    if (roads == nullptr && precision == KernelPrecision::Exact && !scope.IsRestricted())
+      state->CommitDistances(villages);
+    else
+      state->InvalidateDistances();
+  }
+
+  //лучшие по тем же правилам, что у отдельных агентов: меньшее значение, при равенстве - меньший хэш
+  metrics.Start(AgentPhase::Compute);
+  CandidateResult center;
+  CandidateResult optimal;
+  for (size_t i = 0; i < size; ++i)
+  {
+    CandidateResult const byEccentricity{i, eccentricities[i], villages.addrs[i].Hash()};
+    if (byEccentricity.IsBetterThan(center))
+      center = byEccentricity;
+    //станцию, как и отдельный агент, выбираем только среди деревень с населением
+    CandidateResult const byScore{i, scores[i], villages.addrs[i].Hash()};
+    if (villages.HasPopulation(i) && byScore.IsBetterThan(optimal))
+      optimal = byScore;
+  }
+  if (!center.Found() || !optimal.Found())
+  {
+    m_logger.Error("No candidate with a comparable score.");
+    return action.FinishWithError();
+  }
+
+  metrics.Start(AgentPhase::Write);
+  ScStructure resultStruct = m_context.GenerateStructure();
+
+  if (asMatrix)
+  {
+    //действие => nrel_distance_matrix: матрица
+    ScAddr const link = matrix.GenerateLink(m_context);
+    ScAddr const arc = m_context.GenerateConnector(ScType::ConstCommonArc, actionNode, link);
+    ScAddr const relArc =
+        m_context.GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_distance_matrix, arc);
+    resultStruct << link << arc << relArc << AmbulanceKeynodes::nrel_distance_matrix;
+  }
+
+  for (size_t i = 0; i < size; ++i)
+  {
+    ScAddr link, arc;
+    //ссылки состояния переписываются через него, иначе агент центра сочтет их неизменными
+    if (state != nullptr)
+      state->WriteEccentricity(m_context, villages.addrs[i], eccentricities[i], link, arc);
+    else if (upsert)
+      ResultLinks::UpsertProperty(
+          m_context, villages.addrs[i], AmbulanceKeynodes::nrel_eccentricity, eccentricities[i], link, arc);
+    else
+    {
+      link = NumericLink::Generate(m_context, eccentricities[i]);
+      arc = m_context.GenerateConnector(ScType::ConstCommonArc, villages.addrs[i], link);
+      m_context.GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_eccentricity, arc);
+    }
+    resultStruct << link << arc;
+  }
+
+  std::pair<ScAddr, size_t> const winners[] = {
+      {AmbulanceKeynodes::nrel_graph_center, center.index}, {AmbulanceKeynodes::nrel_optimal_location, optimal.index}};
+  for (auto const & [relation, index] : winners)
+  {
+    ScAddr const resArc = m_context.GenerateConnector(ScType::ConstCommonArc, actionNode, villages.addrs[index]);
+    ScAddr const relArc = m_context.GenerateConnector(ScType::ConstPermPosArc, relation, resArc);
+    resultStruct << villages.addrs[index] << resArc << relArc << relation;
+  }
+
+  //проблемные зоны относительно найденной станции и уже размещенных станций
+  metrics.Start(AgentPhase::Compute);
+  std::vector<size_t> const stations = ProblemZones::CollectStations(m_context, villages, optimal.index);
+  ProblemZoneResult const zones = ProblemZones::Find(settings, villages, stations, roads.get());
+  metrics.Start(AgentPhase::Write);
+  ProblemZones::Write(m_context, actionNode, villages, zones, resultStruct);
+
+  //матрица или пары, ссылки эксцентриситетов, дуги победителей и проблемные зоны
+  size_t written = asMatrix ? 3 : writer.GetWrittenCount() * DistanceWriter::kElementsPerPair + updated;
+  written += size * (upsert ? 1 : 3) + 4 + ProblemZones::CountWritten(zones);
+  metrics.Add(AgentCounter::PairsEvaluated, size * size);
+  metrics.Add(AgentCounter::ElementsWritten, written);
+  metrics.AttachIfRequested(parameters, actionNode, resultStruct);
+
+  action.SetResult(resultStruct);
+
+  m_logger.Info(
+      "Pipeline finished. Villages: " + std::to_string(size) + ", pairs written: "
+      + std::to_string(asMatrix ? DistanceMatrix::PairCount(size) : writer.GetWrittenCount() + updated)
+      + ", duplicates removed: " + std::to_string(erased) + ", radius: " + std::to_string(center.score)
+      + ", min weighted score: " + std::to_string(optimal.score)
+      + ", problem zones: " + std::to_string(zones.zones.size()));
+  return action.FinishSuccessfully();
+}
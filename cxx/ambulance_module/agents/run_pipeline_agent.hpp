@@ -0,0 +1,20 @@
+#pragma once
+
+#include <sc-memory/sc_agent.hpp>
+
+#include "keynodes/ambulance_keynodes.hpp"
+
+namespace ambulance_module
+{
+
+//расстояния, центр, оптимальная станция и проблемные зоны за одно действие:
+//снимок загружается один раз, эксцентриситеты и суммы считаются по одним и тем же строкам
+class RunPipelineAgent : public ScActionInitiatedAgent
+{
+public:
+  ScAddr GetActionClass() const override;
+
+  ScResult DoProgram(ScAction & action) override;
+};
+
+}
@@ -1,14 +1,114 @@
 #include "ambulance_module.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+
 #include "agents/calculate_distances_agent.hpp"
 #include "agents/find_center_agent.hpp"
+#include "agents/find_nearby_villages_agent.hpp"
 #include "agents/find_optimal_agent.hpp" 
 #include "agents/find_problem_zones_agent.hpp"
+#include "agents/import_villages_agent.hpp"
+#include "agents/place_stations_agent.hpp"
+#include "agents/purge_results_agent.hpp"
+#include "agents/run_pipeline_agent.hpp"
 #include "keynodes/ambulance_keynodes.hpp"
+#include "utils/agent_metrics.hpp"
+#include "utils/incremental_state.hpp"
+#include "utils/module_snapshot.hpp"
+#include "utils/road_network.hpp"
+#include "utils/thread_pool.hpp"
+#include "utils/village_cache.hpp"
 
 using namespace ambulance_module;
 
 SC_MODULE_REGISTER(AmbulanceModule)
     ->Agent<CalculateDistancesAgent>()
     ->Agent<FindCenterAgent>()
+    ->Agent<FindNearbyVillagesAgent>()
     ->Agent<FindOptimalAgent>()
-    ->Agent<FindProblemZonesAgent>();
+    ->Agent<FindProblemZonesAgent>()
+    ->Agent<ImportVillagesAgent>()
+    ->Agent<PlaceStationsAgent>()
+    ->Agent<PurgeResultsAgent>()
+    ->Agent<RunPipelineAgent>();
+
+void AmbulanceModule::SetThreadCount(size_t threadCount)
+{
+  ThreadPool::SetSharedThreadCount(threadCount);
+}
+
+void AmbulanceModule::Initialize(ScMemoryContext *)
+{
+  //число потоков можно задать переменной окружения, по умолчанию - все ядра
+  if (char const * threads = std::getenv("AMBULANCE_MODULE_THREADS"))
+    SetThreadCount(std::strtoul(threads, nullptr, 10));
+
+  //метрики агентов переписываются в файл после каждого выполнения (для node_exporter textfile)
+  if (char const * metricsFile = std::getenv("AMBULANCE_MODULE_METRICS_FILE"))
+    AgentMetrics::SetDumpPath(metricsFile);
+
+  //снимок прошлого запуска: деревни, инкрементальные значения и маршруты без пересчета
+  ModuleSnapshotContent restored;
+  bool loaded = false;
+  if (char const * snapshotFile = std::getenv("AMBULANCE_MODULE_SNAPSHOT_FILE"))
+  {
+    m_snapshotPath = snapshotFile;
+    std::string error;
+    loaded = ModuleSnapshot::Load(m_snapshotPath, restored, error);
+    if (!loaded)
+      ScMemory::ms_globalLogger.Warning(
+          "Module snapshot is not loaded, villages are read from the knowledge base: " + error);
+  }
+
+  //кэш деревень общий для всех агентов модуля
+  m_villageCache = std::make_shared<VillageCache>();
+  std::string rejection;
+  bool const accepted = m_villageCache->Initialize(loaded ? &restored : nullptr, &rejection);
+  VillageCache::SetActive(m_villageCache);
+
+  //результаты агентов пересчитываются по изменениям между действиями
+  m_incrementalState = std::make_shared<IncrementalState>();
+  if (accepted)
+  {
+    m_incrementalState->Restore(restored);
+    if (restored.hasRoads)
+      RoadMetric::Restore(std::move(restored.roadGraph), std::move(restored.roadMatrix));
+  }
+  else if (loaded)
+  {
+    //база знаний изменилась после сохранения
+    ScMemory::ms_globalLogger.Info("Module snapshot " + m_snapshotPath + " is outdated and removed: " + rejection);
+    std::remove(m_snapshotPath.c_str());
+  }
+  IncrementalState::SetActive(m_incrementalState);
+}
+
+void AmbulanceModule::Shutdown(ScMemoryContext *)
+{
+  if (!m_snapshotPath.empty() && m_villageCache != nullptr)
+  {
+    ModuleSnapshotContent content;
+    m_villageCache->Export(content);
+    m_incrementalState->Export(content.villages, content);
+    //метрика сохраняется, только если посчитана для текущих деревень
+    std::shared_ptr<RoadMetric const> const metric = RoadMetric::GetCached();
+    if (metric != nullptr && metric->GetMatrix().GetAddrs() == content.villages.addrs)
+    {
+      content.hasRoads = true;
+      content.roadGraph = metric->GetGraph();
+      content.roadMatrix = metric->GetMatrix();
+    }
+    std::string error;
+    if (!ModuleSnapshot::Save(m_snapshotPath, content, error))
+      ScMemory::ms_globalLogger.Error("Module snapshot is not saved: " + error);
+  }
+
+  IncrementalState::SetActive(nullptr);
+  m_incrementalState.reset();
+
+  VillageCache::SetActive(nullptr);
+  if (m_villageCache != nullptr)
+    m_villageCache->Shutdown();
+  m_villageCache.reset();
+}
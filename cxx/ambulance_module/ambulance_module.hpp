@@ -1,12 +1,31 @@
 #pragma once
 
+#include <cstddef>
+#include <memory>
+#include <string>
+
 #include <sc-memory/sc_module.hpp>
 
 namespace ambulance_module
 {
 
+class IncrementalState;
+class VillageCache;
+
 class AmbulanceModule : public ScModule
 {
+public:
+  void Initialize(ScMemoryContext * context) override;
+  void Shutdown(ScMemoryContext * context) override;
+
+  //число потоков для параллельной оценки кандидатов (0 - по числу ядер)
+  static void SetThreadCount(size_t threadCount);
+
+private:
+  std::shared_ptr<VillageCache> m_villageCache;
+  std::shared_ptr<IncrementalState> m_incrementalState;
+  //снимок модуля между запусками (пусто - не сохраняется)
+  std::string m_snapshotPath;
 };
 
 } 
@@ -0,0 +1,127 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "bench/bench_fixture.hpp"
+#include "keynodes/ambulance_keynodes.hpp"
+
+using namespace ambulance_module;
+
+namespace
+{
+
+//размеры для агентов без O(n^2) записи; второй аргумент - VillageLayout
+std::vector<int64_t> const kScalableSizes = {100, 1000, 10000, 100000};
+//агенты, которые пишут все пары или перебирают обмены станций
+std::vector<int64_t> const kQuadraticSizes = {100, 1000, 5000};
+std::vector<int64_t> const kLayouts = {
+    static_cast<int64_t>(VillageLayout::Uniform), static_cast<int64_t>(VillageLayout::Clustered)};
+
+}  // namespace
+
+BENCHMARK_DEFINE_F(VillageBench, FindCenter)(benchmark::State & state)
+{
+  for (auto _ : state)
+  {
+    ScAction action = m_ctx->GenerateAction(AmbulanceKeynodes::action_find_graph_center);
+    RunAction(state, action, AmbulanceKeynodes::action_find_graph_center);
+  }
+  ReportPhases(state);
+}
+
+BENCHMARK_DEFINE_F(VillageBench, FindOptimal)(benchmark::State & state)
+{
+  for (auto _ : state)
+  {
+    ScAction action = m_ctx->GenerateAction(AmbulanceKeynodes::action_find_optimal_station);
+    RunAction(state, action, AmbulanceKeynodes::action_find_optimal_station);
+  }
+  ReportPhases(state);
+}
+
+BENCHMARK_DEFINE_F(VillageBench, FindProblemZones)(benchmark::State & state)
+{
+  //станции - каждая сотая деревня, зоны - вне радиуса выезда
+  for (size_t i = 0; i < m_villages.size(); i += 100)
+    m_ctx->GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::concept_ambulance_station, m_villages[i]);
+
+  for (auto _ : state)
+  {
+    ScAction action = m_ctx->GenerateAction(AmbulanceKeynodes::action_find_problem_zones);
+    m_ctx->GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::mode_coverage, action);
+    SetNumber(action, AmbulanceKeynodes::rrel_radius, 50.0);
+    RunAction(state, action, AmbulanceKeynodes::action_find_problem_zones);
+  }
+  ReportPhases(state);
+}
+
+BENCHMARK_DEFINE_F(VillageBench, FindNearbyVillages)(benchmark::State & state)
+{
+  for (auto _ : state)
+  {
+    ScAction action = m_ctx->GenerateAction(AmbulanceKeynodes::action_find_nearby_villages);
+    action.SetArguments(m_villages.front());
+    SetNumber(action, AmbulanceKeynodes::rrel_neighbour_count, 10.0);
+    RunAction(state, action, AmbulanceKeynodes::action_find_nearby_villages);
+  }
+  ReportPhases(state);
+}
+
+BENCHMARK_DEFINE_F(VillageBench, PlaceStations)(benchmark::State & state)
+{
+  for (auto _ : state)
+  {
+    ScAction action = m_ctx->GenerateAction(AmbulanceKeynodes::action_place_stations);
+    SetNumber(action, AmbulanceKeynodes::rrel_station_count, 8.0);
+    RunAction(state, action, AmbulanceKeynodes::action_place_stations);
+  }
+  ReportPhases(state);
+}
+
+BENCHMARK_DEFINE_F(VillageBench, RunPipeline)(benchmark::State & state)
+{
+  for (auto _ : state)
+  {
+    ScAction action = m_ctx->GenerateAction(AmbulanceKeynodes::action_run_pipeline);
+    m_ctx->GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::mode_distance_matrix, action);
+    RunAction(state, action, AmbulanceKeynodes::action_run_pipeline);
+  }
+  ReportPhases(state);
+}
+
+BENCHMARK_REGISTER_F(VillageBench, FindCenter)
+    ->ArgsProduct({kScalableSizes, kLayouts})
+    ->Iterations(1)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_REGISTER_F(VillageBench, FindOptimal)
+    ->ArgsProduct({kScalableSizes, kLayouts})
+    ->Iterations(1)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_REGISTER_F(VillageBench, FindProblemZones)
+    ->ArgsProduct({kScalableSizes, kLayouts})
+    ->Iterations(1)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_REGISTER_F(VillageBench, FindNearbyVillages)
+    ->ArgsProduct({kScalableSizes, kLayouts})
+    ->Iterations(1)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_REGISTER_F(VillageBench, PlaceStations)
+    ->ArgsProduct({kQuadraticSizes, kLayouts})
+    ->Iterations(1)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_REGISTER_F(VillageBench, RunPipeline)
+    ->ArgsProduct({kQuadraticSizes, kLayouts})
+    ->Iterations(1)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <sc-memory/sc_agent.hpp>
+#include <sc-memory/sc_memory.hpp>
+
+#include "agents/calculate_distances_agent.hpp"
+#include "agents/find_center_agent.hpp"
+#include "agents/find_nearby_villages_agent.hpp"
+#include "agents/find_optimal_agent.hpp"
+#include "agents/find_problem_zones_agent.hpp"
+#include "agents/place_stations_agent.hpp"
+#include "agents/run_pipeline_agent.hpp"
+#include "bench/village_generator.hpp"
+#include "keynodes/ambulance_keynodes.hpp"
+#include "utils/numeric_link.hpp"
+#include "utils/agent_metrics.hpp"
+
+namespace ambulance_module
+{
+
+//каждый прогон получает чистую sc-память с деревнями: range(0) - число деревень,
+//range(1) - VillageLayout
+class VillageBench : public benchmark::Fixture
+{
+public:
+  void SetUp(benchmark::State const & state) override
+  {
+    sc_memory_params params;
+    sc_memory_params_clear(&params);
+    params.clear = SC_TRUE;
+    params.dump_memory = SC_FALSE;
+    params.dump_memory_statistics = SC_FALSE;
+    params.storage = "ambulance-bench-storage";
+    //на 10k деревень нужно порядка 250M элементов
+    params.max_loaded_segments = 8192;
+
+    ScMemory::LogMute();
+    ScMemory::Initialize(params);
+    m_ctx = std::make_unique<ScAgentContext>();
+    m_ctx->SubscribeAgent<CalculateDistancesAgent>();
+    m_ctx->SubscribeAgent<FindCenterAgent>();
+    m_ctx->SubscribeAgent<FindNearbyVillagesAgent>();
+    m_ctx->SubscribeAgent<FindOptimalAgent>();
+    m_ctx->SubscribeAgent<FindProblemZonesAgent>();
+    m_ctx->SubscribeAgent<PlaceStationsAgent>();
+    m_ctx->SubscribeAgent<RunPipelineAgent>();
+
+    GeneratedVillages const generated =
+        GenerateVillages(static_cast<size_t>(state.range(0)), static_cast<VillageLayout>(state.range(1)));
+    m_villages.reserve(generated.x.size());
+    for (size_t i = 0; i < generated.x.size(); ++i)
+      m_villages.push_back(CreateVillage(generated.x[i], generated.y[i], generated.population[i]));
+  }
+
+  void TearDown(benchmark::State const &) override
+  {
+    m_ctx->UnsubscribeAgent<RunPipelineAgent>();
+    m_ctx->UnsubscribeAgent<PlaceStationsAgent>();
+    m_ctx->UnsubscribeAgent<FindProblemZonesAgent>();
+    m_ctx->UnsubscribeAgent<FindOptimalAgent>();
+    m_ctx->UnsubscribeAgent<FindNearbyVillagesAgent>();
+    m_ctx->UnsubscribeAgent<FindCenterAgent>();
+    m_ctx->UnsubscribeAgent<CalculateDistancesAgent>();
+    m_villages.clear();
+    m_ctx.reset();
+    ScMemory::Shutdown(false);
+  }
+
+protected:
+  ScAddr CreateVillage(double x, double y, double population)
+  {
+    ScAddr const village = m_ctx->GenerateNode(ScType::ConstNode);
+    m_ctx->GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::concept_village, village);
+
+    auto AddProperty = [&](ScAddr const & rel, double value) {
+      ScAddr const link = NumericLink::Generate(*m_ctx, value);
+      ScAddr const arc = m_ctx->GenerateConnector(ScType::ConstCommonArc, village, link);
+      m_ctx->GenerateConnector(ScType::ConstPermPosArc, rel, arc);
+    };
+    AddProperty(AmbulanceKeynodes::nrel_coordinate_x, x);
+    AddProperty(AmbulanceKeynodes::nrel_coordinate_y, y);
+    AddProperty(AmbulanceKeynodes::nrel_population, population);
+    return village;
+  }
+
+  //числовой параметр действия: action -> role: [число]
+  void SetNumber(ScAddr const & action, ScAddr const & role, double value)
+  {
+    ScAddr const link = NumericLink::Generate(*m_ctx, value);
+    ScAddr const arc = m_ctx->GenerateConnector(ScType::ConstPermPosArc, action, link);
+    m_ctx->GenerateConnector(ScType::ConstPermPosArc, role, arc);
+  }
+
+  //запускает действие и копит этапы DoProgram в счетчики load/compute/write (секунды на итерацию)
+  void RunAction(benchmark::State & state, ScAction & action, ScAddr const & actionClass)
+  {
+    uint64_t const runs = AgentMetrics::GetTotals(actionClass).runs;
+    bool const finished = action.InitiateAndWait(24 * 60 * 60 * 1000);
+    if (!finished || !action.IsFinishedSuccessfully())
+    {
+      state.SkipWithError("Action did not finish successfully");
+      return;
+    }
+
+    //этапы записываются при выходе из DoProgram, чуть позже завершения действия
+    AgentTotals totals = AgentMetrics::GetTotals(actionClass);
+    while (totals.runs == runs)
+    {
+      std::this_thread::yield();
+      totals = AgentMetrics::GetTotals(actionClass);
+    }
+    m_phases[0] += totals.last.seconds[static_cast<size_t>(AgentPhase::Load)];
+    m_phases[1] += totals.last.seconds[static_cast<size_t>(AgentPhase::Compute)];
+    m_phases[2] += totals.last.seconds[static_cast<size_t>(AgentPhase::Write)];
+  }
+
+  //счетчики этапов и размера входа; в JSON они попадают рядом со временем
+  void ReportPhases(benchmark::State & state)
+  {
+    char const * const names[] = {"load_s", "compute_s", "write_s"};
+    for (size_t i = 0; i < 3; ++i)
+    {
+      state.counters[names[i]] = benchmark::Counter(m_phases[i], benchmark::Counter::kAvgIterations);
+      m_phases[i] = 0.0;
+    }
+    state.counters["villages"] = static_cast<double>(m_villages.size());
+  }
+
+  std::unique_ptr<ScAgentContext> m_ctx;
+  std::vector<ScAddr> m_villages;
+  double m_phases[3] = {0.0, 0.0, 0.0};
+};
+
+}  // namespace ambulance_module
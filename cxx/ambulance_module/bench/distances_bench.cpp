@@ -0,0 +1,29 @@
+#include <benchmark/benchmark.h>
+
+#include "bench/bench_fixture.hpp"
+#include "keynodes/ambulance_keynodes.hpp"
+
+using namespace ambulance_module;
+
+BENCHMARK_DEFINE_F(VillageBench, CalculateDistances)(benchmark::State & state)
+{
+  int64_t const villages = state.range(0);
+  int64_t const pairs = villages * (villages - 1) / 2;
+
+  for (auto _ : state)
+  {
+    ScAction action = m_ctx->GenerateAction(AmbulanceKeynodes::action_calculate_distances);
+    RunAction(state, action, AmbulanceKeynodes::action_calculate_distances);
+  }
+
+  ReportPhases(state);
+  state.counters["pairs"] = static_cast<double>(pairs);
+  state.counters["pairs_per_second"] =
+      benchmark::Counter(static_cast<double>(pairs), benchmark::Counter::kIsIterationInvariantRate);
+}
+
+BENCHMARK_REGISTER_F(VillageBench, CalculateDistances)
+    ->ArgsProduct({{1000, 5000, 10000}, {static_cast<int64_t>(VillageLayout::Uniform)}})
+    ->Iterations(1)
+    ->UseRealTime()
+    ->Unit(benchmark::kSecond);
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace ambulance_module
+{
+
+enum class VillageLayout : int64_t
+{
+  Uniform = 0,    //равномерно по квадрату
+  Clustered = 1,  //нормальные облака вокруг случайных центров, крупные деревни ближе к центру
+};
+
+struct GeneratedVillages
+{
+  std::vector<double> x;
+  std::vector<double> y;
+  std::vector<double> population;
+};
+
+//синтетические деревни в квадрате [0, 1000]^2, детерминированно по seed
+inline GeneratedVillages GenerateVillages(size_t count, VillageLayout layout, uint64_t seed = 42)
+{
+  double const side = 1000.0;
+  std::mt19937_64 random(seed);
+  std::uniform_real_distribution<double> coordinate(0.0, side);
+  std::uniform_int_distribution<int> population(50, 5000);
+
+  GeneratedVillages villages;
+  villages.x.reserve(count);
+  villages.y.reserve(count);
+  villages.population.reserve(count);
+
+  if (layout == VillageLayout::Uniform)
+  {
+    for (size_t i = 0; i < count; ++i)
+    {
+      villages.x.push_back(coordinate(random));
+      villages.y.push_back(coordinate(random));
+      villages.population.push_back(population(random));
+    }
+    return villages;
+  }
+
+  //около sqrt(n) / 4 облаков, как у районов вокруг городов
+  size_t const clusters = std::max<size_t>(1, static_cast<size_t>(std::sqrt(static_cast<double>(count)) / 4.0));
+  std::vector<double> centerX(clusters);
+  std::vector<double> centerY(clusters);
+  for (size_t c = 0; c < clusters; ++c)
+  {
+    centerX[c] = coordinate(random);
+    centerY[c] = coordinate(random);
+  }
+
+  double const spread = side / 40.0;
+  std::normal_distribution<double> offset(0.0, spread);
+  std::uniform_int_distribution<size_t> cluster(0, clusters - 1);
+  for (size_t i = 0; i < count; ++i)
+  {
+    size_t const c = cluster(random);
+    double const dx = offset(random);
+    double const dy = offset(random);
+    villages.x.push_back(std::clamp(centerX[c] + dx, 0.0, side));
+    villages.y.push_back(std::clamp(centerY[c] + dy, 0.0, side));
+    //население убывает от центра облака
+    double const falloff = std::exp(-(dx * dx + dy * dy) / (2.0 * spread * spread));
+    villages.population.push_back(std::round(population(random) * (0.2 + falloff)));
+  }
+  return villages;
+}
+
+}  // namespace ambulance_module
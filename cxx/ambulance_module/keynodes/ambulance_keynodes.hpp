@@ -16,10 +16,26 @@ public:
 
   static inline ScKeynode const action_find_problem_zones {
       "action_find_problem_zones", ScType::ConstNodeClass};
+  static inline ScKeynode const action_place_stations {
+      "action_place_stations", ScType::ConstNodeClass};
+  static inline ScKeynode const action_purge_results {
+      "action_purge_results", ScType::ConstNodeClass};
+  static inline ScKeynode const action_find_nearby_villages {
+      "action_find_nearby_villages", ScType::ConstNodeClass};
+  static inline ScKeynode const action_run_pipeline {
+      "action_run_pipeline", ScType::ConstNodeClass};
+  static inline ScKeynode const action_import_villages {
+      "action_import_villages", ScType::ConstNodeClass};
 
 
   static inline ScKeynode const concept_village {
       "concept_village", ScType::ConstNodeClass};
+  static inline ScKeynode const concept_ambulance_station {
+      "concept_ambulance_station", ScType::ConstNodeClass};
+  static inline ScKeynode const concept_cancelled_action {
+      "concept_cancelled_action", ScType::ConstNodeClass};
+  static inline ScKeynode const concept_approximate_action {
+      "concept_approximate_action", ScType::ConstNodeClass};
 
   static inline ScKeynode const nrel_population {
       "nrel_population", ScType::ConstNodeNonRole};
@@ -41,5 +57,85 @@ public:
 
   static inline ScKeynode const nrel_problem_zone {
       "nrel_problem_zone", ScType::ConstNodeNonRole};
+
+  static inline ScKeynode const nrel_distance_matrix {
+      "nrel_distance_matrix", ScType::ConstNodeNonRole};
+  static inline ScKeynode const nrel_geometric_median {
+      "nrel_geometric_median", ScType::ConstNodeNonRole};
+  static inline ScKeynode const nrel_ambulance_station {
+      "nrel_ambulance_station", ScType::ConstNodeNonRole};
+  static inline ScKeynode const nrel_road {
+      "nrel_road", ScType::ConstNodeNonRole};
+  static inline ScKeynode const nrel_travel_time {
+      "nrel_travel_time", ScType::ConstNodeNonRole};
+  static inline ScKeynode const nrel_nearby_village {
+      "nrel_nearby_village", ScType::ConstNodeNonRole};
+  static inline ScKeynode const nrel_uncovered_population {
+      "nrel_uncovered_population", ScType::ConstNodeNonRole};
+  static inline ScKeynode const nrel_metrics {
+      "nrel_metrics", ScType::ConstNodeNonRole};
+  static inline ScKeynode const nrel_candidate_ranking {
+      "nrel_candidate_ranking", ScType::ConstNodeNonRole};
+  static inline ScKeynode const nrel_candidate_score {
+      "nrel_candidate_score", ScType::ConstNodeNonRole};
+  static inline ScKeynode const nrel_progress {
+      "nrel_progress", ScType::ConstNodeNonRole};
+  static inline ScKeynode const nrel_progress_total {
+      "nrel_progress_total", ScType::ConstNodeNonRole};
+  static inline ScKeynode const nrel_error_bound {
+      "nrel_error_bound", ScType::ConstNodeNonRole};
+  static inline ScKeynode const nrel_data_generation {
+      "nrel_data_generation", ScType::ConstNodeNonRole};
+
+  static inline ScKeynode const rrel_station_count {
+      "rrel_station_count", ScType::ConstNodeRole};
+  static inline ScKeynode const rrel_radius {
+      "rrel_radius", ScType::ConstNodeRole};
+  static inline ScKeynode const rrel_neighbour_count {
+      "rrel_neighbour_count", ScType::ConstNodeRole};
+  static inline ScKeynode const rrel_station_capacity {
+      "rrel_station_capacity", ScType::ConstNodeRole};
+  static inline ScKeynode const rrel_villages {
+      "rrel_villages", ScType::ConstNodeRole};
+  static inline ScKeynode const rrel_min_x {
+      "rrel_min_x", ScType::ConstNodeRole};
+  static inline ScKeynode const rrel_max_x {
+      "rrel_max_x", ScType::ConstNodeRole};
+  static inline ScKeynode const rrel_min_y {
+      "rrel_min_y", ScType::ConstNodeRole};
+  static inline ScKeynode const rrel_max_y {
+      "rrel_max_y", ScType::ConstNodeRole};
+  static inline ScKeynode const rrel_top_k {
+      "rrel_top_k", ScType::ConstNodeRole};
+  static inline ScKeynode const rrel_time_budget {
+      "rrel_time_budget", ScType::ConstNodeRole};
+  static inline ScKeynode const rrel_accuracy {
+      "rrel_accuracy", ScType::ConstNodeRole};
+
+
+  static inline ScKeynode const mode_distance_matrix {
+      "mode_distance_matrix", ScType::ConstNodeClass};
+  static inline ScKeynode const mode_single_precision {
+      "mode_single_precision", ScType::ConstNodeClass};
+  static inline ScKeynode const mode_convex_hull {
+      "mode_convex_hull", ScType::ConstNodeClass};
+  static inline ScKeynode const mode_continuous_median {
+      "mode_continuous_median", ScType::ConstNodeClass};
+  static inline ScKeynode const mode_pruned_median {
+      "mode_pruned_median", ScType::ConstNodeClass};
+  static inline ScKeynode const mode_p_center {
+      "mode_p_center", ScType::ConstNodeClass};
+  static inline ScKeynode const mode_road_metric {
+      "mode_road_metric", ScType::ConstNodeClass};
+  static inline ScKeynode const mode_upsert {
+      "mode_upsert", ScType::ConstNodeClass};
+  static inline ScKeynode const mode_coverage {
+      "mode_coverage", ScType::ConstNodeClass};
+  static inline ScKeynode const mode_metrics {
+      "mode_metrics", ScType::ConstNodeClass};
+  static inline ScKeynode const mode_progress {
+      "mode_progress", ScType::ConstNodeClass};
+  static inline ScKeynode const mode_approximate {
+      "mode_approximate", ScType::ConstNodeClass};
 };
 }
@@ -7,9 +7,40 @@
 #include "agents/find_optimal_agent.hpp"
 #include "agents/calculate_distances_agent.hpp"
 #include "agents/find_center_agent.hpp"
+#include "agents/find_nearby_villages_agent.hpp"
 #include "agents/find_problem_zones_agent.hpp"
+#include "agents/import_villages_agent.hpp"
+#include "agents/place_stations_agent.hpp"
+#include "agents/purge_results_agent.hpp"
+#include "agents/run_pipeline_agent.hpp"
 
 #include "keynodes/ambulance_keynodes.hpp"
+#include "utils/candidate_search.hpp"
+#include "utils/convex_hull.hpp"
+#include "utils/distance_kernel.hpp"
+#include "utils/distance_matrix.hpp"
+#include "utils/incremental_state.hpp"
+#include "utils/kd_tree.hpp"
+#include "utils/agent_metrics.hpp"
+#include "utils/module_snapshot.hpp"
+#include "utils/numeric_link.hpp"
+#include "utils/station_placement.hpp"
+#include "utils/thread_pool.hpp"
+#include "utils/village_cache.hpp"
+#include "utils/village_import.hpp"
+#include "utils/village_loader.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <random>
+#include <set>
+#include <thread>
 
 using namespace ambulance_module;
 
@@ -24,11 +55,22 @@ protected:
       m_ctx->SubscribeAgent<CalculateDistancesAgent>();
       m_ctx->SubscribeAgent<FindCenterAgent>();
       m_ctx->SubscribeAgent<FindProblemZonesAgent>();
+      m_ctx->SubscribeAgent<PlaceStationsAgent>();
+      m_ctx->SubscribeAgent<PurgeResultsAgent>();
+      m_ctx->SubscribeAgent<FindNearbyVillagesAgent>();
+      m_ctx->SubscribeAgent<RunPipelineAgent>();
+      m_ctx->SubscribeAgent<ImportVillagesAgent>();
   }
 
   void TearDown() override
   {
   //отписываем агентов
+      IncrementalState::SetActive(nullptr);
+      m_ctx->UnsubscribeAgent<ImportVillagesAgent>();
+      m_ctx->UnsubscribeAgent<RunPipelineAgent>();
+      m_ctx->UnsubscribeAgent<FindNearbyVillagesAgent>();
+      m_ctx->UnsubscribeAgent<PurgeResultsAgent>();
+      m_ctx->UnsubscribeAgent<PlaceStationsAgent>();
       m_ctx->UnsubscribeAgent<FindProblemZonesAgent>();
       m_ctx->UnsubscribeAgent<FindCenterAgent>();
       m_ctx->UnsubscribeAgent<CalculateDistancesAgent>();
@@ -70,13 +112,10 @@ protected:
   //читаем число из ссылки
   double GetLinkValue(ScAddr const & linkAddr)
   {
-      std::string content;
-      m_ctx->GetLinkContent(linkAddr, content);
-      try {
-          return std::stod(content);
-      } catch(...) {
+      double value = -1.0;
+      if (!NumericLink::Read(*m_ctx, linkAddr, value))
           return -1.0;
-      }
+      return value;
   }
 };
 
@@ -238,3 +277,1589 @@ TEST_F(AmbulanceAgentTest, FindProblemZonesSuccess)
     );
     EXPECT_FALSE(itNear->Next()) << "Near village НЕ должна быть проблемной зоной";
 }
+
+//загрузка деревень с неполными и битыми данными
+TEST_F(AmbulanceAgentTest, VillageLoaderReportsBrokenRecords)
+{
+    ScAddr vGood = CreateVillage("Good", 1.0, 2.0, 300);
+
+    //деревня без населения
+    ScAddr vPartial = m_ctx->GenerateNode(ScType::ConstNode);
+    m_ctx->GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::concept_village, vPartial);
+
+    //деревня с нечисловой координатой
+    ScAddr vBroken = CreateVillage("Broken", 0.0, 0.0, 100);
+    ScIterator5Ptr itX = m_ctx->CreateIterator5(
+        vBroken, ScType::ConstCommonArc, ScType::NodeLink, ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_coordinate_x
+    );
+    EXPECT_TRUE(itX->Next());
+    m_ctx->SetLinkContent(itX->Get(2), std::string("north"));
+
+    VillageLoadReport report;
+    VillageSnapshot snapshot = VillageLoader::Load(*m_ctx, report);
+
+    EXPECT_EQ(report.total, 3u);
+    EXPECT_EQ(report.incomplete, 1u);
+    EXPECT_EQ(report.malformed, 1u);
+    ASSERT_EQ(snapshot.Size(), 1u);
+    EXPECT_EQ(snapshot.addrs[0], vGood);
+    EXPECT_DOUBLE_EQ(snapshot.x[0], 1.0);
+    EXPECT_DOUBLE_EQ(snapshot.y[0], 2.0);
+    EXPECT_DOUBLE_EQ(snapshot.population[0], 300.0);
+    EXPECT_EQ(snapshot.IndexOf(vPartial), snapshot.Size());
+}
+
+//свойства деревни за один обход: посторонние дуги пропускаются, каждое отношение - своим статусом
+TEST_F(AmbulanceAgentTest, VillageLoaderReadsPropertiesInOneSweep)
+{
+    ScAddr village = CreateVillage("Sweep", 4.0, -2.0, 70);
+    ScAddr extra = NumericLink::Generate(*m_ctx, 123.0);
+    ScAddr extraArc = m_ctx->GenerateConnector(ScType::ConstCommonArc, village, extra);
+    m_ctx->GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_eccentricity, extraArc);
+
+    double x = 0.0;
+    double y = 0.0;
+    double population = 0.0;
+    ScAddrVector links;
+    EXPECT_EQ(VillageLoader::ReadVillage(*m_ctx, village, x, y, population, &links), VillageRecordStatus::Ok);
+    EXPECT_DOUBLE_EQ(x, 4.0);
+    EXPECT_DOUBLE_EQ(y, -2.0);
+    EXPECT_DOUBLE_EQ(population, 70.0);
+    EXPECT_EQ(links.size(), 3u);
+    EXPECT_EQ(std::count(links.begin(), links.end(), extra), 0);
+
+    ScAddr const relations[] = {
+        AmbulanceKeynodes::nrel_population, AmbulanceKeynodes::nrel_travel_time, AmbulanceKeynodes::nrel_eccentricity};
+    double values[3] = {0.0, 0.0, 0.0};
+    VillageRecordStatus statuses[3];
+    ScAddr found[3];
+    VillageLoader::ReadProperties(*m_ctx, village, relations, 3, values, statuses, found);
+    EXPECT_EQ(statuses[0], VillageRecordStatus::Ok);
+    EXPECT_DOUBLE_EQ(values[0], 70.0);
+    EXPECT_EQ(statuses[1], VillageRecordStatus::Incomplete);
+    EXPECT_FALSE(found[1].IsValid());
+    EXPECT_EQ(statuses[2], VillageRecordStatus::Ok);
+    EXPECT_DOUBLE_EQ(values[2], 123.0);
+    EXPECT_EQ(found[2], extra);
+}
+
+//кэш деревень обновляется по событиям
+TEST_F(AmbulanceAgentTest, VillageCacheFollowsKnowledgeBase)
+{
+    CreateVillage("Cached_A", 0.0, 0.0, 100);
+
+    VillageCache cache;
+    cache.Initialize();
+
+    VillageLoadReport report;
+    std::shared_ptr<VillageSnapshot const> first = cache.GetSnapshot(report);
+    ASSERT_EQ(first->Size(), 1u);
+
+    //события доставляются асинхронно, ждем новую версию снимка
+    auto WaitForSize = [&](size_t size) {
+        std::shared_ptr<VillageSnapshot const> snapshot;
+        for (size_t attempt = 0; attempt < 200; ++attempt) {
+            snapshot = cache.GetSnapshot(report);
+            if (snapshot->Size() == size)
+                break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return snapshot;
+    };
+
+    ScAddr vB = CreateVillage("Cached_B", 3.0, 4.0, 200);
+    std::shared_ptr<VillageSnapshot const> second = WaitForSize(2);
+    ASSERT_EQ(second->Size(), 2u);
+    EXPECT_GT(second->version, first->version);
+    EXPECT_EQ(first->Size(), 1u) << "Старый снимок не должен меняться";
+
+    size_t const index = second->IndexOf(vB);
+    ASSERT_LT(index, second->Size());
+    EXPECT_DOUBLE_EQ(second->x[index], 3.0);
+    EXPECT_DOUBLE_EQ(second->population[index], 200.0);
+    //порядок деревень - по хэшу адреса, независимо от порядка изменений
+    EXPECT_LT(second->addrs[0].Hash(), second->addrs[1].Hash());
+
+    ScIterator3Ptr itMember = m_ctx->CreateIterator3(
+        AmbulanceKeynodes::concept_village, ScType::ConstPermPosArc, vB
+    );
+    ASSERT_TRUE(itMember->Next());
+    m_ctx->EraseElement(itMember->Get(1));
+    EXPECT_EQ(WaitForSize(1)->Size(), 1u);
+
+    cache.Shutdown();
+}
+
+//числа в ссылках: бинарный формат без потерь и текст из .scs
+TEST_F(AmbulanceAgentTest, NumericLinkRoundTrip)
+{
+    double const third = 1.0 / 3.0;
+    ScAddr binary = NumericLink::Generate(*m_ctx, third);
+    EXPECT_DOUBLE_EQ(GetLinkValue(binary), third);
+    double exact = 0.0;
+    EXPECT_TRUE(NumericLink::Read(*m_ctx, binary, exact));
+    EXPECT_EQ(exact, third) << "Бинарная запись не должна терять точность";
+
+    ScAddr integer = m_ctx->GenerateLink(ScType::NodeLink);
+    EXPECT_TRUE(NumericLink::WriteInteger(*m_ctx, integer, 2500));
+    EXPECT_DOUBLE_EQ(GetLinkValue(integer), 2500.0);
+
+    ScAddr text = m_ctx->GenerateLink(ScType::NodeLink);
+    m_ctx->SetLinkContent(text, std::string(" 7.5 "));
+    EXPECT_DOUBLE_EQ(GetLinkValue(text), 7.5);
+
+    m_ctx->SetLinkContent(text, std::string("7.5km"));
+    EXPECT_FALSE(NumericLink::Read(*m_ctx, text, exact));
+}
+
+//матрица расстояний одной ссылкой и дуги только по запросу
+TEST_F(AmbulanceAgentTest, CalculateDistancesMatrixMode)
+{
+    ScAddr v1 = CreateVillage("M1", 0.0, 0.0, 100);
+    ScAddr v2 = CreateVillage("M2", 3.0, 4.0, 100);
+    ScAddr v3 = CreateVillage("M3", 6.0, 8.0, 100);
+
+    ScAction action = m_ctx->GenerateAction(AmbulanceKeynodes::action_calculate_distances);
+    m_ctx->GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::mode_distance_matrix, action);
+
+    EXPECT_TRUE(action.InitiateAndWait(2000));
+    EXPECT_TRUE(action.IsFinishedSuccessfully());
+
+    DistanceMatrix matrix;
+    ASSERT_TRUE(DistanceMatrix::LoadFromAction(*m_ctx, action, matrix));
+    EXPECT_EQ(matrix.Size(), 3u);
+    EXPECT_EQ(matrix.GetPrecision(), MatrixPrecision::Double);
+
+    double dist = 0.0;
+    EXPECT_TRUE(matrix.Find(v1, v2, dist));
+    EXPECT_DOUBLE_EQ(dist, 5.0);
+    EXPECT_TRUE(matrix.Find(v3, v1, dist));
+    EXPECT_DOUBLE_EQ(dist, 10.0);
+
+    //в матричном режиме дуги расстояний не создаются
+    ScIterator3Ptr itDist = m_ctx->CreateIterator3(
+        AmbulanceKeynodes::nrel_distance, ScType::ConstPermPosArc, ScType::ConstCommonArc
+    );
+    EXPECT_FALSE(itDist->Next());
+
+    EXPECT_EQ(matrix.Materialize(*m_ctx, {{matrix.IndexOf(v2), matrix.IndexOf(v3)}}), 1u);
+    ScIterator5Ptr it5 = m_ctx->CreateIterator5(
+        v2, ScType::ConstCommonArc, v3, ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_distance
+    );
+    EXPECT_TRUE(it5->Next());
+}
+
+//все наборы инструкций ядра дают те же расстояния, что и скалярный код
+TEST(DistanceKernelTest, IsaPathsMatchScalar)
+{
+    std::mt19937 random(7);
+    std::uniform_real_distribution<double> coordinate(-500.0, 500.0);
+    std::uniform_real_distribution<double> weight(1.0, 5000.0);
+
+    size_t const count = 37;//не кратно ширине векторов, проверяем хвосты
+    std::vector<double> xs(count), ys(count), weights(count);
+    for (size_t i = 0; i < count; ++i) {
+        xs[i] = coordinate(random);
+        ys[i] = coordinate(random);
+        weights[i] = weight(random);
+    }
+
+    DistanceKernel::SetIsa(KernelIsa::Scalar);
+    std::vector<double> expected(count);
+    DistanceKernel::Row(xs.data(), ys.data(), count, 1.5, -2.5, expected.data());
+    double const expectedMax = DistanceKernel::RowMax(xs.data(), ys.data(), count, 1.5, -2.5);
+    double const expectedSum = DistanceKernel::RowWeightedSum(xs.data(), ys.data(), weights.data(), count, 1.5, -2.5);
+    std::vector<double> expectedFast(count);
+    DistanceKernel::Row(xs.data(), ys.data(), count, 1.5, -2.5, expectedFast.data(), KernelPrecision::Fast);
+
+    for (KernelIsa isa : {KernelIsa::Scalar, KernelIsa::Avx2, KernelIsa::Avx512}) {
+        DistanceKernel::SetIsa(isa);
+        std::vector<double> row(count);
+        DistanceKernel::Row(xs.data(), ys.data(), count, 1.5, -2.5, row.data());
+        for (size_t i = 0; i < count; ++i)
+            EXPECT_EQ(row[i], expected[i]) << DistanceKernel::GetIsaName(DistanceKernel::GetIsa());
+        EXPECT_EQ(DistanceKernel::RowMax(xs.data(), ys.data(), count, 1.5, -2.5), expectedMax);
+        EXPECT_NEAR(
+            DistanceKernel::RowWeightedSum(xs.data(), ys.data(), weights.data(), count, 1.5, -2.5),
+            expectedSum, expectedSum * 1e-12);
+        EXPECT_NEAR(
+            DistanceKernel::RowMax(xs.data(), ys.data(), count, 1.5, -2.5, KernelPrecision::Fast),
+            expectedMax, expectedMax * 1e-6);
+        //быстрый режим без FMA дает одинаковые расстояния на всех путях
+        std::vector<double> fastRow(count);
+        DistanceKernel::Row(xs.data(), ys.data(), count, 1.5, -2.5, fastRow.data(), KernelPrecision::Fast);
+        for (size_t i = 0; i < count; ++i)
+            EXPECT_EQ(fastRow[i], expectedFast[i]) << DistanceKernel::GetIsaName(DistanceKernel::GetIsa());
+
+        //значения из тестов агентов остаются точными
+        double const lineX[] = {0.0, 2.0, 10.0};
+        double const lineY[] = {0.0, 0.0, 0.0};
+        EXPECT_EQ(DistanceKernel::RowMax(lineX, lineY, 3, 2.0, 0.0), 8.0);
+        EXPECT_EQ(DistanceKernel::RowMax(lineX, lineY, 1, 3.0, 4.0), 5.0);
+    }
+    DistanceKernel::SetIsa(DistanceKernel::GetSupportedIsa());
+}
+
+//при равных эксцентриситетах центр не зависит от числа потоков: побеждает меньший адрес
+TEST_F(AmbulanceAgentTest, FindCenterTieBreakIsDeterministic)
+{
+    ScAddr const corners[] = {
+        CreateVillage("Corner_1", 0.0, 0.0, 10),
+        CreateVillage("Corner_2", 1.0, 0.0, 10),
+        CreateVillage("Corner_3", 0.0, 1.0, 10),
+        CreateVillage("Corner_4", 1.0, 1.0, 10)};
+
+    ScAddr expected = corners[0];
+    for (ScAddr const & corner : corners) {
+        if (corner.Hash() < expected.Hash())
+            expected = corner;
+    }
+
+    for (size_t threads : {1u, 2u, 4u}) {
+        ThreadPool::SetSharedThreadCount(threads);
+
+        ScAction action = m_ctx->GenerateAction(AmbulanceKeynodes::action_find_graph_center);
+        EXPECT_TRUE(action.InitiateAndWait(2000));
+        EXPECT_TRUE(action.IsFinishedSuccessfully());
+
+        ScIterator5Ptr itCenter = m_ctx->CreateIterator5(
+            action, ScType::ConstCommonArc, ScType::ConstNode, ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_graph_center
+        );
+        EXPECT_TRUE(itCenter->Next());
+        EXPECT_EQ(itCenter->Get(2), expected) << "threads: " << threads;
+    }
+    ThreadPool::SetSharedThreadCount(0);
+}
+
+//пул потоков обрабатывает каждый индекс ровно один раз
+TEST(ThreadPoolTest, ParallelForVisitsEveryIndexOnce)
+{
+    ThreadPool pool(4);
+    std::vector<std::atomic<int>> visits(1000);
+    pool.ParallelFor(visits.size(), 7, [&](size_t begin, size_t end, size_t worker) {
+        EXPECT_LT(worker, pool.GetThreadCount());
+        for (size_t i = begin; i < end; ++i)
+            ++visits[i];
+    });
+    for (auto const & count : visits)
+        EXPECT_EQ(count.load(), 1);
+}
+
+//поиск центра по выпуклой оболочке дает тот же результат, что и полный перебор
+TEST_F(AmbulanceAgentTest, FindCenterConvexHullMode)
+{
+    ScAddr vA = CreateVillage("Hull_A", 0.0, 0.0, 10);
+    CreateVillage("Hull_B", 2.0, 0.0, 10);
+    CreateVillage("Hull_C", 10.0, 0.0, 10);
+    ScAddr vD = CreateVillage("Hull_D", 3.0, 1.0, 10);
+
+    ScAction action = m_ctx->GenerateAction(AmbulanceKeynodes::action_find_graph_center);
+    m_ctx->GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::mode_convex_hull, action);
+
+    EXPECT_TRUE(action.InitiateAndWait(2000));
+    EXPECT_TRUE(action.IsFinishedSuccessfully());
+
+    //эксцентриситеты: A=10, B=8, C=10, D=7.07
+    ScIterator5Ptr itCenter = m_ctx->CreateIterator5(
+        action, ScType::ConstCommonArc, ScType::ConstNode, ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_graph_center
+    );
+    EXPECT_TRUE(itCenter->Next());
+    EXPECT_EQ(itCenter->Get(2), vD);
+
+    ScIterator5Ptr itEcc = m_ctx->CreateIterator5(
+        vA, ScType::ConstCommonArc, ScType::NodeLink, ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_eccentricity
+    );
+    EXPECT_TRUE(itEcc->Next());
+    EXPECT_DOUBLE_EQ(GetLinkValue(itEcc->Get(2)), 10.0);
+}
+
+TEST(ConvexHullTest, FarthestPointIsHullVertex)
+{
+    std::mt19937 random(11);
+    std::uniform_real_distribution<double> coordinate(0.0, 100.0);
+    std::vector<double> xs(500), ys(500);
+    for (size_t i = 0; i < xs.size(); ++i) {
+        xs[i] = coordinate(random);
+        ys[i] = coordinate(random);
+    }
+
+    std::vector<size_t> const hull = ConvexHull::Build(xs, ys);
+    std::vector<double> hullX, hullY;
+    for (size_t const index : hull) {
+        hullX.push_back(xs[index]);
+        hullY.push_back(ys[index]);
+    }
+    EXPECT_LT(hull.size(), xs.size());
+
+    for (size_t i = 0; i < xs.size(); ++i) {
+        EXPECT_EQ(
+            DistanceKernel::RowMax(hullX.data(), hullY.data(), hull.size(), xs[i], ys[i]),
+            DistanceKernel::RowMax(xs.data(), ys.data(), xs.size(), xs[i], ys[i]));
+    }
+
+    //точки на одной прямой: остаются только концы
+    EXPECT_EQ(ConvexHull::Build({0.0, 1.0, 2.0, 3.0}, {0.0, 0.0, 0.0, 0.0}).size(), 2u);
+}
+
+//непрерывная медиана привязывается к ближайшей деревне, отсечение не меняет ответ
+TEST_F(AmbulanceAgentTest, FindOptimalMedianModes)
+{
+    std::mt19937 random(3);
+    std::uniform_real_distribution<double> coordinate(0.0, 100.0);
+    std::uniform_int_distribution<int> population(10, 1000);
+    for (size_t i = 0; i < 60; ++i)
+        CreateVillage("Median_" + std::to_string(i), coordinate(random), coordinate(random), population(random));
+
+    auto RunOptimal = [&](ScAddr const & mode) {
+        ScAction action = m_ctx->GenerateAction(AmbulanceKeynodes::action_find_optimal_station);
+        if (mode.IsValid())
+            m_ctx->GenerateConnector(ScType::ConstPermPosArc, mode, action);
+        EXPECT_TRUE(action.InitiateAndWait(2000));
+        EXPECT_TRUE(action.IsFinishedSuccessfully());
+
+        ScIterator5Ptr it5 = m_ctx->CreateIterator5(
+            action, ScType::ConstCommonArc, ScType::ConstNode, ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_optimal_location
+        );
+        EXPECT_TRUE(it5->Next());
+        return std::make_pair(ScAddr(action), it5->Get(2));
+    };
+
+    ScAddr const exact = RunOptimal(ScAddr::Empty).second;
+    EXPECT_EQ(RunOptimal(AmbulanceKeynodes::mode_pruned_median).second, exact);
+
+    auto const [continuousAction, snapped] = RunOptimal(AmbulanceKeynodes::mode_continuous_median);
+    EXPECT_TRUE(m_ctx->CheckConnector(AmbulanceKeynodes::concept_village, snapped, ScType::ConstPermPosArc));
+
+    ScIterator5Ptr itMedian = m_ctx->CreateIterator5(
+        continuousAction, ScType::ConstCommonArc, ScType::ConstNode, ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_geometric_median
+    );
+    ASSERT_TRUE(itMedian->Next());
+    double medianX = -1.0;
+    ScIterator5Ptr itX = m_ctx->CreateIterator5(
+        itMedian->Get(2), ScType::ConstCommonArc, ScType::NodeLink, ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_coordinate_x
+    );
+    ASSERT_TRUE(itX->Next());
+    EXPECT_TRUE(NumericLink::Read(*m_ctx, itX->Get(2), medianX));
+    EXPECT_GT(medianX, 0.0);
+    EXPECT_LT(medianX, 100.0);
+}
+
+//два удаленных скопления деревень - по станции в каждом
+TEST_F(AmbulanceAgentTest, PlaceStationsCoversClusters)
+{
+    ScAddr const west = CreateVillage("West_Center", 0.0, 0.0, 500);
+    CreateVillage("West_A", -1.0, 0.0, 100);
+    CreateVillage("West_B", 1.0, 0.0, 100);
+    CreateVillage("West_C", 0.0, 1.0, 100);
+    ScAddr const east = CreateVillage("East_Center", 50.0, 0.0, 500);
+    CreateVillage("East_A", 49.0, 0.0, 100);
+    CreateVillage("East_B", 51.0, 0.0, 100);
+    CreateVillage("East_C", 50.0, -1.0, 100);
+
+    ScAddr const modes[] = {ScAddr::Empty, AmbulanceKeynodes::mode_p_center};
+    for (ScAddr const & mode : modes)
+    {
+        ScAction action = m_ctx->GenerateAction(AmbulanceKeynodes::action_place_stations);
+        if (mode.IsValid())
+            m_ctx->GenerateConnector(ScType::ConstPermPosArc, mode, action);
+        ScAddr const count = NumericLink::Generate(*m_ctx, 2.0);
+        ScAddr const countArc = m_ctx->GenerateConnector(ScType::ConstPermPosArc, action, count);
+        m_ctx->GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::rrel_station_count, countArc);
+
+        EXPECT_TRUE(action.InitiateAndWait(2000));
+        EXPECT_TRUE(action.IsFinishedSuccessfully());
+
+        std::set<ScAddr, ScAddrLessFunc> stations;
+        ScIterator5Ptr it5 = m_ctx->CreateIterator5(
+            action, ScType::ConstCommonArc, ScType::ConstNode, ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_ambulance_station
+        );
+        while (it5->Next())
+            stations.insert(it5->Get(2));
+
+        EXPECT_EQ(stations, (std::set<ScAddr, ScAddrLessFunc>{west, east}));
+        for (ScAddr const & station : stations)
+            EXPECT_TRUE(m_ctx->CheckConnector(AmbulanceKeynodes::concept_ambulance_station, station, ScType::ConstPermPosArc));
+    }
+
+    //новое размещение снимает отметки прошлых, а отметку вручную оставляет
+    ScAddr const manual = m_ctx->SearchElementBySystemIdentifier("West_A");
+    m_ctx->GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::concept_ambulance_station, manual);
+    ScAction single = m_ctx->GenerateAction(AmbulanceKeynodes::action_place_stations);
+    ScAddr const one = NumericLink::Generate(*m_ctx, 1.0);
+    ScAddr const oneArc = m_ctx->GenerateConnector(ScType::ConstPermPosArc, single, one);
+    m_ctx->GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::rrel_station_count, oneArc);
+    EXPECT_TRUE(single.InitiateAndWait(2000));
+    EXPECT_TRUE(single.IsFinishedSuccessfully());
+
+    std::set<ScAddr, ScAddrLessFunc> tagged;
+    ScIterator3Ptr itTagged = m_ctx->CreateIterator3(
+        AmbulanceKeynodes::concept_ambulance_station, ScType::ConstPermPosArc, ScType::ConstNode
+    );
+    while (itTagged->Next())
+        tagged.insert(itTagged->Get(2));
+    EXPECT_EQ(tagged.size(), 2u);
+    EXPECT_EQ(tagged.count(manual), 1u);
+}
+
+//по дорогам A-B-C путь A-C длиннее прямой, и центр смещается в B
+TEST_F(AmbulanceAgentTest, RoadMetricChangesCenter)
+{
+    ScAddr vA = CreateVillage("Road_A", 0.0, 0.0, 10);
+    ScAddr vB = CreateVillage("Road_B", 10.0, 0.0, 10);
+    ScAddr vC = CreateVillage("Road_C", 0.0, 1.0, 10);
+
+    auto AddRoad = [&](ScAddr const & from, ScAddr const & to, double time) {
+        ScAddr const road = m_ctx->GenerateConnector(ScType::ConstCommonArc, from, to);
+        m_ctx->GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_road, road);
+        ScAddr const link = NumericLink::Generate(*m_ctx, time);
+        ScAddr const timeArc = m_ctx->GenerateConnector(ScType::ConstCommonArc, road, link);
+        m_ctx->GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_travel_time, timeArc);
+    };
+    AddRoad(vA, vB, 1.0);
+    AddRoad(vC, vB, 1.0);
+
+    auto FindCenter = [&](bool roads) {
+        ScAction action = m_ctx->GenerateAction(AmbulanceKeynodes::action_find_graph_center);
+        if (roads)
+            m_ctx->GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::mode_road_metric, action);
+        EXPECT_TRUE(action.InitiateAndWait(2000));
+        EXPECT_TRUE(action.IsFinishedSuccessfully());
+
+        ScIterator5Ptr itCenter = m_ctx->CreateIterator5(
+            action, ScType::ConstCommonArc, ScType::ConstNode, ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_graph_center
+        );
+        EXPECT_TRUE(itCenter->Next());
+        return itCenter->Get(2);
+    };
+
+    EXPECT_EQ(FindCenter(false), vA);
+    EXPECT_EQ(FindCenter(true), vB);
+
+    ScAction action = m_ctx->GenerateAction(AmbulanceKeynodes::action_calculate_distances);
+    m_ctx->GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::mode_distance_matrix, action);
+    m_ctx->GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::mode_road_metric, action);
+    EXPECT_TRUE(action.InitiateAndWait(2000));
+    EXPECT_TRUE(action.IsFinishedSuccessfully());
+
+    DistanceMatrix matrix;
+    ASSERT_TRUE(DistanceMatrix::LoadFromAction(*m_ctx, action, matrix));
+    double distance = 0.0;
+    EXPECT_TRUE(matrix.Find(vA, vC, distance));
+    EXPECT_DOUBLE_EQ(distance, 2.0);
+}
+
+//после сдвига одной деревни инкрементальный путь дает то же, что полный пересчет
+TEST_F(AmbulanceAgentTest, IncrementalMatchesFullRecomputation)
+{
+    std::vector<std::pair<double, double>> coordinates = {
+        {0.0, 0.0}, {4.0, 1.0}, {9.0, 3.0}, {2.0, 7.0}, {6.0, 6.0}, {8.0, 9.0}};
+    std::vector<int> const populations = {100, 400, 250, 50, 900, 300};
+    std::vector<ScAddr> villages;
+    for (size_t i = 0; i < coordinates.size(); ++i)
+        villages.push_back(CreateVillage(
+            "Incremental_" + std::to_string(i), coordinates[i].first, coordinates[i].second, populations[i]));
+
+    auto Run = [&](ScAddr const & actionClass, ScAddr const & relation) {
+        ScAction action = m_ctx->GenerateAction(actionClass);
+        EXPECT_TRUE(action.InitiateAndWait(2000));
+        EXPECT_TRUE(action.IsFinishedSuccessfully());
+        if (!relation.IsValid())
+            return ScAddr::Empty;
+        ScIterator5Ptr it5 = m_ctx->CreateIterator5(
+            action, ScType::ConstCommonArc, ScType::ConstNode, ScType::ConstPermPosArc, relation
+        );
+        EXPECT_TRUE(it5->Next());
+        return it5->Get(2);
+    };
+    auto RunAll = [&]() {
+        Run(AmbulanceKeynodes::action_calculate_distances, ScAddr::Empty);
+        return std::make_pair(
+            Run(AmbulanceKeynodes::action_find_graph_center, AmbulanceKeynodes::nrel_graph_center),
+            Run(AmbulanceKeynodes::action_find_optimal_station, AmbulanceKeynodes::nrel_optimal_location));
+    };
+
+    std::shared_ptr<IncrementalState> const state = std::make_shared<IncrementalState>();
+    IncrementalState::SetActive(state);
+    RunAll();
+
+    //сдвигаем одну деревню и пересчитываем инкрементально
+    coordinates[4] = {1.0, 2.0};
+    ScIterator5Ptr itX = m_ctx->CreateIterator5(
+        villages[4], ScType::ConstCommonArc, ScType::NodeLink, ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_coordinate_x
+    );
+    ASSERT_TRUE(itX->Next());
+    m_ctx->SetLinkContent(itX->Get(2), "1.0");
+    ScIterator5Ptr itY = m_ctx->CreateIterator5(
+        villages[4], ScType::ConstCommonArc, ScType::NodeLink, ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_coordinate_y
+    );
+    ASSERT_TRUE(itY->Next());
+    m_ctx->SetLinkContent(itY->Get(2), "2.0");
+    auto const incremental = RunAll();
+
+    IncrementalState::SetActive(nullptr);
+    auto const full = RunAll();
+    EXPECT_EQ(incremental, full);
+
+    for (size_t i = 0; i < villages.size(); ++i) {
+        double expected = 0.0;
+        for (size_t j = 0; j < villages.size(); ++j) {
+            double const distance = std::hypot(
+                coordinates[i].first - coordinates[j].first, coordinates[i].second - coordinates[j].second);
+            expected = std::max(expected, distance);
+
+            //у каждой пары по одной дуге с актуальным значением
+            if (j <= i)
+                continue;
+            size_t arcs = 0;
+            for (auto const & [from, to] : {std::make_pair(villages[i], villages[j]), std::make_pair(villages[j], villages[i])}) {
+                ScIterator5Ptr itDistance = m_ctx->CreateIterator5(
+                    from, ScType::ConstCommonArc, to, ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_distance
+                );
+                while (itDistance->Next()) {
+                    ++arcs;
+                    ScIterator3Ptr itLink = m_ctx->CreateIterator3(ScType::NodeLink, ScType::ConstPermPosArc, itDistance->Get(1));
+                    ASSERT_TRUE(itLink->Next());
+                    EXPECT_NEAR(GetLinkValue(itLink->Get(0)), distance, 1e-9);
+                }
+            }
+            //вторая полная запись (без состояния) добавляет свою дугу
+            EXPECT_EQ(arcs, 2u);
+        }
+
+        //ссылки эксцентриситета переиспользуются: одна от инкрементальных запусков и одна от полного
+        size_t links = 0;
+        ScIterator5Ptr itEcc = m_ctx->CreateIterator5(
+            villages[i], ScType::ConstCommonArc, ScType::NodeLink, ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_eccentricity
+        );
+        while (itEcc->Next()) {
+            ++links;
+            EXPECT_NEAR(GetLinkValue(itEcc->Get(2)), expected, 1e-9);
+        }
+        EXPECT_EQ(links, 2u);
+    }
+}
+
+//повторные запуски в mode_upsert не плодят дуги, очистка удаляет все результаты
+TEST_F(AmbulanceAgentTest, UpsertAndPurgeResults)
+{
+    ScAddr v1 = CreateVillage("Upsert_1", 0.0, 0.0, 10);
+    CreateVillage("Upsert_2", 3.0, 4.0, 20);
+    CreateVillage("Upsert_3", 6.0, 0.0, 30);
+
+    auto Run = [&](ScAddr const & actionClass, bool upsert) {
+        ScAction action = m_ctx->GenerateAction(actionClass);
+        if (upsert)
+            m_ctx->GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::mode_upsert, action);
+        EXPECT_TRUE(action.InitiateAndWait(2000));
+        EXPECT_TRUE(action.IsFinishedSuccessfully());
+    };
+    auto CountArcs = [&](ScAddr const & relation) {
+        size_t count = 0;
+        ScIterator3Ptr it3 = m_ctx->CreateIterator3(relation, ScType::ConstPermPosArc, ScType::ConstCommonArc);
+        while (it3->Next())
+            ++count;
+        return count;
+    };
+
+    //без upsert вторая запись дублирует дуги, upsert их схлопывает
+    Run(AmbulanceKeynodes::action_calculate_distances, false);
+    Run(AmbulanceKeynodes::action_calculate_distances, false);
+    EXPECT_EQ(CountArcs(AmbulanceKeynodes::nrel_distance), 6u);
+    Run(AmbulanceKeynodes::action_calculate_distances, true);
+    Run(AmbulanceKeynodes::action_calculate_distances, true);
+    EXPECT_EQ(CountArcs(AmbulanceKeynodes::nrel_distance), 3u);
+
+    Run(AmbulanceKeynodes::action_find_graph_center, true);
+    Run(AmbulanceKeynodes::action_find_graph_center, true);
+    EXPECT_EQ(CountArcs(AmbulanceKeynodes::nrel_eccentricity), 3u);
+
+    ScIterator5Ptr itEcc = m_ctx->CreateIterator5(
+        v1, ScType::ConstCommonArc, ScType::NodeLink, ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_eccentricity
+    );
+    ASSERT_TRUE(itEcc->Next());
+    EXPECT_DOUBLE_EQ(GetLinkValue(itEcc->Get(2)), 6.0);
+
+    //результаты остальных действий тоже очищаются
+    auto RunWith = [&](ScAddr const & actionClass, std::vector<ScAddr> const & modes,
+                       std::vector<std::pair<ScAddr, double>> const & numbers, ScAddr const & argument) {
+        ScAction action = m_ctx->GenerateAction(actionClass);
+        if (argument.IsValid())
+            action.SetArguments(argument);
+        for (ScAddr const & mode : modes)
+            m_ctx->GenerateConnector(ScType::ConstPermPosArc, mode, action);
+        for (auto const & [role, value] : numbers) {
+            ScAddr const link = NumericLink::Generate(*m_ctx, value);
+            ScAddr const arc = m_ctx->GenerateConnector(ScType::ConstPermPosArc, action, link);
+            m_ctx->GenerateConnector(ScType::ConstPermPosArc, role, arc);
+        }
+        EXPECT_TRUE(action.InitiateAndWait(2000));
+        EXPECT_TRUE(action.IsFinishedSuccessfully());
+    };
+    RunWith(AmbulanceKeynodes::action_find_nearby_villages, {}, {{AmbulanceKeynodes::rrel_radius, 10.0}}, v1);
+    EXPECT_EQ(CountArcs(AmbulanceKeynodes::nrel_nearby_village), 2u);
+    m_ctx->GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::concept_ambulance_station, v1);
+    RunWith(
+        AmbulanceKeynodes::action_find_problem_zones, {AmbulanceKeynodes::mode_coverage},
+        {{AmbulanceKeynodes::rrel_radius, 1.0}}, ScAddr::Empty);
+    EXPECT_EQ(CountArcs(AmbulanceKeynodes::nrel_uncovered_population), 1u);
+    RunWith(AmbulanceKeynodes::action_find_graph_center, {AmbulanceKeynodes::mode_metrics}, {}, ScAddr::Empty);
+    EXPECT_EQ(CountArcs(AmbulanceKeynodes::nrel_metrics), 1u);
+    RunWith(AmbulanceKeynodes::action_find_graph_center, {}, {{AmbulanceKeynodes::rrel_top_k, 3.0}}, ScAddr::Empty);
+    EXPECT_EQ(CountArcs(AmbulanceKeynodes::nrel_candidate_ranking), 1u);
+    RunWith(
+        AmbulanceKeynodes::action_calculate_distances, {AmbulanceKeynodes::mode_upsert, AmbulanceKeynodes::mode_progress},
+        {}, ScAddr::Empty);
+    EXPECT_EQ(CountArcs(AmbulanceKeynodes::nrel_progress), 1u);
+    EXPECT_EQ(CountArcs(AmbulanceKeynodes::nrel_progress_total), 1u);
+    RunWith(AmbulanceKeynodes::action_find_optimal_station, {AmbulanceKeynodes::mode_approximate}, {}, ScAddr::Empty);
+    EXPECT_EQ(CountArcs(AmbulanceKeynodes::nrel_error_bound), 1u);
+
+    Run(AmbulanceKeynodes::action_purge_results, false);
+    EXPECT_EQ(CountArcs(AmbulanceKeynodes::nrel_distance), 0u);
+    EXPECT_EQ(CountArcs(AmbulanceKeynodes::nrel_eccentricity), 0u);
+    EXPECT_EQ(CountArcs(AmbulanceKeynodes::nrel_graph_center), 0u);
+    EXPECT_EQ(CountArcs(AmbulanceKeynodes::nrel_nearby_village), 0u);
+    EXPECT_EQ(CountArcs(AmbulanceKeynodes::nrel_uncovered_population), 0u);
+    EXPECT_EQ(CountArcs(AmbulanceKeynodes::nrel_metrics), 0u);
+    EXPECT_EQ(CountArcs(AmbulanceKeynodes::nrel_candidate_ranking), 0u);
+    EXPECT_EQ(CountArcs(AmbulanceKeynodes::nrel_candidate_score), 0u);
+    EXPECT_EQ(CountArcs(AmbulanceKeynodes::nrel_progress), 0u);
+    EXPECT_EQ(CountArcs(AmbulanceKeynodes::nrel_progress_total), 0u);
+    EXPECT_EQ(CountArcs(AmbulanceKeynodes::nrel_error_bound), 0u);
+    EXPECT_TRUE(m_ctx->CheckConnector(AmbulanceKeynodes::concept_village, v1, ScType::ConstPermPosArc));
+}
+
+//k ближайших и поиск в радиусе совпадают с полным перебором
+TEST(KdTreeTest, QueriesMatchLinearScan)
+{
+    std::mt19937 random(17);
+    std::uniform_int_distribution<int> coordinate(0, 30);//целые координаты дают много равных расстояний
+    std::vector<double> xs(400), ys(400);
+    for (size_t i = 0; i < xs.size(); ++i) {
+        xs[i] = coordinate(random);
+        ys[i] = coordinate(random);
+    }
+    KdTree const tree(xs.data(), ys.data(), xs.size());
+
+    for (double const px : {0.5, 7.0, 15.25, 29.0}) {
+        double const py = 30.0 - px;
+        std::vector<std::pair<double, size_t>> all;
+        for (size_t i = 0; i < xs.size(); ++i)
+            all.emplace_back((xs[i] - px) * (xs[i] - px) + (ys[i] - py) * (ys[i] - py), i);
+        std::sort(all.begin(), all.end());
+
+        std::vector<size_t> const nearest = tree.KNearest(px, py, 10);
+        ASSERT_EQ(nearest.size(), 10u);
+        for (size_t k = 0; k < nearest.size(); ++k)
+            EXPECT_EQ(nearest[k], all[k].second);
+
+        std::vector<size_t> const inside = tree.Radius(px, py, 4.0);
+        size_t expected = 0;
+        while (expected < all.size() && all[expected].first <= 16.0)
+            ++expected;
+        ASSERT_EQ(inside.size(), expected);
+        for (size_t k = 0; k < inside.size(); ++k)
+            EXPECT_EQ(inside[k], all[k].second);
+    }
+}
+
+TEST(StationPlacementTest, CenterSkipsCoincidingVillages)
+{
+    //три деревни в одной точке и одна в стороне: различных мест для станций только два
+    std::vector<double> const xs{0.0, 0.0, 0.0, 4.0};
+    std::vector<double> const ys{0.0, 0.0, 0.0, 3.0};
+    std::vector<double> const weights{1.0, 1.0, 1.0, 1.0};
+    StationPlacement const placement(xs.data(), ys.data(), weights.data(), xs.size(), PlacementObjective::Center);
+    ThreadPool pool(2);
+    PlacementResult const result = placement.Solve(pool, 3);
+
+    ASSERT_EQ(result.stations.size(), 2u);
+    EXPECT_NE(result.stations[0], result.stations[1]);
+    EXPECT_DOUBLE_EQ(result.cost, 0.0);
+}
+
+TEST_F(AmbulanceAgentTest, FindNearbyVillages)
+{
+    ScAddr origin = CreateVillage("Nearby_Origin", 0.0, 0.0, 10);
+    ScAddr close = CreateVillage("Nearby_Close", 1.0, 0.0, 10);
+    ScAddr middle = CreateVillage("Nearby_Middle", 0.0, 3.0, 10);
+    CreateVillage("Nearby_Far", 10.0, 10.0, 10);
+
+    auto Find = [&](ScAddr const & role, double value) {
+        ScAction action = m_ctx->GenerateAction(AmbulanceKeynodes::action_find_nearby_villages);
+        action.SetArguments(origin);
+        ScAddr const link = NumericLink::Generate(*m_ctx, value);
+        ScAddr const arc = m_ctx->GenerateConnector(ScType::ConstPermPosArc, action, link);
+        m_ctx->GenerateConnector(ScType::ConstPermPosArc, role, arc);
+        EXPECT_TRUE(action.InitiateAndWait(2000));
+        EXPECT_TRUE(action.IsFinishedSuccessfully());
+
+        std::set<ScAddr, ScAddrLessFunc> found;
+        ScIterator5Ptr it5 = m_ctx->CreateIterator5(
+            action, ScType::ConstCommonArc, ScType::ConstNode, ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_nearby_village
+        );
+        while (it5->Next())
+            found.insert(it5->Get(2));
+        return found;
+    };
+
+    EXPECT_EQ(Find(AmbulanceKeynodes::rrel_radius, 5.0), (std::set<ScAddr, ScAddrLessFunc>{close, middle}));
+    EXPECT_EQ(Find(AmbulanceKeynodes::rrel_neighbour_count, 1.0), (std::set<ScAddr, ScAddrLessFunc>{close}));
+}
+
+TEST_F(AmbulanceAgentTest, FindProblemZonesCoverageMode)
+{
+    ScAddr first = CreateVillage("Coverage_First", 0.0, 0.0, 10);
+    ScAddr second = CreateVillage("Coverage_Second", 12.0, 0.0, 10);
+    ScAddr close = CreateVillage("Coverage_Close", 3.0, 0.0, 25);
+    CreateVillage("Coverage_Between", 5.0, 0.0, 20);
+    ScAddr remote = CreateVillage("Coverage_Remote", 50.0, 50.0, 7);
+    m_ctx->GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::concept_ambulance_station, first);
+    m_ctx->GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::concept_ambulance_station, second);
+    //старый ответ поиска оптимальной станции станцией не считается
+    ScAddr const oldAction = m_ctx->GenerateAction(AmbulanceKeynodes::action_find_optimal_station);
+    ScAddr const oldArc = m_ctx->GenerateConnector(ScType::ConstCommonArc, oldAction, remote);
+    m_ctx->GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_optimal_location, oldArc);
+
+    auto Find = [&](double capacity, double & uncovered) {
+        ScAction action = m_ctx->GenerateAction(AmbulanceKeynodes::action_find_problem_zones);
+        m_ctx->GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::mode_coverage, action);
+        auto SetNumber = [&](ScAddr const & role, double value) {
+            ScAddr const link = NumericLink::Generate(*m_ctx, value);
+            ScAddr const arc = m_ctx->GenerateConnector(ScType::ConstPermPosArc, action, link);
+            m_ctx->GenerateConnector(ScType::ConstPermPosArc, role, arc);
+        };
+        SetNumber(AmbulanceKeynodes::rrel_radius, 10.0);
+        if (capacity > 0.0)
+            SetNumber(AmbulanceKeynodes::rrel_station_capacity, capacity);
+        EXPECT_TRUE(action.InitiateAndWait(2000));
+        EXPECT_TRUE(action.IsFinishedSuccessfully());
+
+        std::set<ScAddr, ScAddrLessFunc> zones;
+        ScIterator5Ptr it5 = m_ctx->CreateIterator5(
+            action, ScType::ConstCommonArc, ScType::ConstNode, ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_problem_zone
+        );
+        while (it5->Next())
+            zones.insert(it5->Get(2));
+
+        ScIterator5Ptr itPopulation = m_ctx->CreateIterator5(
+            action, ScType::ConstCommonArc, ScType::NodeLink, ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_uncovered_population
+        );
+        EXPECT_TRUE(itPopulation->Next());
+        EXPECT_TRUE(NumericLink::Read(*m_ctx, itPopulation->Get(2), uncovered));
+        return zones;
+    };
+
+    //без ограничения вместимости вне радиуса только удаленная деревня
+    double uncovered = 0.0;
+    EXPECT_EQ(Find(0.0, uncovered), (std::set<ScAddr, ScAddrLessFunc>{remote}));
+    EXPECT_DOUBLE_EQ(uncovered, 7.0);
+
+    //вместимость 30: ближняя деревня не помещается ни в первую, ни во вторую станцию,
+    //а промежуточная успевает в первую
+    EXPECT_EQ(Find(30.0, uncovered), (std::set<ScAddr, ScAddrLessFunc>{close, remote}));
+    EXPECT_DOUBLE_EQ(uncovered, 32.0);
+}
+
+TEST_F(AmbulanceAgentTest, FindProblemZonesDefaultModeUsesOptimalStation)
+{
+    //порог считается только от оптимальной (0,0), станция рядом с далекой деревней не учитывается:
+    //расстояния 1, 2, 1.41, 10, 10.01 - среднее 4.89, порог 7.33
+    ScAddr vOpt = CreateVillage("Single_Opt", 0.0, 0.0, 100);
+    CreateVillage("Single_Near1", 1.0, 0.0, 10);
+    CreateVillage("Single_Near2", 2.0, 0.0, 10);
+    CreateVillage("Single_Near3", 1.0, 1.0, 10);
+    ScAddr vFar = CreateVillage("Single_Far", 10.0, 0.0, 10);
+    ScAddr vHelper = CreateVillage("Single_Helper", 10.0, 0.5, 10);
+    m_ctx->GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::concept_ambulance_station, vHelper);
+
+    ScAddr actionOld = m_ctx->GenerateAction(AmbulanceKeynodes::action_find_optimal_station);
+    ScAddr resArc = m_ctx->GenerateConnector(ScType::ConstCommonArc, actionOld, vOpt);
+    m_ctx->GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_optimal_location, resArc);
+
+    ScAction action = m_ctx->GenerateAction(AmbulanceKeynodes::action_find_problem_zones);
+    EXPECT_TRUE(action.InitiateAndWait(2000));
+    EXPECT_TRUE(action.IsFinishedSuccessfully());
+
+    std::set<ScAddr, ScAddrLessFunc> zones;
+    ScIterator5Ptr it5 = m_ctx->CreateIterator5(
+        action, ScType::ConstCommonArc, ScType::ConstNode, ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_problem_zone
+    );
+    while (it5->Next())
+        zones.insert(it5->Get(2));
+    EXPECT_EQ(zones, (std::set<ScAddr, ScAddrLessFunc>{vFar, vHelper}));
+}
+
+TEST_F(AmbulanceAgentTest, PipelineMatchesSeparateActions)
+{
+    std::vector<ScAddr> villages = {
+        CreateVillage("Pipeline_A", 0.0, 0.0, 500),
+        CreateVillage("Pipeline_B", 2.0, 1.0, 300),
+        CreateVillage("Pipeline_C", 4.0, 0.0, 50),
+        CreateVillage("Pipeline_D", 5.0, 4.0, 20),
+        CreateVillage("Pipeline_E", 20.0, 3.0, 10),
+    };
+
+    //результаты действия: деревни под заданным отношением
+    auto Targets = [&](ScAddr const & action, ScAddr const & relation) {
+        std::set<ScAddr, ScAddrLessFunc> found;
+        ScIterator5Ptr it5 = m_ctx->CreateIterator5(
+            action, ScType::ConstCommonArc, ScType::ConstNode, ScType::ConstPermPosArc, relation
+        );
+        while (it5->Next())
+            found.insert(it5->Get(2));
+        return found;
+    };
+    auto Run = [&](ScAddr const & actionClass) {
+        ScAction action = m_ctx->GenerateAction(actionClass);
+        EXPECT_TRUE(action.InitiateAndWait(5000));
+        EXPECT_TRUE(action.IsFinishedSuccessfully());
+        return ScAddr(action);
+    };
+
+    ScAddr const pipeline = Run(AmbulanceKeynodes::action_run_pipeline);
+
+    //все пары расстояний и по одному эксцентриситету на деревню
+    size_t distances = 0;
+    ScIterator3Ptr itDistances = m_ctx->CreateIterator3(
+        AmbulanceKeynodes::nrel_distance, ScType::ConstPermPosArc, ScType::ConstCommonArc
+    );
+    while (itDistances->Next())
+        ++distances;
+    EXPECT_EQ(distances, villages.size() * (villages.size() - 1) / 2);
+    for (ScAddr const & village : villages)
+    {
+        size_t eccentricities = 0;
+        ScIterator5Ptr it5 = m_ctx->CreateIterator5(
+            village, ScType::ConstCommonArc, ScType::NodeLink, ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_eccentricity
+        );
+        while (it5->Next())
+            ++eccentricities;
+        EXPECT_EQ(eccentricities, 1u);
+    }
+
+    EXPECT_EQ(
+        Targets(pipeline, AmbulanceKeynodes::nrel_graph_center),
+        Targets(Run(AmbulanceKeynodes::action_find_graph_center), AmbulanceKeynodes::nrel_graph_center));
+    EXPECT_EQ(
+        Targets(pipeline, AmbulanceKeynodes::nrel_optimal_location),
+        Targets(Run(AmbulanceKeynodes::action_find_optimal_station), AmbulanceKeynodes::nrel_optimal_location));
+
+    std::set<ScAddr, ScAddrLessFunc> const zones = Targets(pipeline, AmbulanceKeynodes::nrel_problem_zone);
+    EXPECT_EQ(zones, (std::set<ScAddr, ScAddrLessFunc>{villages[4]}));
+    EXPECT_EQ(zones, Targets(Run(AmbulanceKeynodes::action_find_problem_zones), AmbulanceKeynodes::nrel_problem_zone));
+}
+
+TEST_F(AmbulanceAgentTest, AgentMetricsRecordRunsAndCounters)
+{
+    CreateVillage("Metrics_A", 0.0, 0.0, 10);
+    CreateVillage("Metrics_B", 3.0, 4.0, 20);
+
+    uint64_t const runs = AgentMetrics::GetTotals(AmbulanceKeynodes::action_find_graph_center).runs;
+    ScAction action = m_ctx->GenerateAction(AmbulanceKeynodes::action_find_graph_center);
+    m_ctx->GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::mode_metrics, action);
+    EXPECT_TRUE(action.InitiateAndWait(2000));
+    EXPECT_TRUE(action.IsFinishedSuccessfully());
+    ScIterator5Ptr it5 = m_ctx->CreateIterator5(
+        action, ScType::ConstCommonArc, ScType::ConstNodeLink, ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_metrics
+    );
+    EXPECT_TRUE(it5->Next());
+
+    //итог пишется при выходе из DoProgram, чуть позже завершения действия
+    AgentTotals totals = AgentMetrics::GetTotals(AmbulanceKeynodes::action_find_graph_center);
+    for (int attempt = 0; attempt < 1000 && totals.runs == runs; ++attempt)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        totals = AgentMetrics::GetTotals(AmbulanceKeynodes::action_find_graph_center);
+    }
+    EXPECT_EQ(totals.runs, runs + 1);
+    for (double const seconds : totals.last.seconds)
+        EXPECT_GE(seconds, 0.0);
+    EXPECT_GT(totals.last.seconds[static_cast<size_t>(AgentPhase::Load)], 0.0);
+    EXPECT_EQ(totals.last.counters[static_cast<size_t>(AgentCounter::VillagesLoaded)], 2u);
+    EXPECT_GT(totals.last.counters[static_cast<size_t>(AgentCounter::ElementsWritten)], 0u);
+
+    std::string const text = AgentMetrics::ExportText();
+    EXPECT_NE(text.find("ambulance_agent_runs_total{action=\"action_find_graph_center\"}"), std::string::npos);
+}
+
+//массовый импорт: CSV с заголовком и битой строкой, повторный импорт и бинарный файл
+TEST_F(AmbulanceAgentTest, ImportVillagesFromCsvAndBinary)
+{
+    std::filesystem::path const directory = std::filesystem::temp_directory_path();
+    std::filesystem::path const csvPath = directory / "ambulance_import_test.csv";
+    std::filesystem::path const binaryPath = directory / "ambulance_import_test.bin";
+    {
+        std::ofstream csv(csvPath, std::ios::trunc);
+        csv << "id,x,y,population\n"
+            << "# комментарий\n"
+            << "Imported_A, 1.5, 2.0, 120\n"
+            << "Imported_B;-3;4.25;80\n"
+            << "Imported C,0,0,10\n"
+            << "Imported_D,north,0,10\n"
+            << "\n";
+        std::ofstream binary(binaryPath, std::ios::binary | std::ios::trunc);
+        binary << VillageImport::EncodeBinary({{7, 10.0, 20.0, 300.0}, {8, -1.0, 0.5, 40.0}});
+    }
+
+    auto Import = [&](std::filesystem::path const & path) {
+        ScAction action = m_ctx->GenerateAction(AmbulanceKeynodes::action_import_villages);
+        ScAddr const link = m_ctx->GenerateLink(ScType::ConstNodeLink);
+        m_ctx->SetLinkContent(link, path.string());
+        action.SetArgument(1, link);
+        EXPECT_TRUE(action.InitiateAndWait(2000));
+        EXPECT_TRUE(action.IsFinishedSuccessfully());
+    };
+
+    Import(csvPath);
+    Import(csvPath);
+    Import(binaryPath);
+
+    VillageLoadReport report;
+    VillageSnapshot const snapshot = VillageLoader::Load(*m_ctx, report);
+    EXPECT_EQ(report.Skipped(), 0u);
+    ASSERT_EQ(snapshot.Size(), 4u);
+
+    ScAddr const a = m_ctx->SearchElementBySystemIdentifier("Imported_A");
+    ScAddr const b = m_ctx->SearchElementBySystemIdentifier("Imported_B");
+    ScAddr const binary = m_ctx->SearchElementBySystemIdentifier("village_7");
+    ASSERT_LT(snapshot.IndexOf(a), snapshot.Size());
+    ASSERT_LT(snapshot.IndexOf(b), snapshot.Size());
+    ASSERT_LT(snapshot.IndexOf(binary), snapshot.Size());
+    EXPECT_DOUBLE_EQ(snapshot.x[snapshot.IndexOf(a)], 1.5);
+    EXPECT_DOUBLE_EQ(snapshot.population[snapshot.IndexOf(a)], 120.0);
+    EXPECT_DOUBLE_EQ(snapshot.y[snapshot.IndexOf(b)], 4.25);
+    EXPECT_DOUBLE_EQ(snapshot.population[snapshot.IndexOf(binary)], 300.0);
+
+    std::vector<ImportedVillage> parsed;
+    VillageImportReport parseReport;
+    std::string error;
+    EXPECT_TRUE(VillageImport::ParseFile(csvPath.string(), parsed, parseReport, error));
+    EXPECT_EQ(parseReport.records, 4u);
+    EXPECT_EQ(parseReport.malformed, 2u);
+
+    //идентификатор занят не деревней: запись не считается существующей и не создает деревню
+    ScAddr const keynode = m_ctx->GenerateNode(ScType::ConstNode);
+    m_ctx->SetElementSystemIdentifier("Imported_Keynode", keynode);
+    VillageImportReport writeReport;
+    VillageImport::Write(*m_ctx, {{"Imported_Keynode", 0.0, 0.0, 10.0}, {"Imported_A", 1.5, 2.0, 120.0}}, writeReport);
+    EXPECT_EQ(writeReport.imported, 0u);
+    EXPECT_EQ(writeReport.existing, 1u);
+    ASSERT_EQ(writeReport.conflicting.size(), 1u);
+    EXPECT_EQ(writeReport.conflicting[0], "Imported_Keynode");
+    EXPECT_FALSE(m_ctx->CheckConnector(AmbulanceKeynodes::concept_village, keynode, ScType::ConstPermPosArc));
+
+    std::filesystem::remove(csvPath);
+    std::filesystem::remove(binaryPath);
+}
+
+//область действия: множество деревень или прямоугольник
+TEST_F(AmbulanceAgentTest, ScopeRestrictsActionToVillageSubset)
+{
+    ScAddr west = CreateVillage("Scope_West", 0.0, 0.0, 10);
+    ScAddr westNear = CreateVillage("Scope_WestNear", 2.0, 0.0, 10);
+    ScAddr westFar = CreateVillage("Scope_WestFar", 3.0, 0.0, 500);
+    ScAddr east = CreateVillage("Scope_East", 100.0, 0.0, 1000);
+
+    //результат действия под отношением
+    auto Winner = [&](ScAddr const & action, ScAddr const & relation) {
+        ScIterator5Ptr it5 = m_ctx->CreateIterator5(
+            action, ScType::ConstCommonArc, ScType::ConstNode, ScType::ConstPermPosArc, relation
+        );
+        return it5->Next() ? it5->Get(2) : ScAddr::Empty;
+    };
+    auto HasEccentricity = [&](ScAddr const & village) {
+        ScIterator5Ptr it5 = m_ctx->CreateIterator5(
+            village, ScType::ConstCommonArc, ScType::NodeLink, ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_eccentricity
+        );
+        return it5->Next();
+    };
+
+    //множество: посторонний узел в нем пропускается
+    ScAddr const set = m_ctx->GenerateNode(ScType::ConstNode);
+    for (ScAddr const & member : {west, westNear, westFar, m_ctx->GenerateNode(ScType::ConstNode)})
+        m_ctx->GenerateConnector(ScType::ConstPermPosArc, set, member);
+
+    ScAction center = m_ctx->GenerateAction(AmbulanceKeynodes::action_find_graph_center);
+    ScAddr const setArc = m_ctx->GenerateConnector(ScType::ConstPermPosArc, center, set);
+    m_ctx->GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::rrel_villages, setArc);
+    EXPECT_TRUE(center.InitiateAndWait(2000));
+    EXPECT_TRUE(center.IsFinishedSuccessfully());
+    EXPECT_EQ(Winner(center, AmbulanceKeynodes::nrel_graph_center), westNear);
+    EXPECT_TRUE(HasEccentricity(west));
+    EXPECT_FALSE(HasEccentricity(east));
+
+    //прямоугольник: восточная деревня с большим населением не тянет станцию к себе
+    ScAction optimal = m_ctx->GenerateAction(AmbulanceKeynodes::action_find_optimal_station);
+    ScAddr const bound = NumericLink::Generate(*m_ctx, 50.0);
+    ScAddr const boundArc = m_ctx->GenerateConnector(ScType::ConstPermPosArc, optimal, bound);
+    m_ctx->GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::rrel_max_x, boundArc);
+    EXPECT_TRUE(optimal.InitiateAndWait(2000));
+    EXPECT_TRUE(optimal.IsFinishedSuccessfully());
+    EXPECT_EQ(Winner(optimal, AmbulanceKeynodes::nrel_optimal_location), westFar);
+
+    //противоречивые границы - ошибка
+    ScAction broken = m_ctx->GenerateAction(AmbulanceKeynodes::action_calculate_distances);
+    for (auto const & [role, value] :
+         {std::pair{AmbulanceKeynodes::rrel_min_y, 5.0}, std::pair{AmbulanceKeynodes::rrel_max_y, 1.0}})
+    {
+        ScAddr const link = NumericLink::Generate(*m_ctx, value);
+        ScAddr const arc = m_ctx->GenerateConnector(ScType::ConstPermPosArc, broken, link);
+        m_ctx->GenerateConnector(ScType::ConstPermPosArc, role, arc);
+    }
+    EXPECT_TRUE(broken.InitiateAndWait(2000));
+    EXPECT_TRUE(broken.IsFinishedWithError());
+
+    //граница задана, но не число - ошибка, а не расчет по всем деревням
+    ScAction unreadable = m_ctx->GenerateAction(AmbulanceKeynodes::action_calculate_distances);
+    ScAddr const text = m_ctx->GenerateLink(ScType::NodeLink);
+    m_ctx->SetLinkContent(text, "north");
+    ScAddr const textArc = m_ctx->GenerateConnector(ScType::ConstPermPosArc, unreadable, text);
+    m_ctx->GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::rrel_min_x, textArc);
+    EXPECT_TRUE(unreadable.InitiateAndWait(2000));
+    EXPECT_TRUE(unreadable.IsFinishedWithError());
+}
+
+//рейтинг k лучших кандидатов в порядке мест
+TEST_F(AmbulanceAgentTest, TopKRankingListsBestCandidatesInOrder)
+{
+    ScAddr villages[] = {
+        CreateVillage("Rank_A", 0.0, 0.0, 10),
+        CreateVillage("Rank_B", 1.0, 0.0, 10),
+        CreateVillage("Rank_C", 5.0, 0.0, 10),
+        CreateVillage("Rank_D", 20.0, 0.0, 10),
+    };
+
+    ScAction action = m_ctx->GenerateAction(AmbulanceKeynodes::action_find_optimal_station);
+    ScAddr const k = NumericLink::Generate(*m_ctx, 3.0);
+    ScAddr const kArc = m_ctx->GenerateConnector(ScType::ConstPermPosArc, action, k);
+    m_ctx->GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::rrel_top_k, kArc);
+    EXPECT_TRUE(action.InitiateAndWait(2000));
+    EXPECT_TRUE(action.IsFinishedSuccessfully());
+
+    ScIterator5Ptr itRanking = m_ctx->CreateIterator5(
+        action, ScType::ConstCommonArc, ScType::ConstNodeTuple, ScType::ConstPermPosArc,
+        AmbulanceKeynodes::nrel_candidate_ranking
+    );
+    ASSERT_TRUE(itRanking->Next());
+    ScAddr const tuple = itRanking->Get(2);
+
+    //место -> (деревня, счет)
+    std::map<size_t, std::pair<ScAddr, double>> places;
+    ScIterator3Ptr itMembers = m_ctx->CreateIterator3(tuple, ScType::ConstPermPosArc, ScType::ConstNode);
+    while (itMembers->Next())
+    {
+        ScAddr const memberArc = itMembers->Get(1);
+        size_t place = 0;
+        ScIterator3Ptr itRole = m_ctx->CreateIterator3(ScType::ConstNodeRole, ScType::ConstPermPosArc, memberArc);
+        while (itRole->Next())
+        {
+            std::string const idtf = m_ctx->GetElementSystemIdentifier(itRole->Get(0));
+            if (idtf.rfind("rrel_", 0) == 0)
+                place = std::stoul(idtf.substr(5));
+        }
+        ScIterator5Ptr itScore = m_ctx->CreateIterator5(
+            memberArc, ScType::ConstCommonArc, ScType::NodeLink, ScType::ConstPermPosArc,
+            AmbulanceKeynodes::nrel_candidate_score
+        );
+        ASSERT_TRUE(itScore->Next());
+        double score = 0.0;
+        EXPECT_TRUE(NumericLink::Read(*m_ctx, itScore->Get(2), score));
+        places[place] = {itMembers->Get(2), score};
+    }
+
+    //суммы: B = 10*(1+4+19) = 240, C = 10*(5+4+15) = 240, A = 10*(1+5+20) = 260;
+    //при равенстве B и C первым идет меньший хэш адреса
+    ASSERT_EQ(places.size(), 3u);
+    EXPECT_EQ(places.begin()->first, 1u);
+    EXPECT_DOUBLE_EQ(places[1].second, 240.0);
+    EXPECT_DOUBLE_EQ(places[2].second, 240.0);
+    EXPECT_DOUBLE_EQ(places[3].second, 260.0);
+    EXPECT_EQ(places[3].first, villages[0]);
+    ScAddr const first = villages[1].Hash() < villages[2].Hash() ? villages[1] : villages[2];
+    EXPECT_EQ(places[1].first, first);
+
+    ScIterator5Ptr itWinner = m_ctx->CreateIterator5(
+        action, ScType::ConstCommonArc, ScType::ConstNode, ScType::ConstPermPosArc,
+        AmbulanceKeynodes::nrel_optimal_location
+    );
+    ASSERT_TRUE(itWinner->Next());
+    EXPECT_EQ(itWinner->Get(2), first);
+}
+
+//ход действия: публикация хода, остановка по бюджету времени с частичным ответом и отмена
+TEST_F(AmbulanceAgentTest, ProgressBudgetAndCancellation)
+{
+    std::vector<ScAddr> villages;
+    for (size_t i = 0; i < 20; ++i)
+        villages.push_back(CreateVillage("Progress_" + std::to_string(i), double(i), double(i % 3), 10));
+
+    auto const ReadRelation = [&](ScAddr const & action, ScAddr const & relation) {
+        ScIterator5Ptr it5 = m_ctx->CreateIterator5(
+            action, ScType::ConstCommonArc, ScType::ConstNodeLink, ScType::ConstPermPosArc, relation
+        );
+        double value = -1.0;
+        if (it5->Next())
+            NumericLink::Read(*m_ctx, it5->Get(2), value);
+        return value;
+    };
+    auto const HasDistance = [&](ScAddr const & a, ScAddr const & b) {
+        ScIterator5Ptr forward = m_ctx->CreateIterator5(
+            a, ScType::ConstCommonArc, b, ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_distance
+        );
+        ScIterator5Ptr backward = m_ctx->CreateIterator5(
+            b, ScType::ConstCommonArc, a, ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_distance
+        );
+        return forward->Next() || backward->Next();
+    };
+
+    //бюджет кончается после первой строки: пары первой деревни записаны, остальные нет
+    ScAction budgeted = m_ctx->GenerateAction(AmbulanceKeynodes::action_calculate_distances);
+    ScAddr const budget = NumericLink::Generate(*m_ctx, 1e-6);
+    ScAddr const budgetArc = m_ctx->GenerateConnector(ScType::ConstPermPosArc, budgeted, budget);
+    m_ctx->GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::rrel_time_budget, budgetArc);
+    m_ctx->GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::mode_progress, budgeted);
+    EXPECT_TRUE(budgeted.InitiateAndWait(2000));
+    EXPECT_TRUE(budgeted.IsFinishedSuccessfully());
+    EXPECT_TRUE(m_ctx->CheckConnector(AmbulanceKeynodes::concept_approximate_action, budgeted, ScType::ConstPermPosArc));
+    EXPECT_DOUBLE_EQ(ReadRelation(budgeted, AmbulanceKeynodes::nrel_progress_total), 190.0);
+    EXPECT_LT(ReadRelation(budgeted, AmbulanceKeynodes::nrel_progress), 190.0);
+    EXPECT_FALSE(HasDistance(villages[18], villages[19]));
+
+    //без бюджета ход доходит до конца и действие точное
+    ScAction full = m_ctx->GenerateAction(AmbulanceKeynodes::action_calculate_distances);
+    m_ctx->GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::mode_progress, full);
+    m_ctx->GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::mode_upsert, full);
+    EXPECT_TRUE(full.InitiateAndWait(2000));
+    EXPECT_TRUE(full.IsFinishedSuccessfully());
+    EXPECT_FALSE(m_ctx->CheckConnector(AmbulanceKeynodes::concept_approximate_action, full, ScType::ConstPermPosArc));
+    EXPECT_DOUBLE_EQ(ReadRelation(full, AmbulanceKeynodes::nrel_progress), 190.0);
+    EXPECT_TRUE(HasDistance(villages[18], villages[19]));
+
+    //отмена, поставленная до запуска: действие завершается неуспешно и станций не назначает
+    ScAction cancelled = m_ctx->GenerateAction(AmbulanceKeynodes::action_place_stations);
+    m_ctx->GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::concept_cancelled_action, cancelled);
+    EXPECT_TRUE(cancelled.InitiateAndWait(2000));
+    EXPECT_TRUE(cancelled.IsFinishedUnsuccessfully());
+    ScIterator5Ptr itStation = m_ctx->CreateIterator5(
+        cancelled, ScType::ConstCommonArc, ScType::ConstNode, ScType::ConstPermPosArc,
+        AmbulanceKeynodes::nrel_ambulance_station
+    );
+    EXPECT_FALSE(itStation->Next());
+}
+
+//приближенный режим: победитель не хуже точного больше чем на записанную границу погрешности
+TEST_F(AmbulanceAgentTest, ApproximateModeReportsErrorBound)
+{
+    std::mt19937 rng(24);
+    std::uniform_real_distribution<double> coordinate(0.0, 100.0);
+    std::vector<ScAddr> villages;
+    std::vector<double> xs, ys, populations;
+    for (size_t i = 0; i < 150; ++i)
+    {
+        xs.push_back(coordinate(rng));
+        ys.push_back(coordinate(rng));
+        populations.push_back(double(1 + rng() % 50));
+        villages.push_back(CreateVillage("Approx_" + std::to_string(i), xs.back(), ys.back(), populations.back()));
+    }
+
+    auto const Score = [&](size_t c, bool center) {
+        double score = 0.0;
+        for (size_t j = 0; j < villages.size(); ++j)
+        {
+            double const d = std::hypot(xs[c] - xs[j], ys[c] - ys[j]);
+            score = center ? std::max(score, d) : score + populations[j] * d;
+        }
+        return score;
+    };
+    auto const Run = [&](ScAddr const & actionClass, ScAddr const & relation, bool center) {
+        ScAction action = m_ctx->GenerateAction(actionClass);
+        ScAddr const accuracy = NumericLink::Generate(*m_ctx, 0.1);
+        ScAddr const accuracyArc = m_ctx->GenerateConnector(ScType::ConstPermPosArc, action, accuracy);
+        m_ctx->GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::rrel_accuracy, accuracyArc);
+        EXPECT_TRUE(action.InitiateAndWait(5000));
+        EXPECT_TRUE(action.IsFinishedSuccessfully());
+
+        ScIterator5Ptr itWinner = m_ctx->CreateIterator5(
+            action, ScType::ConstCommonArc, ScType::ConstNode, ScType::ConstPermPosArc, relation
+        );
+        ScIterator5Ptr itBound = m_ctx->CreateIterator5(
+            action, ScType::ConstCommonArc, ScType::ConstNodeLink, ScType::ConstPermPosArc,
+            AmbulanceKeynodes::nrel_error_bound
+        );
+        ASSERT_TRUE(itWinner->Next());
+        ASSERT_TRUE(itBound->Next());
+        double bound = -1.0;
+        EXPECT_TRUE(NumericLink::Read(*m_ctx, itBound->Get(2), bound));
+        EXPECT_GE(bound, 0.0);
+
+        size_t const winner = std::find(villages.begin(), villages.end(), itWinner->Get(2)) - villages.begin();
+        ASSERT_LT(winner, villages.size());
+        double best = std::numeric_limits<double>::infinity();
+        for (size_t c = 0; c < villages.size(); ++c)
+            best = std::min(best, Score(c, center));
+        EXPECT_LE(Score(winner, center) - best, bound + 1e-6 * best);
+        EXPECT_LE(Score(winner, center) - best, 0.1 * best + 1e-6 * best);
+    };
+
+    Run(AmbulanceKeynodes::action_find_optimal_station, AmbulanceKeynodes::nrel_optimal_location, false);
+    Run(AmbulanceKeynodes::action_find_graph_center, AmbulanceKeynodes::nrel_graph_center, true);
+
+    //проблемные зоны: порог по ячейкам, граница погрешности порога тоже записывается
+    ScAction zones = m_ctx->GenerateAction(AmbulanceKeynodes::action_find_problem_zones);
+    m_ctx->GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::mode_approximate, zones);
+    EXPECT_TRUE(zones.InitiateAndWait(5000));
+    EXPECT_TRUE(zones.IsFinishedSuccessfully());
+    ScIterator5Ptr itZoneBound = m_ctx->CreateIterator5(
+        zones, ScType::ConstCommonArc, ScType::ConstNodeLink, ScType::ConstPermPosArc,
+        AmbulanceKeynodes::nrel_error_bound
+    );
+    EXPECT_TRUE(itZoneBound->Next());
+}
+
+//снимок модуля: сохранение, загрузка без чтения свойств, перечитывание измененных деревень и отказ после изменения базы знаний
+TEST_F(AmbulanceAgentTest, ModuleSnapshotRestoresUntilKnowledgeBaseChanges)
+{
+    CreateVillage("Snapshot_A", 0.0, 0.0, 100);
+    CreateVillage("Snapshot_B", 3.0, 4.0, 50);
+    CreateVillage("Snapshot_C", -2.0, 1.0, 75);
+
+    VillageCache cache;
+    EXPECT_FALSE(cache.Initialize());
+    VillageLoadReport report;
+    std::shared_ptr<VillageSnapshot const> const snapshot = cache.GetSnapshot(report);
+    IncrementalState state;
+    IncrementalView const view = state.Sync(*snapshot);
+
+    ModuleSnapshotContent content;
+    cache.Export(content);
+    state.Export(content.villages, content);
+    cache.Shutdown();
+    ASSERT_EQ(content.scores.size(), 3u);
+
+    std::filesystem::path const path = std::filesystem::temp_directory_path() / "ambulance_module_snapshot.bin";
+    std::string error;
+    ASSERT_TRUE(ModuleSnapshot::Save(path.string(), content, error)) << error;
+    ModuleSnapshotContent loaded;
+    ASSERT_TRUE(ModuleSnapshot::Load(path.string(), loaded, error)) << error;
+    EXPECT_EQ(loaded.generation, content.generation);
+    EXPECT_EQ(loaded.records.size(), 3u);
+    EXPECT_EQ(loaded.villages.addrs, snapshot->addrs);
+
+    //снимок принимается, инкрементальное состояние не пересчитывается
+    VillageCache restoredCache;
+    EXPECT_TRUE(restoredCache.Initialize(&loaded));
+    std::shared_ptr<VillageSnapshot const> const restored = restoredCache.GetSnapshot(report);
+    EXPECT_EQ(restored->addrs, snapshot->addrs);
+    EXPECT_EQ(restored->x, snapshot->x);
+    EXPECT_EQ(report.total, 3u);
+
+    IncrementalState restoredState;
+    EXPECT_TRUE(restoredState.Restore(loaded));
+    IncrementalView const restoredView = restoredState.Sync(*restored);
+    EXPECT_FALSE(restoredView.fullRecompute);
+    EXPECT_EQ(restoredView.recomputedRows, 0u);
+    EXPECT_EQ(restoredView.scores, view.scores);
+    EXPECT_EQ(restoredView.center, view.center);
+
+    //изменение базы знаний увеличивает счетчик, и прежний снимок больше не подходит
+    CreateVillage("Snapshot_D", 5.0, 5.0, 10);
+    for (size_t attempt = 0; attempt < 200 && restoredCache.GetSnapshot(report)->Size() != 4; ++attempt)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    restoredCache.Shutdown();
+
+    VillageCache staleCache;
+    EXPECT_FALSE(staleCache.Initialize(&loaded));
+    EXPECT_EQ(staleCache.GetSnapshot(report)->Size(), 4u);
+    ModuleSnapshotContent current;
+    staleCache.Export(current);
+    staleCache.Shutdown();
+
+    //свойство переписано и удалено, пока модуль не загружен: счетчик прежний, снимок принимается,
+    //а перечитывается только деревня с изменившейся ссылкой
+    ScAddr const villageA = m_ctx->SearchElementBySystemIdentifier("Snapshot_A");
+    ScIterator5Ptr itX = m_ctx->CreateIterator5(
+        villageA, ScType::ConstCommonArc, ScType::NodeLink, ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_coordinate_x
+    );
+    ASSERT_TRUE(itX->Next());
+    m_ctx->SetLinkContent(itX->Get(2), "7.0");
+    VillageCache editedCache;
+    std::string rejection;
+    EXPECT_TRUE(editedCache.Initialize(&current, &rejection)) << rejection;
+    std::shared_ptr<VillageSnapshot const> const edited = editedCache.GetSnapshot(report);
+    auto const positionA = std::find(edited->addrs.begin(), edited->addrs.end(), villageA);
+    ASSERT_NE(positionA, edited->addrs.end());
+    EXPECT_EQ(edited->x[positionA - edited->addrs.begin()], 7.0);
+    ModuleSnapshotContent editedContent;
+    editedCache.Export(editedContent);
+    editedCache.Shutdown();
+
+    m_ctx->EraseElement(itX->Get(2));
+    VillageCache erasedCache;
+    EXPECT_TRUE(erasedCache.Initialize(&editedContent));
+    EXPECT_EQ(erasedCache.GetSnapshot(report)->Size(), 3u);
+    EXPECT_EQ(report.incomplete, 1u);
+    erasedCache.Shutdown();
+
+    //счетчик после добавления деревни не совпадает - причина отказа сообщается
+    VillageCache rejectedCache;
+    EXPECT_FALSE(rejectedCache.Initialize(&loaded, &rejection));
+    EXPECT_FALSE(rejection.empty());
+    rejectedCache.Shutdown();
+
+    //обрезанный файл отвергается
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 8);
+    EXPECT_FALSE(ModuleSnapshot::Load(path.string(), loaded, error));
+    std::filesystem::remove(path);
+}
+
+//прерванная по бюджету первая запись не фиксирует состояние: повторный запуск дописывает все пары
+TEST_F(AmbulanceAgentTest, BudgetedDistancesCompletedByIncrementalRerun)
+{
+    std::vector<ScAddr> villages;
+    for (size_t i = 0; i < 12; ++i)
+        villages.push_back(CreateVillage("Rerun_" + std::to_string(i), double(i), double(i % 4), 10));
+
+    std::shared_ptr<IncrementalState> const state = std::make_shared<IncrementalState>();
+    IncrementalState::SetActive(state);
+
+    ScAction budgeted = m_ctx->GenerateAction(AmbulanceKeynodes::action_calculate_distances);
+    ScAddr const budget = NumericLink::Generate(*m_ctx, 1e-6);
+    ScAddr const budgetArc = m_ctx->GenerateConnector(ScType::ConstPermPosArc, budgeted, budget);
+    m_ctx->GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::rrel_time_budget, budgetArc);
+    EXPECT_TRUE(budgeted.InitiateAndWait(2000));
+    EXPECT_TRUE(budgeted.IsFinishedSuccessfully());
+    EXPECT_TRUE(m_ctx->CheckConnector(AmbulanceKeynodes::concept_approximate_action, budgeted, ScType::ConstPermPosArc));
+
+    ScAction rerun = m_ctx->GenerateAction(AmbulanceKeynodes::action_calculate_distances);
+    EXPECT_TRUE(rerun.InitiateAndWait(2000));
+    EXPECT_TRUE(rerun.IsFinishedSuccessfully());
+
+    //у каждой пары ровно одна дуга с верным значением
+    for (size_t i = 0; i < villages.size(); ++i) {
+        for (size_t j = i + 1; j < villages.size(); ++j) {
+            double const distance = std::hypot(double(i) - double(j), double(i % 4) - double(j % 4));
+            size_t arcs = 0;
+            for (auto const & [from, to] : {std::make_pair(villages[i], villages[j]), std::make_pair(villages[j], villages[i])}) {
+                ScIterator5Ptr itDistance = m_ctx->CreateIterator5(
+                    from, ScType::ConstCommonArc, to, ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_distance
+                );
+                while (itDistance->Next()) {
+                    ++arcs;
+                    ScIterator3Ptr itLink = m_ctx->CreateIterator3(ScType::NodeLink, ScType::ConstPermPosArc, itDistance->Get(1));
+                    ASSERT_TRUE(itLink->Next());
+                    EXPECT_NEAR(GetLinkValue(itLink->Get(0)), distance, 1e-9);
+                }
+            }
+            EXPECT_EQ(arcs, 1u) << i << " " << j;
+        }
+    }
+}
+
+//при состоянии модуля запись с одинарной точностью и конвейер обновляют дуги на месте,
+//а следующая точная запись исправляет значения всех пар
+TEST_F(AmbulanceAgentTest, IncrementalStateUpsertsEveryDistanceWrite)
+{
+    std::vector<std::pair<double, double>> coordinates = {
+        {0.0, 0.0}, {3.0, 1.0}, {7.0, 2.0}, {1.0, 5.0}, {6.0, 6.0}};
+    std::vector<ScAddr> villages;
+    for (size_t i = 0; i < coordinates.size(); ++i)
+        villages.push_back(CreateVillage(
+            "StateUpsert_" + std::to_string(i), coordinates[i].first, coordinates[i].second, 10));
+
+    std::shared_ptr<IncrementalState> const state = std::make_shared<IncrementalState>();
+    IncrementalState::SetActive(state);
+
+    auto Run = [&](ScAddr const & actionClass, ScAddr const & mode) {
+        ScAction action = m_ctx->GenerateAction(actionClass);
+        if (mode.IsValid())
+            m_ctx->GenerateConnector(ScType::ConstPermPosArc, mode, action);
+        EXPECT_TRUE(action.InitiateAndWait(2000));
+        EXPECT_TRUE(action.IsFinishedSuccessfully());
+    };
+    Run(AmbulanceKeynodes::action_calculate_distances, ScAddr::Empty);
+    Run(AmbulanceKeynodes::action_calculate_distances, AmbulanceKeynodes::mode_single_precision);
+    Run(AmbulanceKeynodes::action_calculate_distances, AmbulanceKeynodes::mode_single_precision);
+    Run(AmbulanceKeynodes::action_run_pipeline, ScAddr::Empty);
+
+    //сдвигаем деревню: точная запись после одинарной точности проходит по всем парам
+    coordinates[2] = {2.0, 2.0};
+    ScIterator5Ptr itX = m_ctx->CreateIterator5(
+        villages[2], ScType::ConstCommonArc, ScType::NodeLink, ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_coordinate_x
+    );
+    ASSERT_TRUE(itX->Next());
+    m_ctx->SetLinkContent(itX->Get(2), "2.0");
+    Run(AmbulanceKeynodes::action_calculate_distances, AmbulanceKeynodes::mode_single_precision);
+    Run(AmbulanceKeynodes::action_calculate_distances, ScAddr::Empty);
+
+    for (size_t i = 0; i < villages.size(); ++i) {
+        for (size_t j = i + 1; j < villages.size(); ++j) {
+            double const distance = std::hypot(
+                coordinates[i].first - coordinates[j].first, coordinates[i].second - coordinates[j].second);
+            size_t arcs = 0;
+            for (auto const & [from, to] : {std::make_pair(villages[i], villages[j]), std::make_pair(villages[j], villages[i])}) {
+                ScIterator5Ptr itDistance = m_ctx->CreateIterator5(
+                    from, ScType::ConstCommonArc, to, ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_distance
+                );
+                while (itDistance->Next()) {
+                    ++arcs;
+                    ScIterator3Ptr itLink = m_ctx->CreateIterator3(ScType::NodeLink, ScType::ConstPermPosArc, itDistance->Get(1));
+                    ASSERT_TRUE(itLink->Next());
+                    EXPECT_NEAR(GetLinkValue(itLink->Get(0)), distance, 1e-9);
+                }
+            }
+            EXPECT_EQ(arcs, 1u) << i << " " << j;
+        }
+    }
+
+    //конвейер переписал ссылки эксцентриситетов через состояние: у каждой деревни одна
+    for (ScAddr const & village : villages) {
+        size_t links = 0;
+        ScIterator5Ptr itEccentricity = m_ctx->CreateIterator5(
+            village, ScType::ConstCommonArc, ScType::NodeLink, ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_eccentricity
+        );
+        while (itEccentricity->Next())
+            ++links;
+        EXPECT_EQ(links, 1u);
+    }
+}
+
+//две компоненты дорог с деревнями без жителей: 0 * inf не портит суммы, победитель находится
+TEST_F(AmbulanceAgentTest, RoadMetricUnreachableEmptyVillages)
+{
+    ScAddr vA = CreateVillage("Split_A", 0.0, 0.0, 10);
+    ScAddr vB = CreateVillage("Split_B", 1.0, 0.0, 0);
+    ScAddr vC = CreateVillage("Split_C", 5.0, 0.0, 20);
+    ScAddr vD = CreateVillage("Split_D", 6.0, 0.0, 0);
+
+    auto AddRoad = [&](ScAddr const & from, ScAddr const & to) {
+        ScAddr const road = m_ctx->GenerateConnector(ScType::ConstCommonArc, from, to);
+        m_ctx->GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_road, road);
+    };
+    AddRoad(vA, vB);
+    AddRoad(vC, vD);
+
+    auto Run = [&](ScAddr const & actionClass) {
+        ScAction action = m_ctx->GenerateAction(actionClass);
+        m_ctx->GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::mode_road_metric, action);
+        EXPECT_TRUE(action.InitiateAndWait(2000));
+        EXPECT_TRUE(action.IsFinishedSuccessfully());
+        ScIterator5Ptr itOptimal = m_ctx->CreateIterator5(
+            action, ScType::ConstCommonArc, ScType::ConstNode, ScType::ConstPermPosArc,
+            AmbulanceKeynodes::nrel_optimal_location
+        );
+        return itOptimal->Next() ? itOptimal->Get(2) : ScAddr::Empty;
+    };
+
+    ScAddr const optimal = Run(AmbulanceKeynodes::action_run_pipeline);
+    EXPECT_TRUE(optimal == vA || optimal == vB || optimal == vC || optimal == vD);
+    //отдельный агент оценивает кандидатов той же суммой: все счета бесконечны, выбор по хэшу тот же
+    EXPECT_EQ(Run(AmbulanceKeynodes::action_find_optimal_station), optimal);
+}
+
+//население нужно только взвешенным агентам: деревня без него остается в расстояниях и центре
+TEST_F(AmbulanceAgentTest, PopulationIsOptionalForUnweightedAgents)
+{
+    ScAddr vA = CreateVillage("Unweighted_A", 0.0, 0.0, 100);
+    ScAddr vB = CreateVillage("Unweighted_B", 10.0, 0.0, 100);
+    ScAddr vMiddle = m_ctx->GenerateNode(ScType::ConstNode);
+    m_ctx->GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::concept_village, vMiddle);
+    for (auto const & [relation, value] :
+         {std::make_pair(AmbulanceKeynodes::nrel_coordinate_x, 5.0), std::make_pair(AmbulanceKeynodes::nrel_coordinate_y, 0.0)})
+    {
+        ScAddr const link = NumericLink::Generate(*m_ctx, value);
+        ScAddr const arc = m_ctx->GenerateConnector(ScType::ConstCommonArc, vMiddle, link);
+        m_ctx->GenerateConnector(ScType::ConstPermPosArc, relation, arc);
+    }
+
+    VillageLoadReport report;
+    VillageSnapshot const snapshot = VillageLoader::Load(*m_ctx, report);
+    EXPECT_EQ(report.Skipped(), 0u);
+    EXPECT_EQ(report.unweighted, 1u);
+    ASSERT_EQ(snapshot.Size(), 3u);
+    size_t const middle = snapshot.IndexOf(vMiddle);
+    ASSERT_LT(middle, snapshot.Size());
+    EXPECT_FALSE(snapshot.HasPopulation(middle));
+    EXPECT_DOUBLE_EQ(snapshot.population[middle], 0.0);
+    EXPECT_EQ(snapshot.Weighted().Size(), 2u);
+
+    auto Run = [&](ScAddr const & actionClass, ScAddr const & relation) {
+        ScAction action = m_ctx->GenerateAction(actionClass);
+        EXPECT_TRUE(action.InitiateAndWait(2000));
+        EXPECT_TRUE(action.IsFinishedSuccessfully());
+        if (!relation.IsValid())
+            return ScAddr::Empty;
+        ScIterator5Ptr it5 = m_ctx->CreateIterator5(
+            action, ScType::ConstCommonArc, ScType::ConstNode, ScType::ConstPermPosArc, relation
+        );
+        return it5->Next() ? it5->Get(2) : ScAddr::Empty;
+    };
+
+    //центр - деревня без населения посередине; станция выбирается только среди деревень с населением
+    EXPECT_EQ(Run(AmbulanceKeynodes::action_find_graph_center, AmbulanceKeynodes::nrel_graph_center), vMiddle);
+    ScAddr const optimal = Run(AmbulanceKeynodes::action_find_optimal_station, AmbulanceKeynodes::nrel_optimal_location);
+    EXPECT_TRUE(optimal == vA || optimal == vB);
+
+    Run(AmbulanceKeynodes::action_calculate_distances, ScAddr::Empty);
+    ScIterator5Ptr itDistance = m_ctx->CreateIterator5(
+        vMiddle, ScType::ConstCommonArc, vA, ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_distance
+    );
+    ScIterator5Ptr itBack = m_ctx->CreateIterator5(
+        vA, ScType::ConstCommonArc, vMiddle, ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_distance
+    );
+    EXPECT_TRUE(itDistance->Next() || itBack->Next());
+
+    //состояние модуля оба агента приводят к полному снимку: поочередные запуски ничего не пересчитывают
+    std::shared_ptr<IncrementalState> const state = std::make_shared<IncrementalState>();
+    IncrementalState::SetActive(state);
+    EXPECT_EQ(Run(AmbulanceKeynodes::action_find_optimal_station, AmbulanceKeynodes::nrel_optimal_location), optimal);
+    EXPECT_EQ(Run(AmbulanceKeynodes::action_find_graph_center, AmbulanceKeynodes::nrel_graph_center), vMiddle);
+    EXPECT_EQ(Run(AmbulanceKeynodes::action_find_optimal_station, AmbulanceKeynodes::nrel_optimal_location), optimal);
+    IncrementalView const view = state->Sync(snapshot);
+    EXPECT_FALSE(view.fullRecompute);
+    EXPECT_EQ(view.recomputedRows, 0u);
+    EXPECT_EQ(snapshot.addrs[view.optimal], optimal);
+}
+
+//маршруты области действия идут и через деревни вне нее: ответ тот же, что на всем графе
+TEST_F(AmbulanceAgentTest, ScopedRoadMetricRoutesThroughExcludedVillages)
+{
+    ScAddr vA = CreateVillage("Through_A", 0.0, 0.0, 10);
+    ScAddr vB = CreateVillage("Through_B", 10.0, 10.0, 10);
+    ScAddr vC = CreateVillage("Through_C", 20.0, 0.0, 10);
+    ScAddr crossroad = m_ctx->GenerateNode(ScType::ConstNode);
+
+    auto AddRoad = [&](ScAddr const & from, ScAddr const & to, double time) {
+        ScAddr const road = m_ctx->GenerateConnector(ScType::ConstCommonArc, from, to);
+        m_ctx->GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_road, road);
+        ScAddr const link = NumericLink::Generate(*m_ctx, time);
+        ScAddr const timeArc = m_ctx->GenerateConnector(ScType::ConstCommonArc, road, link);
+        m_ctx->GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_travel_time, timeArc);
+    };
+    AddRoad(vA, vB, 1.0);
+    AddRoad(vB, crossroad, 0.5);
+    AddRoad(crossroad, vC, 0.5);
+
+    auto Distance = [&](bool scoped) {
+        ScAction action = m_ctx->GenerateAction(AmbulanceKeynodes::action_calculate_distances);
+        m_ctx->GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::mode_distance_matrix, action);
+        m_ctx->GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::mode_road_metric, action);
+        if (scoped) {
+            ScAddr const bound = NumericLink::Generate(*m_ctx, 5.0);
+            ScAddr const boundArc = m_ctx->GenerateConnector(ScType::ConstPermPosArc, action, bound);
+            m_ctx->GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::rrel_max_y, boundArc);
+        }
+        EXPECT_TRUE(action.InitiateAndWait(2000));
+        EXPECT_TRUE(action.IsFinishedSuccessfully());
+
+        DistanceMatrix matrix;
+        EXPECT_TRUE(DistanceMatrix::LoadFromAction(*m_ctx, action, matrix));
+        EXPECT_EQ(matrix.Size(), scoped ? 2u : 3u);
+        double distance = -1.0;
+        EXPECT_TRUE(matrix.Find(vA, vC, distance));
+        return distance;
+    };
+
+    EXPECT_DOUBLE_EQ(Distance(false), 2.0);
+    EXPECT_DOUBLE_EQ(Distance(true), 2.0);
+}
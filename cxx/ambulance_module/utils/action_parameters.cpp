@@ -0,0 +1,41 @@
+#include "action_parameters.hpp"
+
+#include "utils/numeric_link.hpp"
+
+using namespace ambulance_module;
+
+ActionParameters::ActionParameters(ScMemoryContext & context, ScAddr const & action)
+  : m_context(context)
+  , m_action(action)
+{
+}
+
+bool ActionParameters::HasMode(ScAddr const & mode) const
+{
+  return m_context.CheckConnector(mode, m_action, ScType::ConstPermPosArc);
+}
+
+ScAddr ActionParameters::GetElement(ScAddr const & role) const
+{
+  ScIterator5Ptr const it5 = m_context.CreateIterator5(
+      m_action, ScType::ConstPermPosArc, ScType::Unknown, ScType::ConstPermPosArc, role);
+  if (it5->Next())
+    return it5->Get(2);
+  return ScAddr::Empty;
+}
+
+bool ActionParameters::ReadNumber(ScAddr const & role, double & value) const
+{
+  ScAddr const link = GetElement(role);
+  if (!link.IsValid() || !m_context.GetElementType(link).IsLink())
+    return false;
+  return NumericLink::Read(m_context, link, value);
+}
+
+double ActionParameters::GetNumber(ScAddr const & role, double defaultValue) const
+{
+  double value = defaultValue;
+  if (!ReadNumber(role, value))
+    return defaultValue;
+  return value;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <sc-memory/sc_memory.hpp>
+
+namespace ambulance_module
+{
+
+//необязательные параметры действия:
+//  режим   - класс, которому принадлежит действие (mode_distance_matrix -> action)
+//  число   - ссылка под ролевым отношением (action -> rrel_*: [число])
+//  элемент - любой элемент под ролевым отношением
+class ActionParameters
+{
+public:
+  ActionParameters(ScMemoryContext & context, ScAddr const & action);
+
+  bool HasMode(ScAddr const & mode) const;
+
+  ScAddr GetElement(ScAddr const & role) const;
+
+  bool ReadNumber(ScAddr const & role, double & value) const;
+  double GetNumber(ScAddr const & role, double defaultValue) const;
+
+private:
+  ScMemoryContext & m_context;
+  ScAddr m_action;
+};
+
+}  // namespace ambulance_module
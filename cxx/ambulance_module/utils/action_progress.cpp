@@ -0,0 +1,109 @@
+#include "action_progress.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "keynodes/ambulance_keynodes.hpp"
+#include "utils/numeric_link.hpp"
+
+using namespace ambulance_module;
+
+ActionProgress::ActionProgress(ScMemoryContext & context, ScAddr const & action)
+  : m_context(context)
+  , m_action(action)
+  , m_start(std::chrono::steady_clock::now())
+{
+}
+
+bool ActionProgress::Read(ActionParameters const & parameters, std::string & error)
+{
+  m_publish = parameters.HasMode(AmbulanceKeynodes::mode_progress);
+
+  double budget = 0.0;
+  if (parameters.ReadNumber(AmbulanceKeynodes::rrel_time_budget, budget))
+  {
+    if (!(budget > 0.0) || std::isinf(budget))
+    {
+      error = "rrel_time_budget must be a positive number of seconds.";
+      return false;
+    }
+    m_budgetSeconds = budget;
+  }
+  return true;
+}
+
+void ActionProgress::Begin(size_t total)
+{
+  m_start = std::chrono::steady_clock::now();
+  m_lastCheck = 0.0;
+  m_total = total;
+  m_done = 0;
+  //отмена, поставленная до запуска, видна сразу, а не через интервал
+  m_cancelled =
+      m_context.CheckConnector(AmbulanceKeynodes::concept_cancelled_action, m_action, ScType::ConstPermPosArc);
+  if (!m_publish)
+    return;
+
+  //action => nrel_progress_total: [всего] пишется один раз, ход - переписываемая ссылка
+  ScAddr const totalLink = m_context.GenerateLink(ScType::ConstNodeLink);
+  NumericLink::WriteInteger(m_context, totalLink, static_cast<int64_t>(total));
+  ScAddr const totalArc = m_context.GenerateConnector(ScType::ConstCommonArc, m_action, totalLink);
+  m_context.GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_progress_total, totalArc);
+
+  m_progressLink = m_context.GenerateLink(ScType::ConstNodeLink);
+  NumericLink::WriteInteger(m_context, m_progressLink, 0);
+  ScAddr const progressArc = m_context.GenerateConnector(ScType::ConstCommonArc, m_action, m_progressLink);
+  m_context.GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_progress, progressArc);
+}
+
+bool ActionProgress::Proceed(size_t done)
+{
+  m_done = std::min(done, m_total);
+  if (m_cancelled || m_outOfTime)
+    return false;
+
+  double const elapsed = Elapsed();
+  if (HasBudget() && elapsed >= m_budgetSeconds)
+    m_outOfTime = true;
+
+  //обращения к базе - не чаще интервала публикации
+  if (elapsed - m_lastCheck >= kPublishIntervalSeconds)
+  {
+    m_lastCheck = elapsed;
+    m_cancelled =
+        m_context.CheckConnector(AmbulanceKeynodes::concept_cancelled_action, m_action, ScType::ConstPermPosArc);
+    Publish();
+  }
+  return !m_cancelled && !m_outOfTime;
+}
+
+size_t ActionProgress::Finish(ScStructure & structure)
+{
+  //работа, завершенная раньше оценки (например, сошедшийся поиск), считается выполненной целиком
+  if (!m_cancelled && !m_outOfTime)
+    m_done = m_total;
+  Publish();
+  if (!m_outOfTime || m_cancelled)
+    return 0;
+
+  ScAddr const arc =
+      m_context.GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::concept_approximate_action, m_action);
+  structure << AmbulanceKeynodes::concept_approximate_action << arc;
+  return 1;
+}
+
+size_t ActionProgress::SuggestChunk(size_t perCandidate, size_t minimum)
+{
+  return std::max(minimum, kChunkPairs / std::max<size_t>(perCandidate, 1));
+}
+
+double ActionProgress::Elapsed() const
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+}
+
+void ActionProgress::Publish()
+{
+  if (m_progressLink.IsValid())
+    NumericLink::WriteInteger(m_context, m_progressLink, static_cast<int64_t>(m_done));
+}
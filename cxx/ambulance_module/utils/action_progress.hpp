@@ -0,0 +1,82 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+#include <sc-memory/sc_memory.hpp>
+
+#include "utils/action_parameters.hpp"
+
+namespace ambulance_module
+{
+
+//ход долгого действия, работа которого идет блоками:
+//  concept_cancelled_action -> action - запрос отмены, проверяется между блоками;
+//  action -> rrel_time_budget: [секунды] - по истечении действие завершается с лучшим найденным ответом
+//    и попадает в concept_approximate_action;
+//  mode_progress - action => nrel_progress: [сделано], action => nrel_progress_total: [всего],
+//    значение переписывается не чаще kPublishIntervalSeconds
+class ActionProgress
+{
+public:
+  static constexpr double kPublishIntervalSeconds = 0.2;
+  //работы в блоке между проверками (пар расстояний)
+  static constexpr size_t kChunkPairs = size_t(1) << 22;
+
+  ActionProgress(ScMemoryContext & context, ScAddr const & action);
+
+  //false и текст ошибки, если бюджет задан неверно
+  bool Read(ActionParameters const & parameters, std::string & error);
+
+  bool HasBudget() const
+  {
+    return m_budgetSeconds > 0.0;
+  }
+
+  //объем работы в тех же единицах, что и Proceed; отсчет бюджета начинается здесь,
+  //здесь же первый раз проверяется отмена
+  void Begin(size_t total);
+
+  //сделано done из total; false - пора остановиться (отмена или бюджет исчерпан)
+  bool Proceed(size_t done);
+
+  bool IsCancelled() const
+  {
+    return m_cancelled;
+  }
+
+  bool IsOutOfTime() const
+  {
+    return m_outOfTime;
+  }
+
+  //итоговый ход; при остановке по бюджету действие помечается приближенным;
+  //возвращает число записанных элементов
+  size_t Finish(ScStructure & structure);
+
+  //переписывает ссылку хода текущим значением (если ход публикуется)
+  void Publish();
+
+  //сколько кандидатов оценивать за блок, если один стоит perCandidate пар
+  static size_t SuggestChunk(size_t perCandidate, size_t minimum);
+
+private:
+  double Elapsed() const;
+
+  ScMemoryContext & m_context;
+  ScAddr m_action;
+  bool m_publish = false;
+  double m_budgetSeconds = 0.0;
+
+  std::chrono::steady_clock::time_point m_start;
+  double m_lastCheck = 0.0;
+  size_t m_total = 0;
+  size_t m_done = 0;
+  bool m_cancelled = false;
+  bool m_outOfTime = false;
+
+  ScAddr m_progressLink;
+};
+
+}  // namespace ambulance_module
@@ -0,0 +1,239 @@
+#include "agent_metrics.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "keynodes/ambulance_keynodes.hpp"
+
+using namespace ambulance_module;
+
+namespace
+{
+
+char const * const kPhaseNames[kAgentPhaseCount] = {"load", "compute", "write"};
+char const * const kCounterNames[kAgentCounterCount] = {
+    "villages_loaded", "links_parsed", "link_parse_failures", "pairs_evaluated", "elements_written"};
+char const * const kCounterHelp[kAgentCounterCount] = {
+    "Villages in the snapshot the agent worked on.",
+    "Village property links parsed in the agent thread.",
+    "Village property links that did not hold a number.",
+    "Distances computed between a village and a point.",
+    "sc-elements generated and links rewritten."};
+
+struct AgentEntry
+{
+  std::string name;
+  AgentTotals totals;
+};
+
+std::mutex registryMutex;
+std::unordered_map<ScAddr::HashType, AgentEntry> registry;
+std::string dumpPath;
+//агенты завершаются параллельно, а временный файл дампа у всех один
+std::mutex dumpMutex;
+
+std::atomic<uint64_t> totalParsed{0};
+std::atomic<uint64_t> totalFailures{0};
+thread_local uint64_t threadParsed = 0;
+thread_local uint64_t threadFailures = 0;
+
+void WriteHeader(std::ostringstream & out, std::string const & name, char const * help, char const * type)
+{
+  out << "# HELP " << name << ' ' << help << '\n' << "# TYPE " << name << ' ' << type << '\n';
+}
+
+//строки метрики для каждого агента под одним заголовком;
+//prefix - ambulance_agent_ или ambulance_run_, suffix - _total у сумм
+void WriteRuns(
+    std::ostringstream & out,
+    std::vector<std::pair<std::string, AgentRun>> const & runs,
+    std::string const & prefix,
+    std::string const & suffix,
+    char const * type)
+{
+  std::string const name = prefix + "phase_seconds" + suffix;
+  WriteHeader(out, name, "Time spent in each agent phase.", type);
+  for (auto const & [action, run] : runs)
+  {
+    for (size_t phase = 0; phase < kAgentPhaseCount; ++phase)
+      out << name << "{action=\"" << action << "\",phase=\"" << kPhaseNames[phase] << "\"} " << run.seconds[phase]
+          << '\n';
+  }
+
+  for (size_t counter = 0; counter < kAgentCounterCount; ++counter)
+  {
+    std::string const counterName = prefix + kCounterNames[counter] + suffix;
+    WriteHeader(out, counterName, kCounterHelp[counter], type);
+    for (auto const & [action, run] : runs)
+      out << counterName << "{action=\"" << action << "\"} " << run.counters[counter] << '\n';
+  }
+}
+
+}  // namespace
+
+AgentMetrics::AgentMetrics(ScMemoryContext & context, ScAddr const & actionClass)
+  : m_context(context)
+  , m_actionClass(actionClass)
+  , m_name(context.GetElementSystemIdentifier(actionClass))
+  , m_parsedAtStart(threadParsed)
+  , m_failuresAtStart(threadFailures)
+{
+}
+
+AgentMetrics::~AgentMetrics()
+{
+  StopCurrent();
+  AgentRun const run = Collect();
+
+  std::string path;
+  {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    AgentEntry & entry = registry[m_actionClass.Hash()];
+    entry.name = m_name;
+    for (size_t phase = 0; phase < kAgentPhaseCount; ++phase)
+      entry.totals.sum.seconds[phase] += run.seconds[phase];
+    for (size_t counter = 0; counter < kAgentCounterCount; ++counter)
+      entry.totals.sum.counters[counter] += run.counters[counter];
+    entry.totals.last = run;
+    ++entry.totals.runs;
+    path = dumpPath;
+  }
+
+  if (!path.empty())
+    WriteDump(path);
+}
+
+void AgentMetrics::Start(AgentPhase phase)
+{
+  StopCurrent();
+  m_phase = phase;
+  m_running = true;
+  m_started = Clock::now();
+}
+
+void AgentMetrics::Add(AgentCounter counter, uint64_t value)
+{
+  m_run.counters[static_cast<size_t>(counter)] += value;
+}
+
+void AgentMetrics::StopCurrent()
+{
+  if (!m_running)
+    return;
+  Clock::time_point const now = Clock::now();
+  m_run.seconds[static_cast<size_t>(m_phase)] += std::chrono::duration<double>(now - m_started).count();
+  m_started = now;
+}
+
+AgentRun AgentMetrics::Collect()
+{
+  AgentRun run = m_run;
+  run.counters[static_cast<size_t>(AgentCounter::LinksParsed)] += threadParsed - m_parsedAtStart;
+  run.counters[static_cast<size_t>(AgentCounter::ParseFailures)] += threadFailures - m_failuresAtStart;
+  return run;
+}
+
+void AgentMetrics::AttachIfRequested(
+    ActionParameters const & parameters,
+    ScAddr const & action,
+    ScStructure & structure)
+{
+  if (parameters.HasMode(AmbulanceKeynodes::mode_metrics))
+    Attach(action, structure);
+}
+
+void AgentMetrics::Attach(ScAddr const & action, ScStructure & structure)
+{
+  //текущий этап учитывается до этой точки и продолжается
+  StopCurrent();
+  std::ostringstream out;
+  out.precision(9);
+  WriteRuns(out, {{m_name, Collect()}}, "ambulance_run_", "", "gauge");
+
+  //действие => nrel_metrics: [текст]
+  ScAddr const link = m_context.GenerateLink(ScType::ConstNodeLink);
+  m_context.SetLinkContent(link, out.str());
+  ScAddr const arc = m_context.GenerateConnector(ScType::ConstCommonArc, action, link);
+  ScAddr const relArc = m_context.GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_metrics, arc);
+  structure << link << arc << relArc << AmbulanceKeynodes::nrel_metrics;
+}
+
+void AgentMetrics::CountParsedLink(bool parsed)
+{
+  ++threadParsed;
+  totalParsed.fetch_add(1, std::memory_order_relaxed);
+  if (!parsed)
+  {
+    ++threadFailures;
+    totalFailures.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+AgentTotals AgentMetrics::GetTotals(ScAddr const & actionClass)
+{
+  std::lock_guard<std::mutex> lock(registryMutex);
+  auto const it = registry.find(actionClass.Hash());
+  return it == registry.end() ? AgentTotals() : it->second.totals;
+}
+
+std::string AgentMetrics::ExportText()
+{
+  std::ostringstream out;
+  out.precision(9);
+
+  //разбор ссылок во всех потоках, включая первичное заполнение кэша деревень
+  WriteHeader(out, "ambulance_links_parsed_total", "Village property links parsed by the module.", "counter");
+  out << "ambulance_links_parsed_total " << totalParsed.load(std::memory_order_relaxed) << '\n';
+  WriteHeader(
+      out, "ambulance_link_parse_failures_total", "Village property links that did not hold a number.", "counter");
+  out << "ambulance_link_parse_failures_total " << totalFailures.load(std::memory_order_relaxed) << '\n';
+
+  //агенты по имени, чтобы дамп не зависел от порядка первого запуска
+  std::vector<std::pair<std::string, AgentRun>> sums;
+  std::vector<std::pair<std::string, uint64_t>> runs;
+  {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (auto const & [hash, entry] : registry)
+    {
+      sums.emplace_back(entry.name, entry.totals.sum);
+      runs.emplace_back(entry.name, entry.totals.runs);
+    }
+  }
+  std::sort(sums.begin(), sums.end(), [](auto const & a, auto const & b) { return a.first < b.first; });
+  std::sort(runs.begin(), runs.end());
+
+  WriteHeader(out, "ambulance_agent_runs_total", "Completed agent runs.", "counter");
+  for (auto const & [name, count] : runs)
+    out << "ambulance_agent_runs_total{action=\"" << name << "\"} " << count << '\n';
+  WriteRuns(out, sums, "ambulance_agent_", "_total", "counter");
+  return out.str();
+}
+
+void AgentMetrics::SetDumpPath(std::string const & path)
+{
+  std::lock_guard<std::mutex> lock(registryMutex);
+  dumpPath = path;
+}
+
+bool AgentMetrics::WriteDump(std::string const & path)
+{
+  //через временный файл, чтобы сборщик не прочитал половину дампа
+  std::lock_guard<std::mutex> lock(dumpMutex);
+  std::string const temporary = path + ".tmp";
+  {
+    std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+    if (!file)
+      return false;
+    file << ExportText();
+    if (!file)
+      return false;
+  }
+  return std::rename(temporary.c_str(), path.c_str()) == 0;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <sc-memory/sc_memory.hpp>
+
+#include "utils/action_parameters.hpp"
+
+namespace ambulance_module
+{
+
+enum class AgentPhase : size_t
+{
+  Load,     //снимок деревень и метрика дорог
+  Compute,  //поиск по данным снимка
+  Write,    //генерация результатов в базе знаний
+};
+
+enum class AgentCounter : size_t
+{
+  VillagesLoaded,   //деревень в снимке
+  LinksParsed,      //ссылок свойств прочитано в потоке агента (при обновлении кэша или прямой загрузке)
+  ParseFailures,    //из них не числа
+  PairsEvaluated,   //вычисленных расстояний деревня-точка
+  ElementsWritten,  //созданных sc-элементов и переписанных ссылок
+};
+
+size_t constexpr kAgentPhaseCount = 3;
+size_t constexpr kAgentCounterCount = 5;
+
+//значения одного выполнения или сумма по выполнениям
+struct AgentRun
+{
+  std::array<double, kAgentPhaseCount> seconds{};
+  std::array<uint64_t, kAgentCounterCount> counters{};
+};
+
+struct AgentTotals
+{
+  AgentRun sum;
+  AgentRun last;
+  //итог пишется после FinishSuccessfully, ожидающий может сверять счетчик
+  uint64_t runs = 0;
+};
+
+//замеры одного выполнения агента: Start переключает этап (этапы могут чередоваться, время копится),
+//Add увеличивает счетчик; деструктор добавляет итог к суммам модуля под классом действия
+class AgentMetrics
+{
+public:
+  AgentMetrics(ScMemoryContext & context, ScAddr const & actionClass);
+  ~AgentMetrics();
+
+  AgentMetrics(AgentMetrics const &) = delete;
+  AgentMetrics & operator=(AgentMetrics const &) = delete;
+
+  void Start(AgentPhase phase);
+  void Add(AgentCounter counter, uint64_t value);
+
+  //действие => nrel_metrics: [текст Prometheus] со значениями этого выполнения до вызова
+  void Attach(ScAddr const & action, ScStructure & structure);
+  //то же, если у действия mode_metrics
+  void AttachIfRequested(ActionParameters const & parameters, ScAddr const & action, ScStructure & structure);
+
+  //разбор ссылки свойства деревни (VillageLoader); учитывается выполнением агента в этом же потоке
+  static void CountParsedLink(bool parsed);
+
+  static AgentTotals GetTotals(ScAddr const & actionClass);
+
+  //суммы всех агентов в текстовом формате Prometheus
+  static std::string ExportText();
+
+  //файл, который переписывается после каждого выполнения агента; пустой путь - без дампа
+  static void SetDumpPath(std::string const & path);
+  static bool WriteDump(std::string const & path);
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  void StopCurrent();
+  //счетчики разбора ссылок в потоке с начала выполнения
+  AgentRun Collect();
+
+  ScMemoryContext & m_context;
+  ScAddr m_actionClass;
+  std::string m_name;
+  AgentRun m_run;
+  uint64_t m_parsedAtStart = 0;
+  uint64_t m_failuresAtStart = 0;
+  bool m_running = false;
+  AgentPhase m_phase = AgentPhase::Load;
+  Clock::time_point m_started;
+};
+
+}  // namespace ambulance_module
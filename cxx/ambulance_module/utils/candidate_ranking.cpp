@@ -0,0 +1,59 @@
+#include "candidate_ranking.hpp"
+
+#include "keynodes/ambulance_keynodes.hpp"
+#include "utils/numeric_link.hpp"
+
+using namespace ambulance_module;
+
+bool CandidateRanking::ReadCount(ActionParameters const & parameters, size_t & count, std::string & error)
+{
+  count = 0;
+  double requested = 0.0;
+  if (!parameters.ReadNumber(AmbulanceKeynodes::rrel_top_k, requested))
+    return true;
+
+  if (!(requested >= 1.0 && requested <= static_cast<double>(kMaxCount)))
+  {
+    error = "rrel_top_k must be between 1 and " + std::to_string(kMaxCount) + ".";
+    return false;
+  }
+  count = static_cast<size_t>(requested);
+  return true;
+}
+
+size_t CandidateRanking::Write(
+    ScMemoryContext & context,
+    ScAddr const & action,
+    std::vector<ScAddr> const & addrs,
+    std::vector<CandidateResult> const & ranking,
+    ScStructure & structure)
+{
+  ScAddr const tuple = context.GenerateNode(ScType::ConstNodeTuple);
+  ScAddr const arc = context.GenerateConnector(ScType::ConstCommonArc, action, tuple);
+  ScAddr const relArc =
+      context.GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_candidate_ranking, arc);
+  structure << tuple << arc << relArc << AmbulanceKeynodes::nrel_candidate_ranking
+            << AmbulanceKeynodes::nrel_candidate_score;
+  size_t written = 3;
+
+  for (size_t place = 0; place < ranking.size(); ++place)
+  {
+    CandidateResult const & candidate = ranking[place];
+    ScAddr const village = addrs[candidate.index];
+    //порядковые роли rrel_1, rrel_2, ... создаются при первом обращении
+    ScAddr const role =
+        context.ResolveElementSystemIdentifier("rrel_" + std::to_string(place + 1), ScType::ConstNodeRole);
+
+    ScAddr const memberArc = context.GenerateConnector(ScType::ConstPermPosArc, tuple, village);
+    ScAddr const roleArc = context.GenerateConnector(ScType::ConstPermPosArc, role, memberArc);
+
+    ScAddr const link = NumericLink::Generate(context, candidate.score);
+    ScAddr const scoreArc = context.GenerateConnector(ScType::ConstCommonArc, memberArc, link);
+    ScAddr const scoreRelArc =
+        context.GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_candidate_score, scoreArc);
+
+    structure << village << role << memberArc << roleArc << link << scoreArc << scoreRelArc;
+    written += 5;
+  }
+  return written;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <sc-memory/sc_memory.hpp>
+
+#include "utils/action_parameters.hpp"
+#include "utils/candidate_search.hpp"
+
+namespace ambulance_module
+{
+
+//лучшие кандидаты в порядке места:
+//  действие => nrel_candidate_ranking: кортеж;
+//  кортеж -> rrel_<место>: деревня (rrel_1 - победитель);
+//  эта дуга => nrel_candidate_score: [счет]
+class CandidateRanking
+{
+public:
+  //наибольшее k: ранжирование не должно превращаться в выгрузку всех счетов
+  static constexpr size_t kMaxCount = 1000;
+
+  //action -> rrel_top_k: [k]; без параметра count = 0 (ранжирование не нужно)
+  static bool ReadCount(ActionParameters const & parameters, size_t & count, std::string & error);
+
+  //возвращает число записанных элементов
+  static size_t Write(
+      ScMemoryContext & context,
+      ScAddr const & action,
+      std::vector<ScAddr> const & addrs,
+      std::vector<CandidateResult> const & ranking,
+      ScStructure & structure);
+};
+
+}  // namespace ambulance_module
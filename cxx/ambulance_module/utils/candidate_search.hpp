@@ -0,0 +1,281 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+#include <sc-memory/sc_memory.hpp>
+
+#include "utils/thread_pool.hpp"
+
+namespace ambulance_module
+{
+
+struct CandidateResult
+{
+  static constexpr size_t kNone = std::numeric_limits<size_t>::max();
+
+  size_t index = kNone;
+  double score = std::numeric_limits<double>::infinity();
+  ScAddr::HashType hash = std::numeric_limits<ScAddr::HashType>::max();
+
+  bool Found() const
+  {
+    return index != kNone;
+  }
+
+  //меньший счет лучше, при равенстве - меньший хэш адреса; порядок не зависит от числа потоков
+  bool IsBetterThan(CandidateResult const & other) const
+  {
+    if (score != other.score)
+      return score < other.score;
+    return hash < other.hash;
+  }
+};
+
+//k лучших кандидатов: куча с худшим из оставленных в вершине, O(log k) на кандидата
+class TopCandidates
+{
+public:
+  explicit TopCandidates(size_t count = 1)
+    : m_count(count)
+  {
+    m_heap.reserve(count);
+  }
+
+  void Offer(CandidateResult const & candidate)
+  {
+    if (m_count == 0)
+      return;
+    if (m_heap.size() < m_count)
+    {
+      m_heap.push_back(candidate);
+      std::push_heap(m_heap.begin(), m_heap.end(), IsBetter);
+      return;
+    }
+    if (!candidate.IsBetterThan(m_heap.front()))
+      return;
+    std::pop_heap(m_heap.begin(), m_heap.end(), IsBetter);
+    m_heap.back() = candidate;
+    std::push_heap(m_heap.begin(), m_heap.end(), IsBetter);
+  }
+
+  void Merge(TopCandidates const & other)
+  {
+    for (CandidateResult const & candidate : other.m_heap)
+      Offer(candidate);
+  }
+
+  bool IsFull() const
+  {
+    return m_heap.size() == m_count;
+  }
+
+  //худший из оставленных (порог для отсечения), пока куча не полна - пустой результат
+  CandidateResult GetWorst() const
+  {
+    return IsFull() && m_count > 0 ? m_heap.front() : CandidateResult();
+  }
+
+  //от лучшего к худшему
+  std::vector<CandidateResult> TakeSorted()
+  {
+    std::sort_heap(m_heap.begin(), m_heap.end(), IsBetter);
+    return std::move(m_heap);
+  }
+
+private:
+  static bool IsBetter(CandidateResult const & left, CandidateResult const & right)
+  {
+    return left.IsBetterThan(right);
+  }
+
+  size_t m_count;
+  std::vector<CandidateResult> m_heap;
+};
+
+class CandidateSearch
+{
+public:
+  //сколько кандидатов поток забирает за раз
+  static constexpr size_t kGrain = 64;
+
+  //scores[i] = evaluate(i) для всех кандидатов параллельно, возвращает count лучших
+  //от лучшего к худшему; кучи потоков сливаются после цикла
+  template <typename TEvaluate>
+  static std::vector<CandidateResult> Rank(
+      ThreadPool & pool,
+      std::vector<ScAddr> const & addrs,
+      std::vector<double> & scores,
+      TEvaluate const & evaluate,
+      size_t count)
+  {
+    scores.assign(addrs.size(), std::numeric_limits<double>::infinity());
+    std::vector<TopCandidates> topPerWorker(pool.GetThreadCount(), TopCandidates(count));
+
+    pool.ParallelFor(
+        addrs.size(),
+        kGrain,
+        [&](size_t begin, size_t end, size_t worker)
+        {
+          TopCandidates & top = topPerWorker[worker];
+          for (size_t i = begin; i < end; ++i)
+          {
+            double const score = evaluate(i);
+            scores[i] = score;
+            if (std::isnan(score))
+              continue;
+            top.Offer({i, score, addrs[i].Hash()});
+          }
+        });
+
+    TopCandidates top(count);
+    for (TopCandidates const & local : topPerWorker)
+      top.Merge(local);
+    return top.TakeSorted();
+  }
+
+  //то же блоками по chunk кандидатов в порядке order; после каждого блока proceed(оценено) решает,
+  //продолжать ли; при остановке результат - лучшие среди оцененных, счета остальных - NaN
+  template <typename TEvaluate, typename TProceed>
+  static std::vector<CandidateResult> RankChunked(
+      ThreadPool & pool,
+      std::vector<ScAddr> const & addrs,
+      std::vector<size_t> const & order,
+      std::vector<double> & scores,
+      TEvaluate const & evaluate,
+      size_t count,
+      size_t chunk,
+      TProceed const & proceed)
+  {
+    scores.assign(addrs.size(), std::numeric_limits<double>::quiet_NaN());
+    std::vector<TopCandidates> topPerWorker(pool.GetThreadCount(), TopCandidates(count));
+    chunk = std::max<size_t>(chunk, 1);
+
+    for (size_t chunkBegin = 0; chunkBegin < order.size(); chunkBegin += chunk)
+    {
+      size_t const chunkEnd = std::min(order.size(), chunkBegin + chunk);
+      pool.ParallelFor(
+          chunkEnd - chunkBegin,
+          kGrain,
+          [&](size_t begin, size_t end, size_t worker)
+          {
+            TopCandidates & top = topPerWorker[worker];
+            for (size_t k = chunkBegin + begin; k < chunkBegin + end; ++k)
+            {
+              size_t const i = order[k];
+              double const score = evaluate(i);
+              scores[i] = score;
+              if (std::isnan(score))
+                continue;
+              top.Offer({i, score, addrs[i].Hash()});
+            }
+          });
+      //после последнего блока работа сделана, останавливать нечего
+      if (chunkEnd < order.size() && !proceed(chunkEnd))
+        break;
+    }
+
+    TopCandidates top(count);
+    for (TopCandidates const & local : topPerWorker)
+      top.Merge(local);
+    return top.TakeSorted();
+  }
+
+  //индексы по возрастанию расстояния до точки (px, py): при ранней остановке
+  //оцененными окажутся кандидаты рядом с ожидаемым ответом
+  static std::vector<size_t> OrderByDistance(double const * xs, double const * ys, size_t count, double px, double py)
+  {
+    std::vector<double> distances(count);
+    std::vector<size_t> order(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+      distances[i] = std::hypot(xs[i] - px, ys[i] - py);
+      order[i] = i;
+    }
+    std::sort(
+        order.begin(),
+        order.end(),
+        [&](size_t a, size_t b)
+        {
+          return distances[a] < distances[b] || (distances[a] == distances[b] && a < b);
+        });
+    return order;
+  }
+
+  //count лучших по уже посчитанным счетам (NaN пропускаются)
+  static std::vector<CandidateResult> RankScores(
+      std::vector<ScAddr> const & addrs,
+      std::vector<double> const & scores,
+      size_t count)
+  {
+    TopCandidates top(count);
+    for (size_t i = 0; i < addrs.size(); ++i)
+    {
+      if (!std::isnan(scores[i]))
+        top.Offer({i, scores[i], addrs[i].Hash()});
+    }
+    return top.TakeSorted();
+  }
+
+  //count лучших, кандидаты оцениваются блоками в порядке order (лучшие ожидаемые - первыми);
+  //isBoundAbove(i, threshold) должен вернуть true, если нижняя граница счета кандидата
+  //выше threshold - худшего из count лучших на начало блока с запасом slack на погрешность;
+  //такой кандидат точно не оценивается; пока лучших не набралось - без отсечения
+  template <typename TEvaluate, typename TBoundCheck>
+  static std::vector<CandidateResult> RankOrdered(
+      ThreadPool & pool,
+      std::vector<ScAddr> const & addrs,
+      std::vector<size_t> const & order,
+      TBoundCheck const & isBoundAbove,
+      TEvaluate const & evaluate,
+      double slack,
+      size_t count,
+      size_t & evaluatedCount)
+  {
+    TopCandidates top(count);
+    evaluatedCount = 0;
+    size_t const blockSize = kGrain * pool.GetThreadCount();
+
+    std::atomic<size_t> evaluated{0};
+    for (size_t blockBegin = 0; blockBegin < order.size(); blockBegin += blockSize)
+    {
+      //равные счета тоже оцениваются, чтобы сохранить правило меньшего адреса
+      CandidateResult const worst = top.GetWorst();
+      double const threshold =
+          worst.Found() ? worst.score + slack * std::fabs(worst.score) : std::numeric_limits<double>::infinity();
+
+      size_t const blockEnd = std::min(order.size(), blockBegin + blockSize);
+      std::vector<TopCandidates> topPerWorker(pool.GetThreadCount(), TopCandidates(count));
+      pool.ParallelFor(
+          blockEnd - blockBegin,
+          kGrain,
+          [&](size_t begin, size_t end, size_t worker)
+          {
+            TopCandidates & local = topPerWorker[worker];
+            for (size_t k = blockBegin + begin; k < blockBegin + end; ++k)
+            {
+              size_t const i = order[k];
+              if (isBoundAbove(i, threshold))
+                continue;
+
+              evaluated.fetch_add(1, std::memory_order_relaxed);
+              double const score = evaluate(i);
+              if (std::isnan(score))
+                continue;
+              local.Offer({i, score, addrs[i].Hash()});
+            }
+          });
+
+      for (TopCandidates const & local : topPerWorker)
+        top.Merge(local);
+    }
+    evaluatedCount = evaluated.load();
+    return top.TakeSorted();
+  }
+};
+
+}  // namespace ambulance_module
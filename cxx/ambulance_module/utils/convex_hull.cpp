@@ -0,0 +1,62 @@
+#include "convex_hull.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+using namespace ambulance_module;
+
+std::vector<size_t> ConvexHull::Build(std::vector<double> const & xs, std::vector<double> const & ys)
+{
+  std::vector<size_t> order(xs.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(
+      order.begin(),
+      order.end(),
+      [&](size_t a, size_t b)
+      {
+        return xs[a] < xs[b] || (xs[a] == xs[b] && ys[a] < ys[b]);
+      });
+  order.erase(
+      std::unique(
+          order.begin(),
+          order.end(),
+          [&](size_t a, size_t b)
+          {
+            return xs[a] == xs[b] && ys[a] == ys[b];
+          }),
+      order.end());
+
+  if (order.size() < 3)
+    return order;
+
+  //векторное произведение OA x OB; <= 0 - поворот не влево
+  auto const Cross = [&](size_t o, size_t a, size_t b)
+  {
+    return (xs[a] - xs[o]) * (ys[b] - ys[o]) - (ys[a] - ys[o]) * (xs[b] - xs[o]);
+  };
+
+  std::vector<size_t> hull(2 * order.size());
+  size_t size = 0;
+
+  //нижняя цепь
+  for (size_t const point : order)
+  {
+    while (size >= 2 && Cross(hull[size - 2], hull[size - 1], point) <= 0)
+      --size;
+    hull[size++] = point;
+  }
+
+  //верхняя цепь
+  size_t const lowerSize = size + 1;
+  for (size_t i = order.size() - 1; i-- > 0;)
+  {
+    size_t const point = order[i];
+    while (size >= lowerSize && Cross(hull[size - 2], hull[size - 1], point) <= 0)
+      --size;
+    hull[size++] = point;
+  }
+
+  //последняя точка совпадает с первой
+  hull.resize(size - 1);
+  return hull;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace ambulance_module
+{
+
+//выпуклая оболочка точек; самая дальняя точка от любой точки плоскости всегда ее вершина
+class ConvexHull
+{
+public:
+  //индексы вершин против часовой стрелки (монотонная цепь Эндрю, O(n log n));
+  //точки на ребрах и повторы не входят; для n < 3 возвращаются все различные точки
+  static std::vector<size_t> Build(std::vector<double> const & xs, std::vector<double> const & ys);
+};
+
+}  // namespace ambulance_module
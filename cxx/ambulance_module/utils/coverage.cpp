@@ -0,0 +1,177 @@
+#include "coverage.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "utils/kd_tree.hpp"
+
+using namespace ambulance_module;
+
+namespace
+{
+
+//деревни, которые поток обрабатывает за раз
+size_t const kCoverageGrain = 1024;
+
+//result.station и result.distance уже содержат ближайшую станцию (kNone - станций нет);
+//candidates(i) - станции в радиусе от деревни i по возрастанию расстояния: пары (расстояние, позиция)
+template <typename TCandidates>
+void Distribute(
+    VillageSnapshot const & villages,
+    size_t stationCount,
+    double radius,
+    double capacity,
+    TCandidates const & candidates,
+    CoverageResult & result)
+{
+  size_t const size = villages.Size();
+  for (size_t i = 0; i < size; ++i)
+  {
+    if (!(result.distance[i] <= radius))
+      result.station[i] = CoverageResult::kNone;
+  }
+
+  if (!std::isinf(capacity))
+  {
+    //ближние деревни занимают станции первыми (при равенстве - меньший индекс)
+    std::vector<size_t> order;
+    for (size_t i = 0; i < size; ++i)
+    {
+      if (result.station[i] != CoverageResult::kNone)
+        order.push_back(i);
+    }
+    std::sort(
+        order.begin(),
+        order.end(),
+        [&](size_t a, size_t b)
+        {
+          return result.distance[a] < result.distance[b] || (result.distance[a] == result.distance[b] && a < b);
+        });
+
+    std::vector<double> remaining(stationCount, capacity);
+    for (size_t const i : order)
+    {
+      double const population = villages.population[i];
+      size_t const nearest = result.station[i];
+      if (remaining[nearest] >= population)
+      {
+        remaining[nearest] -= population;
+        continue;
+      }
+
+      //ближайшая заполнена - следующая по расстоянию станция в радиусе
+      result.station[i] = CoverageResult::kNone;
+      for (std::pair<double, size_t> const & candidate : candidates(i))
+      {
+        if (remaining[candidate.second] >= population)
+        {
+          remaining[candidate.second] -= population;
+          result.station[i] = candidate.second;
+          result.distance[i] = candidate.first;
+          break;
+        }
+      }
+    }
+  }
+
+  for (size_t i = 0; i < size; ++i)
+  {
+    if (result.station[i] == CoverageResult::kNone)
+    {
+      result.uncoveredPopulation += villages.population[i];
+      ++result.uncoveredCount;
+    }
+    else
+      result.coveredPopulation += villages.population[i];
+  }
+}
+
+}  // namespace
+
+CoverageResult Coverage::Assign(
+    ThreadPool & pool,
+    VillageSnapshot const & villages,
+    std::vector<size_t> const & stations,
+    double radius,
+    double capacity)
+{
+  size_t const size = villages.Size();
+  CoverageResult result;
+  result.station.assign(size, CoverageResult::kNone);
+  result.distance.assign(size, std::numeric_limits<double>::infinity());
+
+  std::vector<double> stationX;
+  std::vector<double> stationY;
+  stationX.reserve(stations.size());
+  stationY.reserve(stations.size());
+  for (size_t const station : stations)
+  {
+    stationX.push_back(villages.x[station]);
+    stationY.push_back(villages.y[station]);
+  }
+  KdTree const tree(stationX.data(), stationY.data(), stationX.size());
+
+  //ближайшая станция через k-d дерево: O(log p) на деревню
+  pool.ParallelFor(
+      size,
+      kCoverageGrain,
+      [&](size_t begin, size_t end, size_t)
+      {
+        for (size_t i = begin; i < end; ++i)
+          result.station[i] = tree.Nearest(villages.x[i], villages.y[i], &result.distance[i]);
+      });
+
+  auto const candidates = [&](size_t i)
+  {
+    std::vector<std::pair<double, size_t>> found;
+    for (size_t const slot : tree.Radius(villages.x[i], villages.y[i], radius))
+      found.emplace_back(std::hypot(villages.x[i] - stationX[slot], villages.y[i] - stationY[slot]), slot);
+    return found;
+  };
+  Distribute(villages, stations.size(), radius, capacity, candidates, result);
+  return result;
+}
+
+CoverageResult Coverage::Assign(
+    RoadMetric const & metric,
+    VillageSnapshot const & villages,
+    std::vector<size_t> const & stations,
+    double radius,
+    double capacity)
+{
+  size_t const size = villages.Size();
+  CoverageResult result;
+  result.station.assign(size, CoverageResult::kNone);
+  result.distance.assign(size, std::numeric_limits<double>::infinity());
+
+  //дороги двусторонние: строка станции - время до нее от каждой деревни
+  std::vector<double> row(size);
+  for (size_t slot = 0; slot < stations.size(); ++slot)
+  {
+    metric.Row(stations[slot], row.data());
+    for (size_t i = 0; i < size; ++i)
+    {
+      if (row[i] < result.distance[i])
+      {
+        result.distance[i] = row[i];
+        result.station[i] = slot;
+      }
+    }
+  }
+
+  auto const candidates = [&](size_t i)
+  {
+    std::vector<std::pair<double, size_t>> found;
+    for (size_t slot = 0; slot < stations.size(); ++slot)
+    {
+      double const time = metric.At(stations[slot], i);
+      if (time <= radius)
+        found.emplace_back(time, slot);
+    }
+    std::sort(found.begin(), found.end());
+    return found;
+  };
+  Distribute(villages, stations.size(), radius, capacity, candidates, result);
+  return result;
+}
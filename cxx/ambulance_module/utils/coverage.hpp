@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+#include "utils/road_network.hpp"
+#include "utils/thread_pool.hpp"
+#include "utils/village_loader.hpp"
+
+namespace ambulance_module
+{
+
+struct CoverageResult
+{
+  static constexpr size_t kNone = std::numeric_limits<size_t>::max();
+
+  //для каждой деревни: позиция обслуживающей станции в списке станций или kNone
+  std::vector<size_t> station;
+  //расстояние до обслуживающей станции, для необслуженных - до ближайшей
+  std::vector<double> distance;
+  double coveredPopulation = 0.0;
+  double uncoveredPopulation = 0.0;
+  size_t uncoveredCount = 0;
+};
+
+//покрытие деревень станциями в радиусе выезда: ближайшая станция через k-d дерево по станциям,
+//O(n log p); при ограниченной вместимости деревни от ближних к дальним занимают ближайшую станцию
+//с остатком, а если его нет - следующую в радиусе
+class Coverage
+{
+public:
+  static CoverageResult Assign(
+      ThreadPool & pool,
+      VillageSnapshot const & villages,
+      std::vector<size_t> const & stations,
+      double radius,
+      double capacity = std::numeric_limits<double>::infinity());
+
+  //то же по времени проезда по дорогам: станции перебираются строками матрицы, O(n * p)
+  static CoverageResult Assign(
+      RoadMetric const & metric,
+      VillageSnapshot const & villages,
+      std::vector<size_t> const & stations,
+      double radius,
+      double capacity = std::numeric_limits<double>::infinity());
+};
+
+}  // namespace ambulance_module
@@ -0,0 +1,368 @@
+#include "distance_kernel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#  define AMBULANCE_KERNEL_X86 1
+#  include <immintrin.h>
+#endif
+
+using namespace ambulance_module;
+
+//std::hypot защищается от переполнения и поэтому медленный; координаты деревень
+//далеки от границ double, так что считаем sqrt(dx*dx + dy*dy) без FMA на всех путях -
+//точный режим дает тот же результат, что и скалярный код, а быстрый не зависит от процессора
+
+namespace
+{
+
+std::atomic<int> selectedIsa{-1};
+
+// ---------- скалярная версия ----------
+
+inline double ScalarDistance(double dx, double dy, KernelPrecision precision)
+{
+  if (precision == KernelPrecision::Fast)
+  {
+    float const fx = static_cast<float>(dx);
+    float const fy = static_cast<float>(dy);
+    return std::sqrt(fx * fx + fy * fy);
+  }
+  return std::sqrt(dx * dx + dy * dy);
+}
+
+void ScalarRow(
+    double const * xs, double const * ys, size_t count, double px, double py, double * out, KernelPrecision precision)
+{
+  for (size_t i = 0; i < count; ++i)
+    out[i] = ScalarDistance(xs[i] - px, ys[i] - py, precision);
+}
+
+double ScalarRowMax(
+    double const * xs, double const * ys, size_t count, double px, double py, KernelPrecision precision)
+{
+  double result = 0.0;
+  for (size_t i = 0; i < count; ++i)
+    result = std::max(result, ScalarDistance(xs[i] - px, ys[i] - py, precision));
+  return result;
+}
+
+double ScalarRowWeightedSum(
+    double const * xs,
+    double const * ys,
+    double const * weights,
+    size_t count,
+    double px,
+    double py,
+    KernelPrecision precision)
+{
+  double result = 0.0;
+  for (size_t i = 0; i < count; ++i)
+    result += ScalarDistance(xs[i] - px, ys[i] - py, precision) * weights[i];
+  return result;
+}
+
+#if defined(AMBULANCE_KERNEL_X86)
+
+// ---------- AVX2: 4 double или 8 float за шаг ----------
+
+__attribute__((target("avx2"))) inline __m256d Avx2Distance(
+    double const * xs, double const * ys, __m256d px, __m256d py)
+{
+  __m256d const dx = _mm256_sub_pd(_mm256_loadu_pd(xs), px);
+  __m256d const dy = _mm256_sub_pd(_mm256_loadu_pd(ys), py);
+  return _mm256_sqrt_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)));
+}
+
+//8 расстояний в float: разности считаются в double, корень в float
+__attribute__((target("avx2"))) inline __m256 Avx2FastDistance(
+    double const * xs, double const * ys, __m256d px, __m256d py)
+{
+  __m128 const dxLow = _mm256_cvtpd_ps(_mm256_sub_pd(_mm256_loadu_pd(xs), px));
+  __m128 const dxHigh = _mm256_cvtpd_ps(_mm256_sub_pd(_mm256_loadu_pd(xs + 4), px));
+  __m128 const dyLow = _mm256_cvtpd_ps(_mm256_sub_pd(_mm256_loadu_pd(ys), py));
+  __m128 const dyHigh = _mm256_cvtpd_ps(_mm256_sub_pd(_mm256_loadu_pd(ys + 4), py));
+  __m256 const dx = _mm256_insertf128_ps(_mm256_castps128_ps256(dxLow), dxHigh, 1);
+  __m256 const dy = _mm256_insertf128_ps(_mm256_castps128_ps256(dyLow), dyHigh, 1);
+  return _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)));
+}
+
+__attribute__((target("avx2"))) inline double Avx2HorizontalMax(__m256d value)
+{
+  __m128d const half = _mm_max_pd(_mm256_castpd256_pd128(value), _mm256_extractf128_pd(value, 1));
+  return std::max(_mm_cvtsd_f64(half), _mm_cvtsd_f64(_mm_unpackhi_pd(half, half)));
+}
+
+__attribute__((target("avx2"))) inline double Avx2HorizontalSum(__m256d value)
+{
+  __m128d const half = _mm_add_pd(_mm256_castpd256_pd128(value), _mm256_extractf128_pd(value, 1));
+  return _mm_cvtsd_f64(half) + _mm_cvtsd_f64(_mm_unpackhi_pd(half, half));
+}
+
+__attribute__((target("avx2"))) void Avx2Row(
+    double const * xs, double const * ys, size_t count, double px, double py, double * out, KernelPrecision precision)
+{
+  __m256d const vpx = _mm256_set1_pd(px);
+  __m256d const vpy = _mm256_set1_pd(py);
+  size_t i = 0;
+  if (precision == KernelPrecision::Fast)
+  {
+    for (; i + 8 <= count; i += 8)
+    {
+      __m256 const dist = Avx2FastDistance(xs + i, ys + i, vpx, vpy);
+      _mm256_storeu_pd(out + i, _mm256_cvtps_pd(_mm256_castps256_ps128(dist)));
+      _mm256_storeu_pd(out + i + 4, _mm256_cvtps_pd(_mm256_extractf128_ps(dist, 1)));
+    }
+  }
+  else
+  {
+    for (; i + 4 <= count; i += 4)
+      _mm256_storeu_pd(out + i, Avx2Distance(xs + i, ys + i, vpx, vpy));
+  }
+  ScalarRow(xs + i, ys + i, count - i, px, py, out + i, precision);
+}
+
+__attribute__((target("avx2"))) double Avx2RowMax(
+    double const * xs, double const * ys, size_t count, double px, double py, KernelPrecision precision)
+{
+  __m256d const vpx = _mm256_set1_pd(px);
+  __m256d const vpy = _mm256_set1_pd(py);
+  __m256d best = _mm256_setzero_pd();
+  size_t i = 0;
+  if (precision == KernelPrecision::Fast)
+  {
+    __m256 bestFast = _mm256_setzero_ps();
+    for (; i + 8 <= count; i += 8)
+      bestFast = _mm256_max_ps(bestFast, Avx2FastDistance(xs + i, ys + i, vpx, vpy));
+    best = _mm256_max_pd(
+        _mm256_cvtps_pd(_mm256_castps256_ps128(bestFast)), _mm256_cvtps_pd(_mm256_extractf128_ps(bestFast, 1)));
+  }
+  else
+  {
+    for (; i + 4 <= count; i += 4)
+      best = _mm256_max_pd(best, Avx2Distance(xs + i, ys + i, vpx, vpy));
+  }
+  return std::max(Avx2HorizontalMax(best), ScalarRowMax(xs + i, ys + i, count - i, px, py, precision));
+}
+
+__attribute__((target("avx2"))) double Avx2RowWeightedSum(
+    double const * xs,
+    double const * ys,
+    double const * weights,
+    size_t count,
+    double px,
+    double py,
+    KernelPrecision precision)
+{
+  __m256d const vpx = _mm256_set1_pd(px);
+  __m256d const vpy = _mm256_set1_pd(py);
+  __m256d sum = _mm256_setzero_pd();
+  size_t i = 0;
+  //без FMA в обоих режимах, как на AVX-512 и скалярном пути: отличается только порядок сложения
+  if (precision == KernelPrecision::Fast)
+  {
+    for (; i + 8 <= count; i += 8)
+    {
+      __m256 const dist = Avx2FastDistance(xs + i, ys + i, vpx, vpy);
+      sum = _mm256_add_pd(
+          sum, _mm256_mul_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(dist)), _mm256_loadu_pd(weights + i)));
+      sum = _mm256_add_pd(
+          sum, _mm256_mul_pd(_mm256_cvtps_pd(_mm256_extractf128_ps(dist, 1)), _mm256_loadu_pd(weights + i + 4)));
+    }
+  }
+  else
+  {
+    for (; i + 4 <= count; i += 4)
+      sum = _mm256_add_pd(sum, _mm256_mul_pd(Avx2Distance(xs + i, ys + i, vpx, vpy), _mm256_loadu_pd(weights + i)));
+  }
+  return Avx2HorizontalSum(sum) + ScalarRowWeightedSum(xs + i, ys + i, weights + i, count - i, px, py, precision);
+}
+
+// ---------- AVX-512: 8 double за шаг, хвост через маску ----------
+
+__attribute__((target("avx512f"))) inline __m512d Avx512Distance(
+    double const * xs, double const * ys, __m512d px, __m512d py, __mmask8 mask)
+{
+  __m512d const dx = _mm512_sub_pd(_mm512_maskz_loadu_pd(mask, xs), px);
+  __m512d const dy = _mm512_sub_pd(_mm512_maskz_loadu_pd(mask, ys), py);
+  return _mm512_sqrt_pd(_mm512_add_pd(_mm512_mul_pd(dx, dx), _mm512_mul_pd(dy, dy)));
+}
+
+__attribute__((target("avx512f"))) inline __m512d Avx512FastDistance(
+    double const * xs, double const * ys, __m512d px, __m512d py, __mmask8 mask)
+{
+  __m256 const dx = _mm512_cvtpd_ps(_mm512_sub_pd(_mm512_maskz_loadu_pd(mask, xs), px));
+  __m256 const dy = _mm512_cvtpd_ps(_mm512_sub_pd(_mm512_maskz_loadu_pd(mask, ys), py));
+  __m256 const squared = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+  return _mm512_cvtps_pd(_mm256_sqrt_ps(squared));
+}
+
+inline __mmask8 TailMask(size_t rest)
+{
+  return rest >= 8 ? static_cast<__mmask8>(0xFF) : static_cast<__mmask8>((1u << rest) - 1u);
+}
+
+__attribute__((target("avx512f"))) inline __m512d Avx512Select(
+    double const * xs, double const * ys, __m512d px, __m512d py, __mmask8 mask, KernelPrecision precision)
+{
+  return precision == KernelPrecision::Fast ? Avx512FastDistance(xs, ys, px, py, mask)
+                                            : Avx512Distance(xs, ys, px, py, mask);
+}
+
+__attribute__((target("avx512f"))) void Avx512Row(
+    double const * xs, double const * ys, size_t count, double px, double py, double * out, KernelPrecision precision)
+{
+  __m512d const vpx = _mm512_set1_pd(px);
+  __m512d const vpy = _mm512_set1_pd(py);
+  for (size_t i = 0; i < count; i += 8)
+  {
+    __mmask8 const mask = TailMask(count - i);
+    _mm512_mask_storeu_pd(out + i, mask, Avx512Select(xs + i, ys + i, vpx, vpy, mask, precision));
+  }
+}
+
+__attribute__((target("avx512f"))) double Avx512RowMax(
+    double const * xs, double const * ys, size_t count, double px, double py, KernelPrecision precision)
+{
+  __m512d const vpx = _mm512_set1_pd(px);
+  __m512d const vpy = _mm512_set1_pd(py);
+  __m512d best = _mm512_setzero_pd();
+  for (size_t i = 0; i < count; i += 8)
+  {
+    __mmask8 const mask = TailMask(count - i);
+    best = _mm512_mask_max_pd(best, mask, best, Avx512Select(xs + i, ys + i, vpx, vpy, mask, precision));
+  }
+  return _mm512_reduce_max_pd(best);
+}
+
+__attribute__((target("avx512f"))) double Avx512RowWeightedSum(
+    double const * xs,
+    double const * ys,
+    double const * weights,
+    size_t count,
+    double px,
+    double py,
+    KernelPrecision precision)
+{
+  __m512d const vpx = _mm512_set1_pd(px);
+  __m512d const vpy = _mm512_set1_pd(py);
+  __m512d sum = _mm512_setzero_pd();
+  for (size_t i = 0; i < count; i += 8)
+  {
+    __mmask8 const mask = TailMask(count - i);
+    __m512d const dist = Avx512Select(xs + i, ys + i, vpx, vpy, mask, precision);
+    sum = _mm512_add_pd(sum, _mm512_mul_pd(dist, _mm512_maskz_loadu_pd(mask, weights + i)));
+  }
+  return _mm512_reduce_add_pd(sum);
+}
+
+#endif
+
+KernelIsa DetectIsa()
+{
+#if defined(AMBULANCE_KERNEL_X86)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f"))
+    return KernelIsa::Avx512;
+  if (__builtin_cpu_supports("avx2"))
+    return KernelIsa::Avx2;
+#endif
+  return KernelIsa::Scalar;
+}
+
+}  // namespace
+
+KernelIsa DistanceKernel::GetSupportedIsa()
+{
+  static KernelIsa const supported = DetectIsa();
+  return supported;
+}
+
+KernelIsa DistanceKernel::GetIsa()
+{
+  int isa = selectedIsa.load(std::memory_order_relaxed);
+  if (isa < 0)
+  {
+    isa = static_cast<int>(GetSupportedIsa());
+    selectedIsa.store(isa, std::memory_order_relaxed);
+  }
+  return static_cast<KernelIsa>(isa);
+}
+
+void DistanceKernel::SetIsa(KernelIsa isa)
+{
+  KernelIsa const supported = GetSupportedIsa();
+  selectedIsa.store(static_cast<int>(std::min(isa, supported)), std::memory_order_relaxed);
+}
+
+char const * DistanceKernel::GetIsaName(KernelIsa isa)
+{
+  switch (isa)
+  {
+  case KernelIsa::Avx512:
+    return "avx512";
+  case KernelIsa::Avx2:
+    return "avx2";
+  default:
+    return "scalar";
+  }
+}
+
+void DistanceKernel::Row(
+    double const * xs, double const * ys, size_t count, double px, double py, double * out, KernelPrecision precision)
+{
+#if defined(AMBULANCE_KERNEL_X86)
+  switch (GetIsa())
+  {
+  case KernelIsa::Avx512:
+    return Avx512Row(xs, ys, count, px, py, out, precision);
+  case KernelIsa::Avx2:
+    return Avx2Row(xs, ys, count, px, py, out, precision);
+  default:
+    break;
+  }
+#endif
+  ScalarRow(xs, ys, count, px, py, out, precision);
+}
+
+double DistanceKernel::RowMax(
+    double const * xs, double const * ys, size_t count, double px, double py, KernelPrecision precision)
+{
+#if defined(AMBULANCE_KERNEL_X86)
+  switch (GetIsa())
+  {
+  case KernelIsa::Avx512:
+    return Avx512RowMax(xs, ys, count, px, py, precision);
+  case KernelIsa::Avx2:
+    return Avx2RowMax(xs, ys, count, px, py, precision);
+  default:
+    break;
+  }
+#endif
+  return ScalarRowMax(xs, ys, count, px, py, precision);
+}
+
+double DistanceKernel::RowWeightedSum(
+    double const * xs,
+    double const * ys,
+    double const * weights,
+    size_t count,
+    double px,
+    double py,
+    KernelPrecision precision)
+{
+#if defined(AMBULANCE_KERNEL_X86)
+  switch (GetIsa())
+  {
+  case KernelIsa::Avx512:
+    return Avx512RowWeightedSum(xs, ys, weights, count, px, py, precision);
+  case KernelIsa::Avx2:
+    return Avx2RowWeightedSum(xs, ys, weights, count, px, py, precision);
+  default:
+    break;
+  }
+#endif
+  return ScalarRowWeightedSum(xs, ys, weights, count, px, py, precision);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+
+namespace ambulance_module
+{
+
+enum class KernelPrecision
+{
+  Exact,  //double, sqrt(dx*dx + dy*dy) с корректным округлением - как в скалярном коде
+  Fast    //корень в float, примерно 7 значащих цифр
+};
+
+enum class KernelIsa
+{
+  Scalar,
+  Avx2,
+  Avx512
+};
+
+//евклидовы расстояния от точки (px, py) до массивов xs/ys (структура массивов)
+//набор инструкций выбирается при первом вызове по возможностям процессора
+class DistanceKernel
+{
+public:
+  static KernelIsa GetIsa();
+  //принудительный выбор (для тестов и бенчмарков); неподдерживаемый набор понижается
+  static void SetIsa(KernelIsa isa);
+  static KernelIsa GetSupportedIsa();
+  static char const * GetIsaName(KernelIsa isa);
+
+  static void Row(
+      double const * xs,
+      double const * ys,
+      size_t count,
+      double px,
+      double py,
+      double * out,
+      KernelPrecision precision = KernelPrecision::Exact);
+
+  static double RowMax(
+      double const * xs,
+      double const * ys,
+      size_t count,
+      double px,
+      double py,
+      KernelPrecision precision = KernelPrecision::Exact);
+
+  static double RowWeightedSum(
+      double const * xs,
+      double const * ys,
+      double const * weights,
+      size_t count,
+      double px,
+      double py,
+      KernelPrecision precision = KernelPrecision::Exact);
+};
+
+}  // namespace ambulance_module
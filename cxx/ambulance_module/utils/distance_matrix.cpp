@@ -0,0 +1,209 @@
+#include "distance_matrix.hpp"
+
+#include <cstring>
+
+#include <sc-memory/sc_stream.hpp>
+
+#include "keynodes/ambulance_keynodes.hpp"
+#include "utils/distance_writer.hpp"
+
+using namespace ambulance_module;
+
+namespace
+{
+
+char const kMagic[] = {'A', 'D', 'M', 'X'};
+uint8_t const kFormatVersion = 1;
+
+//magic, версия, точность, 2 байта выравнивания, число деревень
+size_t const kHeaderSize = sizeof(kMagic) + 4 + sizeof(uint64_t);
+
+template <typename T>
+void Append(std::vector<char> & buffer, T const & value)
+{
+  char const * bytes = reinterpret_cast<char const *>(&value);
+  buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+}  // namespace
+
+DistanceMatrix::DistanceMatrix(std::vector<ScAddr> const & addrs, MatrixPrecision precision)
+  : m_addrs(addrs)
+  , m_precision(precision)
+{
+  size_t const pairs = PairCount(m_addrs.size());
+  if (m_precision == MatrixPrecision::Float)
+    m_floats.assign(pairs, 0.0f);
+  else
+    m_doubles.assign(pairs, 0.0);
+  BuildIndex();
+}
+
+void DistanceMatrix::BuildIndex()
+{
+  m_index.clear();
+  m_index.reserve(m_addrs.size());
+  for (size_t i = 0; i < m_addrs.size(); ++i)
+    m_index.emplace(m_addrs[i].Hash(), i);
+}
+
+void DistanceMatrix::Set(size_t i, size_t j, double distance)
+{
+  if (i == j)
+    return;
+  if (i > j)
+    std::swap(i, j);
+
+  size_t const index = PairIndex(i, j, Size());
+  if (m_precision == MatrixPrecision::Float)
+    m_floats[index] = static_cast<float>(distance);
+  else
+    m_doubles[index] = distance;
+}
+
+double DistanceMatrix::At(size_t i, size_t j) const
+{
+  if (i == j)
+    return 0.0;
+  if (i > j)
+    std::swap(i, j);
+
+  size_t const index = PairIndex(i, j, Size());
+  if (m_precision == MatrixPrecision::Float)
+    return m_floats[index];
+  return m_doubles[index];
+}
+
+size_t DistanceMatrix::IndexOf(ScAddr const & addr) const
+{
+  auto const found = m_index.find(addr.Hash());
+  return found == m_index.cend() ? Size() : found->second;
+}
+
+bool DistanceMatrix::Find(ScAddr const & first, ScAddr const & second, double & distance) const
+{
+  size_t const i = IndexOf(first);
+  size_t const j = IndexOf(second);
+  if (i == Size() || j == Size())
+    return false;
+
+  distance = At(i, j);
+  return true;
+}
+
+std::vector<char> DistanceMatrix::Serialize() const
+{
+  size_t const pairs = PairCount(Size());
+  std::vector<char> buffer;
+  buffer.reserve(kHeaderSize + Size() * sizeof(uint64_t) + pairs * static_cast<size_t>(m_precision));
+
+  buffer.insert(buffer.end(), kMagic, kMagic + sizeof(kMagic));
+  Append(buffer, kFormatVersion);
+  Append(buffer, static_cast<uint8_t>(m_precision));
+  Append(buffer, uint16_t(0));
+  Append(buffer, static_cast<uint64_t>(Size()));
+
+  for (ScAddr const & addr : m_addrs)
+    Append(buffer, static_cast<uint64_t>(addr.Hash()));
+
+  char const * values = m_precision == MatrixPrecision::Float ? reinterpret_cast<char const *>(m_floats.data())
+                                                              : reinterpret_cast<char const *>(m_doubles.data());
+  buffer.insert(buffer.end(), values, values + pairs * static_cast<size_t>(m_precision));
+  return buffer;
+}
+
+bool DistanceMatrix::Deserialize(char const * data, size_t size, DistanceMatrix & matrix)
+{
+  if (size < kHeaderSize || std::memcmp(data, kMagic, sizeof(kMagic)) != 0)
+    return false;
+
+  uint8_t const version = static_cast<uint8_t>(data[4]);
+  uint8_t const precisionByte = static_cast<uint8_t>(data[5]);
+  if (version != kFormatVersion
+      || (precisionByte != static_cast<uint8_t>(MatrixPrecision::Float)
+          && precisionByte != static_cast<uint8_t>(MatrixPrecision::Double)))
+    return false;
+
+  uint64_t count = 0;
+  std::memcpy(&count, data + 8, sizeof(count));
+
+  MatrixPrecision const precision = static_cast<MatrixPrecision>(precisionByte);
+  size_t const pairs = PairCount(count);
+  if (size != kHeaderSize + count * sizeof(uint64_t) + pairs * static_cast<size_t>(precision))
+    return false;
+
+  DistanceMatrix result;
+  result.m_precision = precision;
+  result.m_addrs.reserve(count);
+  char const * cursor = data + kHeaderSize;
+  for (uint64_t i = 0; i < count; ++i, cursor += sizeof(uint64_t))
+  {
+    uint64_t hash = 0;
+    std::memcpy(&hash, cursor, sizeof(hash));
+    result.m_addrs.emplace_back(static_cast<ScAddr::HashType>(hash));
+  }
+
+  if (precision == MatrixPrecision::Float)
+  {
+    result.m_floats.resize(pairs);
+    std::memcpy(result.m_floats.data(), cursor, pairs * sizeof(float));
+  }
+  else
+  {
+    result.m_doubles.resize(pairs);
+    std::memcpy(result.m_doubles.data(), cursor, pairs * sizeof(double));
+  }
+
+  result.BuildIndex();
+  matrix = std::move(result);
+  return true;
+}
+
+ScAddr DistanceMatrix::GenerateLink(ScMemoryContext & context) const
+{
+  std::vector<char> buffer = Serialize();
+  ScAddr const link = context.GenerateLink(ScType::NodeLink);
+  ScStreamPtr const stream =
+      std::make_shared<ScStream>(buffer.data(), buffer.size(), SC_STREAM_FLAG_READ | SC_STREAM_FLAG_SEEK);
+  context.SetLinkContent(link, stream, false);
+  return link;
+}
+
+bool DistanceMatrix::LoadFromLink(ScMemoryContext & context, ScAddr const & link, DistanceMatrix & matrix)
+{
+  ScStreamPtr const stream = context.GetLinkContent(link);
+  if (stream == nullptr || !stream->IsValid())
+    return false;
+
+  std::vector<char> buffer(stream->Size());
+  size_t readBytes = 0;
+  if (buffer.empty() || !stream->Read(buffer.data(), buffer.size(), readBytes) || readBytes != buffer.size())
+    return false;
+
+  return Deserialize(buffer.data(), buffer.size(), matrix);
+}
+
+bool DistanceMatrix::LoadFromAction(ScMemoryContext & context, ScAddr const & action, DistanceMatrix & matrix)
+{
+  ScIterator5Ptr const it5 = context.CreateIterator5(
+      action, ScType::ConstCommonArc, ScType::NodeLink, ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_distance_matrix);
+  if (!it5->Next())
+    return false;
+
+  return LoadFromLink(context, it5->Get(2), matrix);
+}
+
+size_t DistanceMatrix::Materialize(
+    ScMemoryContext & context,
+    std::vector<std::pair<size_t, size_t>> const & pairs) const
+{
+  DistanceWriter writer(context);
+  for (auto const & [i, j] : pairs)
+  {
+    if (i == j || i >= Size() || j >= Size())
+      continue;
+    writer.Add(m_addrs[i], m_addrs[j], At(i, j));
+  }
+  writer.Flush();
+  return writer.GetWrittenCount();
+}
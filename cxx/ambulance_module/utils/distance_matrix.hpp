@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <sc-memory/sc_memory.hpp>
+
+namespace ambulance_module
+{
+
+enum class MatrixPrecision : uint8_t
+{
+  Double = 8,
+  Float = 4
+};
+
+//упакованная верхнетреугольная матрица расстояний (без диагонали): 4 или 8 байт на пару
+class DistanceMatrix
+{
+public:
+  DistanceMatrix() = default;
+  DistanceMatrix(std::vector<ScAddr> const & addrs, MatrixPrecision precision);
+
+  size_t Size() const
+  {
+    return m_addrs.size();
+  }
+
+  MatrixPrecision GetPrecision() const
+  {
+    return m_precision;
+  }
+
+  std::vector<ScAddr> const & GetAddrs() const
+  {
+    return m_addrs;
+  }
+
+  static size_t PairCount(size_t size)
+  {
+    return size < 2 ? 0 : size * (size - 1) / 2;
+  }
+
+  //позиция пары i < j в упакованном массиве
+  static size_t PairIndex(size_t i, size_t j, size_t size)
+  {
+    return i * size - i * (i + 1) / 2 + (j - i - 1);
+  }
+
+  void Set(size_t i, size_t j, double distance);
+  double At(size_t i, size_t j) const;
+
+  //индекс деревни или Size()
+  size_t IndexOf(ScAddr const & addr) const;
+  bool Find(ScAddr const & first, ScAddr const & second, double & distance) const;
+
+  //бинарное представление для содержимого ссылки
+  std::vector<char> Serialize() const;
+  static bool Deserialize(char const * data, size_t size, DistanceMatrix & matrix);
+
+  //матрица в одной ссылке
+  ScAddr GenerateLink(ScMemoryContext & context) const;
+  static bool LoadFromLink(ScMemoryContext & context, ScAddr const & link, DistanceMatrix & matrix);
+  //матрица из результата действия: action => nrel_distance_matrix: link
+  static bool LoadFromAction(ScMemoryContext & context, ScAddr const & action, DistanceMatrix & matrix);
+
+  //дуги nrel_distance только для запрошенных пар индексов; возвращает число записанных
+  size_t Materialize(ScMemoryContext & context, std::vector<std::pair<size_t, size_t>> const & pairs) const;
+
+private:
+  void BuildIndex();
+
+  std::vector<ScAddr> m_addrs;
+  MatrixPrecision m_precision = MatrixPrecision::Double;
+  std::vector<double> m_doubles;
+  std::vector<float> m_floats;
+  std::unordered_map<ScAddr::HashType, size_t> m_index;
+};
+
+}  // namespace ambulance_module
@@ -0,0 +1,47 @@
+#include "distance_writer.hpp"
+
+#include "keynodes/ambulance_keynodes.hpp"
+#include "utils/numeric_link.hpp"
+
+using namespace ambulance_module;
+
+DistanceWriter::DistanceWriter(ScMemoryContext & context, size_t batchSize)
+  : m_context(context)
+  , m_batchSize(batchSize == 0 ? kDefaultBatchSize : batchSize)
+{
+  m_pending.reserve(m_batchSize);
+}
+
+DistanceWriter::~DistanceWriter()
+{
+  Flush();
+}
+
+void DistanceWriter::Add(ScAddr const & first, ScAddr const & second, double distance)
+{
+  m_pending.push_back({first, second, distance});
+  if (m_pending.size() >= m_batchSize)
+    Flush();
+}
+
+void DistanceWriter::Flush()
+{
+  if (m_pending.empty())
+    return;
+
+  //события по всем элементам пакета уходят одним блоком в EndEventsPending
+  m_context.BeginEventsPending();
+  for (PendingDistance const & item : m_pending)
+  {
+    ScAddr const link = NumericLink::Generate(m_context, item.distance);//место хранения дистанции
+
+    //ребро графа: дорога, деревня, деревня
+    ScAddr const commonArc = m_context.GenerateConnector(ScType::ConstCommonArc, item.first, item.second);
+    m_context.GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_distance, commonArc);
+    m_context.GenerateConnector(ScType::ConstPermPosArc, link, commonArc);
+  }
+  m_context.EndEventsPending();
+
+  m_written += m_pending.size();
+  m_pending.clear();
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <sc-memory/sc_memory.hpp>
+
+namespace ambulance_module
+{
+
+//пакетная запись дуг nrel_distance: пары копятся в буфере и пишутся одним блоком
+//с отложенной рассылкой событий, чтобы не платить за события на каждый элемент
+class DistanceWriter
+{
+public:
+  static constexpr size_t kDefaultBatchSize = 8192;
+  //ссылка, дуга пары, дуга nrel_distance и дуга от ссылки
+  static constexpr size_t kElementsPerPair = 4;
+
+  explicit DistanceWriter(ScMemoryContext & context, size_t batchSize = kDefaultBatchSize);
+  ~DistanceWriter();
+
+  DistanceWriter(DistanceWriter const &) = delete;
+  DistanceWriter & operator=(DistanceWriter const &) = delete;
+
+  void Add(ScAddr const & first, ScAddr const & second, double distance);
+  void Flush();
+
+  size_t GetWrittenCount() const
+  {
+    return m_written;
+  }
+
+private:
+  struct PendingDistance
+  {
+    ScAddr first;
+    ScAddr second;
+    double distance;
+  };
+
+  ScMemoryContext & m_context;
+  size_t m_batchSize;
+  std::vector<PendingDistance> m_pending;
+  size_t m_written = 0;
+};
+
+}  // namespace ambulance_module
@@ -0,0 +1,97 @@
+#include "geometric_median.hpp"
+
+#include <cmath>
+
+#include "utils/distance_kernel.hpp"
+
+using namespace ambulance_module;
+
+MedianPoint GeometricMedian::Solve(
+    double const * xs,
+    double const * ys,
+    double const * weights,
+    size_t count,
+    size_t maxIterations,
+    double tolerance)
+{
+  MedianPoint result;
+  if (count == 0)
+    return result;
+
+  //старт из взвешенного центра масс
+  double totalWeight = 0.0;
+  for (size_t i = 0; i < count; ++i)
+  {
+    result.x += xs[i] * weights[i];
+    result.y += ys[i] * weights[i];
+    totalWeight += weights[i];
+  }
+  if (totalWeight <= 0.0)
+  {
+    result.x = xs[0];
+    result.y = ys[0];
+    return result;
+  }
+  result.x /= totalWeight;
+  result.y /= totalWeight;
+
+  //масштаб для критерия остановки
+  double const scale = std::fabs(result.x) + std::fabs(result.y) + 1.0;
+
+  for (; result.iterations < maxIterations; ++result.iterations)
+  {
+    double sumX = 0.0;
+    double sumY = 0.0;
+    double sumInverse = 0.0;
+    //вес деревни, в которую попала текущая точка, и тяга остальных деревень
+    double coincidentWeight = 0.0;
+    double pullX = 0.0;
+    double pullY = 0.0;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+      double const dx = xs[i] - result.x;
+      double const dy = ys[i] - result.y;
+      double const distance = std::sqrt(dx * dx + dy * dy);
+      if (distance < 1e-12 * scale)
+      {
+        coincidentWeight += weights[i];
+        continue;
+      }
+      double const inverse = weights[i] / distance;
+      sumX += xs[i] * inverse;
+      sumY += ys[i] * inverse;
+      sumInverse += inverse;
+      pullX += dx * inverse;
+      pullY += dy * inverse;
+    }
+
+    if (sumInverse == 0.0)
+      break;
+
+    double nextX = sumX / sumInverse;
+    double nextY = sumY / sumInverse;
+    if (coincidentWeight > 0.0)
+    {
+      //точка в деревне оптимальна, если остальные тянут слабее ее веса
+      double const pull = std::hypot(pullX, pullY);
+      if (pull <= coincidentWeight)
+        break;
+      double const share = coincidentWeight / pull;
+      nextX = (1.0 - share) * nextX + share * result.x;
+      nextY = (1.0 - share) * nextY + share * result.y;
+    }
+
+    double const step = std::hypot(nextX - result.x, nextY - result.y);
+    result.x = nextX;
+    result.y = nextY;
+    if (step <= tolerance * scale)
+    {
+      ++result.iterations;
+      break;
+    }
+  }
+
+  result.cost = DistanceKernel::RowWeightedSum(xs, ys, weights, count, result.x, result.y);
+  return result;
+}
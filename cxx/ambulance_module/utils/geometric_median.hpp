@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+
+namespace ambulance_module
+{
+
+struct MedianPoint
+{
+  double x = 0.0;
+  double y = 0.0;
+  //сумма весов на расстояния от точки до всех деревень
+  double cost = 0.0;
+  size_t iterations = 0;
+};
+
+//непрерывная взвешенная 1-медиана (точка Ферма-Вебера) методом Вейсфельда
+//с поправкой Варди-Чжана для итераций, попавших в саму деревню
+class GeometricMedian
+{
+public:
+  static constexpr size_t kDefaultIterations = 200;
+  static constexpr double kDefaultTolerance = 1e-9;
+
+  static MedianPoint Solve(
+      double const * xs,
+      double const * ys,
+      double const * weights,
+      size_t count,
+      size_t maxIterations = kDefaultIterations,
+      double tolerance = kDefaultTolerance);
+};
+
+}  // namespace ambulance_module
@@ -0,0 +1,157 @@
+#include "grid_coreset.hpp"
+
+#include <cmath>
+
+#include "keynodes/ambulance_keynodes.hpp"
+#include "utils/numeric_link.hpp"
+
+using namespace ambulance_module;
+
+namespace
+{
+
+//ячеек на блок при подсчете границ
+size_t const kBoundGrain = 16;
+
+}  // namespace
+
+bool GridCoreset::ReadAccuracy(ActionParameters const & parameters, double & accuracy, std::string & error)
+{
+  accuracy = parameters.HasMode(AmbulanceKeynodes::mode_approximate) ? kDefaultAccuracy : 0.0;
+  double requested = 0.0;
+  if (!parameters.ReadNumber(AmbulanceKeynodes::rrel_accuracy, requested))
+    return true;
+
+  if (!(requested > 0.0 && requested <= 1.0))
+  {
+    error = "rrel_accuracy must be in (0, 1].";
+    return false;
+  }
+  accuracy = requested;
+  return true;
+}
+
+size_t GridCoreset::WriteErrorBound(
+    ScMemoryContext & context,
+    ScAddr const & action,
+    double errorBound,
+    ScStructure & structure)
+{
+  ScAddr const link = NumericLink::Generate(context, errorBound);
+  ScAddr const arc = context.GenerateConnector(ScType::ConstCommonArc, action, link);
+  ScAddr const relArc = context.GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_error_bound, arc);
+  structure << link << arc << relArc << AmbulanceKeynodes::nrel_error_bound;
+  return 3;
+}
+
+GridCoreset::GridCoreset(double const * xs, double const * ys, double const * weights, size_t count, double accuracy)
+  : m_accuracy(accuracy)
+  , m_cellOf(count)
+{
+  m_offsets.push_back(0);
+  if (count == 0)
+    return;
+
+  //ячейка в несколько раз мельче допуска, иначе границы слишком грубы для отсечения
+  size_t const cellsPerAxis = std::min(
+      kMaxCellsPerAxis,
+      std::max<size_t>(1, static_cast<size_t>(std::ceil(2.0 / std::max(accuracy, 1.0 / kMaxCellsPerAxis)))));
+  auto const [minXIt, maxXIt] = std::minmax_element(xs, xs + count);
+  auto const [minYIt, maxYIt] = std::minmax_element(ys, ys + count);
+  double const originX = *minXIt;
+  double const originY = *minYIt;
+  double const cellSize = std::max({*maxXIt - originX, *maxYIt - originY, 1e-12}) / cellsPerAxis;
+
+  //номер ячейки сетки -> номер непустой ячейки
+  std::vector<size_t> gridCell(count);
+  std::vector<size_t> compact(cellsPerAxis * cellsPerAxis, CandidateResult::kNone);
+  for (size_t i = 0; i < count; ++i)
+  {
+    size_t const cx = std::min(cellsPerAxis - 1, static_cast<size_t>((xs[i] - originX) / cellSize));
+    size_t const cy = std::min(cellsPerAxis - 1, static_cast<size_t>((ys[i] - originY) / cellSize));
+    gridCell[i] = cy * cellsPerAxis + cx;
+    compact[gridCell[i]] = 0;
+  }
+  size_t cells = 0;
+  for (size_t & cell : compact)
+  {
+    if (cell != CandidateResult::kNone)
+      cell = cells++;
+  }
+
+  double const inf = std::numeric_limits<double>::infinity();
+  std::vector<double> sumX(cells, 0.0), sumY(cells, 0.0), plainX(cells, 0.0), plainY(cells, 0.0);
+  std::vector<size_t> sizes(cells, 0);
+  m_weight.assign(cells, 0.0);
+  m_minX.assign(cells, inf);
+  m_minY.assign(cells, inf);
+  m_maxX.assign(cells, -inf);
+  m_maxY.assign(cells, -inf);
+  for (size_t i = 0; i < count; ++i)
+  {
+    size_t const cell = compact[gridCell[i]];
+    m_cellOf[i] = cell;
+    double const weight = weights != nullptr ? weights[i] : 1.0;
+    m_weight[cell] += weight;
+    sumX[cell] += weight * xs[i];
+    sumY[cell] += weight * ys[i];
+    plainX[cell] += xs[i];
+    plainY[cell] += ys[i];
+    ++sizes[cell];
+    m_minX[cell] = std::min(m_minX[cell], xs[i]);
+    m_minY[cell] = std::min(m_minY[cell], ys[i]);
+    m_maxX[cell] = std::max(m_maxX[cell], xs[i]);
+    m_maxY[cell] = std::max(m_maxY[cell], ys[i]);
+  }
+
+  //центр масс, а для ячейки без жителей - простое среднее; оба - выпуклые комбинации деревень
+  m_repX.resize(cells);
+  m_repY.resize(cells);
+  m_offsets.resize(cells + 1);
+  for (size_t cell = 0; cell < cells; ++cell)
+  {
+    bool const weighted = m_weight[cell] > 0.0;
+    m_repX[cell] = weighted ? sumX[cell] / m_weight[cell] : plainX[cell] / sizes[cell];
+    m_repY[cell] = weighted ? sumY[cell] / m_weight[cell] : plainY[cell] / sizes[cell];
+    m_offsets[cell + 1] = m_offsets[cell] + sizes[cell];
+  }
+
+  m_members.resize(count);
+  m_radius.assign(cells, 0.0);
+  std::vector<size_t> next(m_offsets.begin(), m_offsets.end() - 1);
+  for (size_t i = 0; i < count; ++i)
+  {
+    size_t const cell = m_cellOf[i];
+    m_members[next[cell]++] = i;
+    m_radius[cell] = std::max(m_radius[cell], std::hypot(xs[i] - m_repX[cell], ys[i] - m_repY[cell]));
+  }
+}
+
+std::vector<double> GridCoreset::LowerBounds(ThreadPool & pool, PlacementObjective objective) const
+{
+  size_t const cells = GetCellCount();
+  std::vector<double> bounds(cells, 0.0);
+  pool.ParallelFor(
+      cells,
+      kBoundGrain,
+      [&](size_t begin, size_t end, size_t)
+      {
+        for (size_t cell = begin; cell < end; ++cell)
+        {
+          double bound = 0.0;
+          for (size_t other = 0; other < cells; ++other)
+          {
+            //ближайшая к представителю other точка рамки ячейки
+            double const dx = std::max({m_minX[cell] - m_repX[other], 0.0, m_repX[other] - m_maxX[cell]});
+            double const dy = std::max({m_minY[cell] - m_repY[other], 0.0, m_repY[other] - m_maxY[cell]});
+            double const distance = std::sqrt(dx * dx + dy * dy);
+            if (objective == PlacementObjective::Median)
+              bound += m_weight[other] * distance;
+            else
+              bound = std::max(bound, distance);
+          }
+          bounds[cell] = bound;
+        }
+      });
+  return bounds;
+}
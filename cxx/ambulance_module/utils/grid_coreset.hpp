@@ -0,0 +1,167 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <sc-memory/sc_memory.hpp>
+
+#include "utils/action_parameters.hpp"
+#include "utils/candidate_search.hpp"
+#include "utils/station_placement.hpp"
+#include "utils/thread_pool.hpp"
+
+namespace ambulance_module
+{
+
+//приближенный поиск: найденный счет превышает лучший не более чем на errorBound
+struct CoresetSearchResult
+{
+  //от лучшего к худшему, счета точные
+  std::vector<CandidateResult> ranking;
+  double errorBound = 0.0;
+  //точно оцененных кандидатов
+  size_t evaluated = 0;
+};
+
+//деревни, собранные в ячейки сетки; представитель ячейки - центр масс ее деревень (с весом, если задан).
+//Счет - выпуклая функция точки, поэтому для любой деревни v и ячейки K
+//  сумма по K вес * |v - деревня| >= W_K * |v - представитель K|,  max по K |v - деревня| >= |v - представитель K|;
+//отсюда нижняя граница счета для всех деревень ячейки за O(число ячеек) без погрешности представления
+class GridCoreset
+{
+public:
+  //допустимая относительная погрешность без rrel_accuracy
+  static constexpr double kDefaultAccuracy = 0.05;
+  //ячеек на ось не больше - границы считаются за O(ячеек^2)
+  static constexpr size_t kMaxCellsPerAxis = 128;
+
+  //mode_approximate или action -> rrel_accuracy: [доля в (0, 1]]; без них accuracy = 0 (точный поиск)
+  static bool ReadAccuracy(ActionParameters const & parameters, double & accuracy, std::string & error);
+
+  //action => nrel_error_bound: [граница]; возвращает число записанных элементов
+  static size_t WriteErrorBound(
+      ScMemoryContext & context,
+      ScAddr const & action,
+      double errorBound,
+      ScStructure & structure);
+
+  //weights == nullptr - все деревни с единичным весом; чем меньше accuracy, тем мельче ячейки
+  GridCoreset(double const * xs, double const * ys, double const * weights, size_t count, double accuracy);
+
+  size_t GetCellCount() const
+  {
+    return m_repX.size();
+  }
+
+  size_t GetCellOf(size_t village) const
+  {
+    return m_cellOf[village];
+  }
+
+  //деревни ячейки: [begin, end) в GetMembers()
+  std::vector<size_t> const & GetMembers() const
+  {
+    return m_members;
+  }
+
+  size_t GetMembersBegin(size_t cell) const
+  {
+    return m_offsets[cell];
+  }
+
+  size_t GetMembersEnd(size_t cell) const
+  {
+    return m_offsets[cell + 1];
+  }
+
+  double GetRepresentativeX(size_t cell) const
+  {
+    return m_repX[cell];
+  }
+
+  double GetRepresentativeY(size_t cell) const
+  {
+    return m_repY[cell];
+  }
+
+  //наибольшее расстояние от деревни ячейки до представителя
+  double GetRadius(size_t cell) const
+  {
+    return m_radius[cell];
+  }
+
+  //нижняя граница счета каждой деревни ячейки: Median - сумма расстояний с весом, Center - наибольшее расстояние
+  std::vector<double> LowerBounds(ThreadPool & pool, PlacementObjective objective) const;
+
+  //count лучших деревень: ячейки уточняются от меньшей границы к большей, пока граница,
+  //увеличенная в (1 + accuracy) раз, не хуже count-го найденного; evaluate(i) - точный счет деревни
+  template <typename TEvaluate>
+  CoresetSearchResult Search(
+      ThreadPool & pool,
+      std::vector<ScAddr> const & addrs,
+      PlacementObjective objective,
+      TEvaluate const & evaluate,
+      size_t count) const
+  {
+    std::vector<double> const bounds = LowerBounds(pool, objective);
+    std::vector<size_t> order(addrs.size());
+    for (size_t i = 0; i < order.size(); ++i)
+      order[i] = i;
+    std::sort(
+        order.begin(),
+        order.end(),
+        [&](size_t a, size_t b)
+        {
+          double const left = bounds[m_cellOf[a]];
+          double const right = bounds[m_cellOf[b]];
+          return left < right || (left == right && a < b);
+        });
+
+    //наименьшая граница среди пропущенных - ниже нее лучший счет быть не может
+    std::atomic<double> skippedBound{std::numeric_limits<double>::infinity()};
+    CoresetSearchResult result;
+    result.ranking = CandidateSearch::RankOrdered(
+        pool,
+        addrs,
+        order,
+        [&](size_t i, double threshold)
+        {
+          double const bound = bounds[m_cellOf[i]];
+          if (!(bound * (1.0 + m_accuracy) > threshold))
+            return false;
+          double current = skippedBound.load(std::memory_order_relaxed);
+          while (bound < current && !skippedBound.compare_exchange_weak(current, bound, std::memory_order_relaxed))
+          {
+          }
+          return true;
+        },
+        evaluate,
+        0.0,
+        count,
+        result.evaluated);
+
+    if (!result.ranking.empty())
+      result.errorBound = std::max(0.0, result.ranking.front().score - skippedBound.load());
+    return result;
+  }
+
+private:
+  double m_accuracy;
+  std::vector<size_t> m_cellOf;
+  std::vector<size_t> m_offsets;
+  std::vector<size_t> m_members;
+  std::vector<double> m_repX;
+  std::vector<double> m_repY;
+  std::vector<double> m_weight;
+  std::vector<double> m_radius;
+  std::vector<double> m_minX;
+  std::vector<double> m_minY;
+  std::vector<double> m_maxX;
+  std::vector<double> m_maxY;
+};
+
+}  // namespace ambulance_module
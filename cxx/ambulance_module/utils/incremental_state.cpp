@@ -0,0 +1,328 @@
+#include "incremental_state.hpp"
+
+#include <numeric>
+#include <unordered_set>
+#include <utility>
+
+#include "keynodes/ambulance_keynodes.hpp"
+#include "utils/distance_kernel.hpp"
+#include "utils/numeric_link.hpp"
+#include "utils/result_links.hpp"
+#include "utils/thread_pool.hpp"
+
+using namespace ambulance_module;
+
+namespace
+{
+
+//строки, которые поток пересчитывает за раз
+size_t const kRowGrain = 16;
+
+std::mutex activeMutex;
+std::shared_ptr<IncrementalState> activeState;
+
+//меньшее значение среди подходящих, при равенстве - меньший хэш адреса (как в CandidateSearch)
+template <typename TValue, typename TEligible>
+size_t ArgMin(std::vector<ScAddr> const & addrs, TValue const & value, TEligible const & eligible)
+{
+  size_t best = addrs.size();
+  for (size_t i = 0; i < addrs.size(); ++i)
+  {
+    if (!eligible(i))
+      continue;
+    if (best == addrs.size() || value(i) < value(best)
+        || (value(i) == value(best) && addrs[i].Hash() < addrs[best].Hash()))
+      best = i;
+  }
+  return best;
+}
+
+}  // namespace
+
+IncrementalView IncrementalState::Sync(VillageSnapshot const & villages)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  size_t const size = villages.Size();
+
+  std::unordered_map<ScAddr::HashType, size_t> previous;
+  previous.reserve(m_addrs.size());
+  for (size_t i = 0; i < m_addrs.size(); ++i)
+    previous.emplace(m_addrs[i].Hash(), i);
+
+  //dirty - новые и изменившиеся деревни (индексы снимка), gone - их прежние записи и удаленные деревни
+  std::vector<Village> next(size);
+  std::vector<size_t> dirty;
+  std::vector<Village> gone;
+  std::unordered_set<ScAddr::HashType> goneHashes;
+  std::vector<char> kept(m_addrs.size(), 0);
+  for (size_t j = 0; j < size; ++j)
+  {
+    auto const it = previous.find(villages.addrs[j].Hash());
+    if (it != previous.end())
+    {
+      Village const & old = m_villages[it->second];
+      kept[it->second] = 1;
+      if (old.x == villages.x[j] && old.y == villages.y[j] && old.population == villages.population[j])
+      {
+        next[j] = old;
+        continue;
+      }
+      gone.push_back(old);
+      goneHashes.insert(villages.addrs[j].Hash());
+    }
+
+    next[j].x = villages.x[j];
+    next[j].y = villages.y[j];
+    next[j].population = villages.population[j];
+    dirty.push_back(j);
+  }
+
+  size_t removed = 0;
+  for (size_t i = 0; i < m_addrs.size(); ++i)
+  {
+    if (kept[i])
+      continue;
+    gone.push_back(m_villages[i]);
+    goneHashes.insert(m_addrs[i].Hash());
+    ++removed;
+  }
+
+  size_t const changes = dirty.size() + removed;
+  IncrementalView view;
+  view.fullRecompute = m_addrs.empty() || changes * kFullRecomputeDivisor > size
+                       || m_incrementalUpdates + changes > kMaxIncrementalUpdates;
+
+  m_addrs = villages.addrs;
+  m_villages = std::move(next);
+
+  std::vector<size_t> rows;
+  if (view.fullRecompute)
+  {
+    rows.resize(size);
+    std::iota(rows.begin(), rows.end(), 0);
+    m_incrementalUpdates = 0;
+  }
+  else if (changes > 0)
+  {
+    m_incrementalUpdates += changes;
+    rows = dirty;
+
+    std::vector<char> isDirty(size, 0);
+    for (size_t const j : dirty)
+      isDirty[j] = 1;
+
+    //остальные деревни: вычитаем вклад прежних записей и добавляем вклад новых, O(n) на изменение
+    std::vector<double> row(size);
+    for (Village const & old : gone)
+    {
+      DistanceKernel::Row(villages.x.data(), villages.y.data(), size, old.x, old.y, row.data());
+      for (size_t i = 0; i < size; ++i)
+      {
+        if (!isDirty[i])
+          m_villages[i].score -= old.population * row[i];
+      }
+    }
+    for (size_t const j : dirty)
+    {
+      DistanceKernel::Row(villages.x.data(), villages.y.data(), size, villages.x[j], villages.y[j], row.data());
+      for (size_t i = 0; i < size; ++i)
+      {
+        if (isDirty[i])
+          continue;
+        Village & village = m_villages[i];
+        village.score += villages.population[j] * row[i];
+        if (row[i] > village.eccentricity)
+        {
+          village.eccentricity = row[i];
+          village.farthest = villages.addrs[j].Hash();
+        }
+      }
+    }
+
+    //максимум нельзя "вычесть": если ушла самая дальняя деревня, строка считается заново
+    for (size_t i = 0; i < size; ++i)
+    {
+      if (!isDirty[i] && goneHashes.count(m_villages[i].farthest) > 0)
+        rows.push_back(i);
+    }
+  }
+
+  Recompute(villages, rows);
+  view.recomputedRows = rows.size();
+
+  view.eccentricities.resize(size);
+  view.scores.resize(size);
+  for (size_t i = 0; i < size; ++i)
+  {
+    view.eccentricities[i] = m_villages[i].eccentricity;
+    view.scores[i] = m_villages[i].score;
+  }
+  view.center = ArgMin(
+      m_addrs,
+      [&](size_t i) { return view.eccentricities[i]; },
+      [](size_t) { return true; });
+  //станция ставится только в деревню с населением, как у отдельного поиска
+  view.optimal = ArgMin(
+      m_addrs,
+      [&](size_t i) { return view.scores[i]; },
+      [&](size_t i) { return villages.HasPopulation(i); });
+  return view;
+}
+
+void IncrementalState::Recompute(VillageSnapshot const & villages, std::vector<size_t> const & rows)
+{
+  std::shared_ptr<ThreadPool> const pool = ThreadPool::GetShared();
+  std::vector<std::vector<double>> buffers(pool->GetThreadCount());
+  size_t const size = villages.Size();
+
+  pool->ParallelFor(
+      rows.size(),
+      kRowGrain,
+      [&](size_t begin, size_t end, size_t worker)
+      {
+        std::vector<double> & row = buffers[worker];
+        row.resize(size);
+        for (size_t k = begin; k < end; ++k)
+        {
+          size_t const i = rows[k];
+          DistanceKernel::Row(villages.x.data(), villages.y.data(), size, villages.x[i], villages.y[i], row.data());
+
+          Village & village = m_villages[i];
+          village.eccentricity = 0.0;
+          village.farthest = villages.addrs[i].Hash();
+          village.score = 0.0;
+          for (size_t j = 0; j < size; ++j)
+          {
+            village.score += villages.population[j] * row[j];
+            if (row[j] > village.eccentricity)
+            {
+              village.eccentricity = row[j];
+              village.farthest = villages.addrs[j].Hash();
+            }
+          }
+        }
+      });
+}
+
+bool IncrementalState::WriteEccentricity(
+    ScMemoryContext & context,
+    ScAddr const & village,
+    double value,
+    ScAddr & link,
+    ScAddr & arc)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  auto const it = m_eccentricityLinks.find(village.Hash());
+  if (it != m_eccentricityLinks.end() && context.IsElement(it->second.link) && context.IsElement(it->second.arc))
+  {
+    link = it->second.link;
+    arc = it->second.arc;
+    if (it->second.value == value)
+      return false;
+
+    NumericLink::Write(context, link, value);
+    it->second.value = value;
+    return true;
+  }
+
+  //ссылки еще нет в состоянии - ищем оставшуюся от прошлых запусков
+  ResultLinks::UpsertProperty(context, village, AmbulanceKeynodes::nrel_eccentricity, value, link, arc);
+  m_eccentricityLinks[village.Hash()] = {link, arc, value};
+  return true;
+}
+
+void IncrementalState::ForgetWrittenResults()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_eccentricityLinks.clear();
+  m_distanceCoordinates.clear();
+  m_distancesWritten = false;
+}
+
+std::vector<size_t> IncrementalState::FindMovedSinceDistances(VillageSnapshot const & villages, bool & firstWrite)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  firstWrite = !m_distancesWritten;
+  std::vector<size_t> moved;
+  for (size_t i = 0; i < villages.Size(); ++i)
+  {
+    std::pair<double, double> const coordinates{villages.x[i], villages.y[i]};
+    auto const it = m_distanceCoordinates.find(villages.addrs[i].Hash());
+    if (firstWrite || it == m_distanceCoordinates.end() || it->second != coordinates)
+      moved.push_back(i);
+  }
+  return moved;
+}
+
+void IncrementalState::CommitDistances(VillageSnapshot const & villages)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (size_t i = 0; i < villages.Size(); ++i)
+    m_distanceCoordinates[villages.addrs[i].Hash()] = {villages.x[i], villages.y[i]};
+  m_distancesWritten = true;
+}
+
+void IncrementalState::InvalidateDistances()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_distanceCoordinates.clear();
+  m_distancesWritten = false;
+}
+
+void IncrementalState::Export(VillageSnapshot const & villages, ModuleSnapshotContent & content)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  content.eccentricities.clear();
+  content.farthest.clear();
+  content.scores.clear();
+  content.incrementalUpdates = 0;
+  if (m_addrs.empty() || m_addrs != villages.addrs)
+    return;
+
+  for (Village const & village : m_villages)
+  {
+    content.eccentricities.push_back(village.eccentricity);
+    content.farthest.push_back(village.farthest);
+    content.scores.push_back(village.score);
+  }
+  content.incrementalUpdates = m_incrementalUpdates;
+}
+
+bool IncrementalState::Restore(ModuleSnapshotContent const & content)
+{
+  VillageSnapshot const & villages = content.villages;
+  size_t const size = villages.Size();
+  if (size == 0 || content.scores.size() != size || content.eccentricities.size() != size
+      || content.farthest.size() != size)
+    return false;
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_addrs = villages.addrs;
+  m_villages.resize(size);
+  for (size_t i = 0; i < size; ++i)
+  {
+    Village & village = m_villages[i];
+    village.x = villages.x[i];
+    village.y = villages.y[i];
+    village.population = villages.population[i];
+    village.eccentricity = content.eccentricities[i];
+    village.farthest = content.farthest[i];
+    village.score = content.scores[i];
+  }
+  m_incrementalUpdates = content.incrementalUpdates;
+  return true;
+}
+
+std::shared_ptr<IncrementalState> IncrementalState::GetActive()
+{
+  std::lock_guard<std::mutex> lock(activeMutex);
+  return activeState;
+}
+
+void IncrementalState::SetActive(std::shared_ptr<IncrementalState> const & state)
+{
+  std::lock_guard<std::mutex> lock(activeMutex);
+  activeState = state;
+}
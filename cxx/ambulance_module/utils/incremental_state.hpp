@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <sc-memory/sc_memory.hpp>
+
+#include "utils/module_snapshot.hpp"
+#include "utils/village_loader.hpp"
+
+namespace ambulance_module
+{
+
+//эксцентриситеты и взвешенные суммы, выровненные по индексам снимка
+struct IncrementalView
+{
+  std::vector<double> eccentricities;
+  std::vector<double> scores;
+  //индексы лучших деревень (меньшее значение, при равенстве - меньший хэш) или Size() для пустого снимка;
+  //optimal выбирается только среди деревень с населением
+  size_t center = 0;
+  size_t optimal = 0;
+  //сколько строк расстояний пересчитано при последней синхронизации
+  size_t recomputedRows = 0;
+  bool fullRecompute = false;
+};
+
+//состояние между действиями: при изменении k деревень эксцентриситеты и суммы
+//обновляются за O(k*n) вместо O(n^2), а ссылки переписываются только изменившиеся
+class IncrementalState
+{
+public:
+  //доля изменившихся деревень, после которой дешевле полный пересчет
+  static constexpr size_t kFullRecomputeDivisor = 16;
+  //после стольких приращений суммы пересчитываются заново, чтобы не копилась ошибка округления
+  static constexpr size_t kMaxIncrementalUpdates = 1024;
+
+  //приводит состояние к полному снимку (деревни без населения входят с нулевым весом)
+  //и возвращает копию значений для него
+  IncrementalView Sync(VillageSnapshot const & villages);
+
+  //ссылка nrel_eccentricity деревни: создается, если ее нет, и переписывается, только если значение изменилось;
+  //возвращает true, если ссылка создана или переписана
+  bool WriteEccentricity(ScMemoryContext & context, ScAddr const & village, double value, ScAddr & link, ScAddr & arc);
+
+  //записанные ссылки больше не существуют (после очистки результатов)
+  void ForgetWrittenResults();
+
+  //деревни, чьи координаты изменились с прошлой записи дуг nrel_distance (все - при первой записи);
+  //firstWrite - дуг этого состояния еще нет
+  std::vector<size_t> FindMovedSinceDistances(VillageSnapshot const & villages, bool & firstWrite);
+  //дуги всех пар villages записаны; до этого прерванная запись повторяется целиком
+  void CommitDistances(VillageSnapshot const & villages);
+  //дуги nrel_distance переписаны в обход состояния (по дорогам, с одинарной точностью):
+  //следующая точная запись снова идет по всем парам
+  void InvalidateDistances();
+
+  //выгружает значения в content, если состояние приведено к villages (иначе оставляет пустыми)
+  void Export(VillageSnapshot const & villages, ModuleSnapshotContent & content);
+  //значения сохраненного снимка; ссылки результатов не восстанавливаются, их в базе знаний нет
+  bool Restore(ModuleSnapshotContent const & content);
+
+  //состояние модуля (nullptr - без инкрементального режима)
+  static std::shared_ptr<IncrementalState> GetActive();
+  static void SetActive(std::shared_ptr<IncrementalState> const & state);
+
+private:
+  struct Village
+  {
+    double x = 0.0;
+    double y = 0.0;
+    double population = 0.0;
+    double eccentricity = 0.0;
+    //хэш самой дальней деревни: если она изменится, эксцентриситет надо пересчитать
+    ScAddr::HashType farthest = 0;
+    double score = 0.0;
+  };
+
+  struct EccentricityLink
+  {
+    ScAddr link;
+    ScAddr arc;
+    double value = 0.0;
+  };
+
+  void Recompute(VillageSnapshot const & villages, std::vector<size_t> const & rows);
+
+  std::mutex m_mutex;
+  std::vector<ScAddr> m_addrs;
+  std::vector<Village> m_villages;
+  size_t m_incrementalUpdates = 0;
+
+  std::unordered_map<ScAddr::HashType, EccentricityLink> m_eccentricityLinks;
+
+  bool m_distancesWritten = false;
+  std::unordered_map<ScAddr::HashType, std::pair<double, double>> m_distanceCoordinates;
+};
+
+}  // namespace ambulance_module
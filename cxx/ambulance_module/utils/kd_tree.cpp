@@ -0,0 +1,193 @@
+#include "kd_tree.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+using namespace ambulance_module;
+
+KdTree::KdTree(double const * xs, double const * ys, size_t count)
+  : m_xs(xs)
+  , m_ys(ys)
+  , m_order(count)
+{
+  std::iota(m_order.begin(), m_order.end(), 0);
+  Build(0, count, 0);
+}
+
+void KdTree::Build(size_t begin, size_t end, size_t depth)
+{
+  if (end - begin <= 1)
+    return;
+
+  size_t const middle = begin + (end - begin) / 2;
+  double const * axis = depth % 2 == 0 ? m_xs : m_ys;
+  std::nth_element(
+      m_order.begin() + begin,
+      m_order.begin() + middle,
+      m_order.begin() + end,
+      [axis](size_t a, size_t b)
+      {
+        return axis[a] < axis[b];
+      });
+
+  Build(begin, middle, depth + 1);
+  Build(middle + 1, end, depth + 1);
+}
+
+size_t KdTree::Nearest(double px, double py, double * distance) const
+{
+  size_t best = kNone;
+  double bestSquared = std::numeric_limits<double>::infinity();
+  SearchNearest(0, m_order.size(), 0, px, py, best, bestSquared);
+  if (distance != nullptr)
+    *distance = std::sqrt(bestSquared);
+  return best;
+}
+
+void KdTree::SearchNearest(
+    size_t begin,
+    size_t end,
+    size_t depth,
+    double px,
+    double py,
+    size_t & best,
+    double & bestSquared) const
+{
+  if (begin >= end)
+    return;
+
+  size_t const middle = begin + (end - begin) / 2;
+  size_t const point = m_order[middle];
+  double const dx = m_xs[point] - px;
+  double const dy = m_ys[point] - py;
+  double const squared = dx * dx + dy * dy;
+  //при равенстве - меньший индекс, чтобы результат не зависел от формы дерева
+  if (squared < bestSquared || (squared == bestSquared && point < best))
+  {
+    bestSquared = squared;
+    best = point;
+  }
+
+  double const delta = depth % 2 == 0 ? px - m_xs[point] : py - m_ys[point];
+  bool const leftFirst = delta < 0;
+  if (leftFirst)
+    SearchNearest(begin, middle, depth + 1, px, py, best, bestSquared);
+  else
+    SearchNearest(middle + 1, end, depth + 1, px, py, best, bestSquared);
+
+  //вторая половина нужна, только если плоскость разреза ближе лучшего найденного
+  if (delta * delta <= bestSquared)
+  {
+    if (leftFirst)
+      SearchNearest(middle + 1, end, depth + 1, px, py, best, bestSquared);
+    else
+      SearchNearest(begin, middle, depth + 1, px, py, best, bestSquared);
+  }
+}
+
+std::vector<size_t> KdTree::KNearest(double px, double py, size_t k) const
+{
+  std::vector<std::pair<double, size_t>> heap;
+  if (k > 0)
+  {
+    heap.reserve(k + 1);
+    SearchKNearest(0, m_order.size(), 0, px, py, k, heap);
+  }
+
+  std::sort_heap(heap.begin(), heap.end());
+  std::vector<size_t> result;
+  result.reserve(heap.size());
+  for (auto const & [squared, point] : heap)
+    result.push_back(point);
+  return result;
+}
+
+void KdTree::SearchKNearest(
+    size_t begin,
+    size_t end,
+    size_t depth,
+    double px,
+    double py,
+    size_t k,
+    std::vector<std::pair<double, size_t>> & heap) const
+{
+  if (begin >= end)
+    return;
+
+  size_t const middle = begin + (end - begin) / 2;
+  size_t const point = m_order[middle];
+  double const dx = m_xs[point] - px;
+  double const dy = m_ys[point] - py;
+  std::pair<double, size_t> const candidate{dx * dx + dy * dy, point};
+  //пары сравниваются по расстоянию, затем по индексу - как в Nearest
+  if (heap.size() < k)
+  {
+    heap.push_back(candidate);
+    std::push_heap(heap.begin(), heap.end());
+  }
+  else if (candidate < heap.front())
+  {
+    std::pop_heap(heap.begin(), heap.end());
+    heap.back() = candidate;
+    std::push_heap(heap.begin(), heap.end());
+  }
+
+  double const delta = depth % 2 == 0 ? px - m_xs[point] : py - m_ys[point];
+  bool const leftFirst = delta < 0;
+  if (leftFirst)
+    SearchKNearest(begin, middle, depth + 1, px, py, k, heap);
+  else
+    SearchKNearest(middle + 1, end, depth + 1, px, py, k, heap);
+
+  if (heap.size() < k || delta * delta <= heap.front().first)
+  {
+    if (leftFirst)
+      SearchKNearest(middle + 1, end, depth + 1, px, py, k, heap);
+    else
+      SearchKNearest(begin, middle, depth + 1, px, py, k, heap);
+  }
+}
+
+std::vector<size_t> KdTree::Radius(double px, double py, double radius) const
+{
+  std::vector<std::pair<double, size_t>> found;
+  if (radius >= 0.0)
+    SearchRadius(0, m_order.size(), 0, px, py, radius * radius, found);
+
+  std::sort(found.begin(), found.end());
+  std::vector<size_t> result;
+  result.reserve(found.size());
+  for (auto const & [squared, point] : found)
+    result.push_back(point);
+  return result;
+}
+
+void KdTree::SearchRadius(
+    size_t begin,
+    size_t end,
+    size_t depth,
+    double px,
+    double py,
+    double radiusSquared,
+    std::vector<std::pair<double, size_t>> & found) const
+{
+  if (begin >= end)
+    return;
+
+  size_t const middle = begin + (end - begin) / 2;
+  size_t const point = m_order[middle];
+  double const dx = m_xs[point] - px;
+  double const dy = m_ys[point] - py;
+  double const squared = dx * dx + dy * dy;
+  if (squared <= radiusSquared)
+    found.emplace_back(squared, point);
+
+  //половина по эту сторону разреза нужна, если круг заходит в нее
+  double const delta = depth % 2 == 0 ? px - m_xs[point] : py - m_ys[point];
+  if (delta <= 0 || delta * delta <= radiusSquared)
+    SearchRadius(begin, middle, depth + 1, px, py, radiusSquared, found);
+  if (delta >= 0 || delta * delta <= radiusSquared)
+    SearchRadius(middle + 1, end, depth + 1, px, py, radiusSquared, found);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace ambulance_module
+{
+
+//двумерное k-d дерево над массивами x/y снимка; хранит только индексы точек
+class KdTree
+{
+public:
+  static constexpr size_t kNone = static_cast<size_t>(-1);
+
+  KdTree() = default;
+  //массивы должны жить дольше дерева
+  KdTree(double const * xs, double const * ys, size_t count);
+
+  size_t Size() const
+  {
+    return m_order.size();
+  }
+
+  //ближайшая точка к (px, py) или kNone для пустого дерева
+  size_t Nearest(double px, double py, double * distance = nullptr) const;
+
+  //k ближайших точек по возрастанию расстояния (при равенстве - меньший индекс)
+  std::vector<size_t> KNearest(double px, double py, size_t k) const;
+
+  //все точки не дальше radius по возрастанию расстояния
+  std::vector<size_t> Radius(double px, double py, double radius) const;
+
+private:
+  //узел - середина диапазона m_order[begin, end), ось чередуется по глубине
+  void Build(size_t begin, size_t end, size_t depth);
+  void SearchNearest(
+      size_t begin,
+      size_t end,
+      size_t depth,
+      double px,
+      double py,
+      size_t & best,
+      double & bestSquared) const;
+  //heap - max-куча (квадрат расстояния, индекс) не больше k элементов
+  void SearchKNearest(
+      size_t begin,
+      size_t end,
+      size_t depth,
+      double px,
+      double py,
+      size_t k,
+      std::vector<std::pair<double, size_t>> & heap) const;
+  void SearchRadius(
+      size_t begin,
+      size_t end,
+      size_t depth,
+      double px,
+      double py,
+      double radiusSquared,
+      std::vector<std::pair<double, size_t>> & found) const;
+
+  double const * m_xs = nullptr;
+  double const * m_ys = nullptr;
+  std::vector<size_t> m_order;
+};
+
+}  // namespace ambulance_module
@@ -0,0 +1,64 @@
+#include "mapped_file.hpp"
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace ambulance_module;
+
+MappedFile::~MappedFile()
+{
+  Close();
+}
+
+bool MappedFile::Open(std::string const & path, std::string & error)
+{
+  Close();
+
+  int const descriptor = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (descriptor < 0)
+  {
+    error = "cannot open " + path + ": " + std::strerror(errno);
+    return false;
+  }
+
+  struct stat info;
+  if (fstat(descriptor, &info) != 0)
+  {
+    error = "cannot stat " + path + ": " + std::strerror(errno);
+    close(descriptor);
+    return false;
+  }
+
+  size_t const size = static_cast<size_t>(info.st_size);
+  if (size > 0)
+  {
+    void * const data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    if (data == MAP_FAILED)
+    {
+      error = "cannot map " + path + ": " + std::strerror(errno);
+      close(descriptor);
+      return false;
+    }
+    //файл читается один раз от начала до конца
+    madvise(data, size, MADV_SEQUENTIAL);
+    m_data = static_cast<char const *>(data);
+    m_size = size;
+  }
+
+  //отображение остается действительным и после закрытия дескриптора
+  close(descriptor);
+  return true;
+}
+
+void MappedFile::Close()
+{
+  if (m_data != nullptr)
+    munmap(const_cast<char *>(m_data), m_size);
+  m_data = nullptr;
+  m_size = 0;
+}
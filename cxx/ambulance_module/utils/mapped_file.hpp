@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace ambulance_module
+{
+
+//файл, отображенный в память только для чтения; отображение снимается в деструкторе
+class MappedFile
+{
+public:
+  MappedFile() = default;
+  ~MappedFile();
+
+  MappedFile(MappedFile const &) = delete;
+  MappedFile & operator=(MappedFile const &) = delete;
+
+  //false и текст ошибки, если файл не открыть; пустой файл открывается без отображения
+  bool Open(std::string const & path, std::string & error);
+  void Close();
+
+  char const * GetData() const
+  {
+    return m_data;
+  }
+
+  size_t GetSize() const
+  {
+    return m_size;
+  }
+
+private:
+  char const * m_data = nullptr;
+  size_t m_size = 0;
+};
+
+}  // namespace ambulance_module
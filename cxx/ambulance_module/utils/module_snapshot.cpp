@@ -0,0 +1,322 @@
+#include "module_snapshot.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include "utils/mapped_file.hpp"
+
+using namespace ambulance_module;
+
+namespace
+{
+
+struct Header
+{
+  char magic[8];
+  uint64_t generation;
+  uint64_t villageSetHash;
+  uint64_t recordCount;
+  uint64_t villageCount;
+  uint64_t unweightedCount;
+  uint64_t scoreCount;
+  uint64_t incrementalUpdates;
+  //0 - метрики по дорогам нет, иначе число вершин графа (деревни и концы дорог вне снимка) + 1
+  uint64_t roadOffsetCount;
+  uint64_t roadEdgeCount;
+  uint64_t roadMatrixBytes;
+};
+
+struct RawRecord
+{
+  uint64_t village;
+  uint64_t links[3];
+  double x;
+  double y;
+  double population;
+  uint64_t status;
+};
+
+static_assert(sizeof(Header) == 88, "snapshot header must not have padding");
+static_assert(sizeof(RawRecord) == 64, "snapshot record must not have padding");
+
+size_t Padded(size_t size)
+{
+  return (size + 7) / 8 * 8;
+}
+
+class Writer
+{
+public:
+  template <typename T>
+  void Append(T const * values, size_t count)
+  {
+    char const * bytes = reinterpret_cast<char const *>(values);
+    m_data.append(bytes, count * sizeof(T));
+    m_data.append(Padded(m_data.size()) - m_data.size(), '\0');
+  }
+
+  std::string const & GetData() const
+  {
+    return m_data;
+  }
+
+private:
+  std::string m_data;
+};
+
+//курсор по отображению; размеры секций проверены заранее по заголовку
+class Reader
+{
+public:
+  explicit Reader(char const * data)
+    : m_data(data)
+  {
+  }
+
+  template <typename T>
+  void Read(T * values, size_t count)
+  {
+    //отображение выровнено по странице, но копия не зависит от выравнивания
+    if (count > 0)
+      std::memcpy(values, m_data + m_offset, count * sizeof(T));
+    m_offset = Padded(m_offset + count * sizeof(T));
+  }
+
+  char const * Current() const
+  {
+    return m_data + m_offset;
+  }
+
+  void Skip(size_t size)
+  {
+    m_offset = Padded(m_offset + size);
+  }
+
+private:
+  char const * m_data;
+  size_t m_offset = 0;
+};
+
+std::vector<uint64_t> ToWide(std::vector<size_t> const & values)
+{
+  return {values.begin(), values.end()};
+}
+
+}  // namespace
+
+uint64_t ModuleSnapshot::MixVillage(uint64_t hash, ScAddr const & village)
+{
+  //splitmix64: у xor сырых хэшей соседние адреса гасили бы друг друга
+  uint64_t value = village.Hash() + 0x9e3779b97f4a7c15ull;
+  value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+  value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+  return hash ^ (value ^ (value >> 31));
+}
+
+bool ModuleSnapshot::Save(std::string const & path, ModuleSnapshotContent const & content, std::string & error)
+{
+  size_t const villageCount = content.villages.Size();
+  bool const hasScores = content.scores.size() == villageCount && content.eccentricities.size() == villageCount
+                         && content.farthest.size() == villageCount;
+  std::vector<char> const matrix = content.hasRoads ? content.roadMatrix.Serialize() : std::vector<char>();
+
+  Header header;
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.generation = content.generation;
+  header.villageSetHash = content.villageSetHash;
+  header.recordCount = content.records.size();
+  header.villageCount = villageCount;
+  header.unweightedCount = content.villages.unweighted.size();
+  header.scoreCount = hasScores ? villageCount : 0;
+  header.incrementalUpdates = content.incrementalUpdates;
+  header.roadOffsetCount = content.hasRoads ? content.roadGraph.offsets.size() : 0;
+  header.roadEdgeCount = content.hasRoads ? content.roadGraph.targets.size() : 0;
+  header.roadMatrixBytes = matrix.size();
+
+  Writer writer;
+  writer.Append(&header, 1);
+
+  std::vector<RawRecord> records(content.records.size());
+  for (size_t i = 0; i < records.size(); ++i)
+  {
+    SnapshotRecord const & record = content.records[i];
+    records[i] = {
+        record.village.Hash(),
+        {record.links[0].Hash(), record.links[1].Hash(), record.links[2].Hash()},
+        record.x,
+        record.y,
+        record.population,
+        static_cast<uint64_t>(record.status)};
+  }
+  writer.Append(records.data(), records.size());
+
+  std::vector<uint64_t> addrs(villageCount);
+  for (size_t i = 0; i < villageCount; ++i)
+    addrs[i] = content.villages.addrs[i].Hash();
+  writer.Append(addrs.data(), villageCount);
+  writer.Append(content.villages.x.data(), villageCount);
+  writer.Append(content.villages.y.data(), villageCount);
+  writer.Append(content.villages.population.data(), villageCount);
+  std::vector<uint64_t> const unweighted = ToWide(content.villages.unweighted);
+  writer.Append(unweighted.data(), unweighted.size());
+
+  if (hasScores)
+  {
+    writer.Append(content.eccentricities.data(), villageCount);
+    writer.Append(content.farthest.data(), villageCount);
+    writer.Append(content.scores.data(), villageCount);
+  }
+
+  if (content.hasRoads)
+  {
+    std::vector<uint64_t> const offsets = ToWide(content.roadGraph.offsets);
+    std::vector<uint64_t> const targets = ToWide(content.roadGraph.targets);
+    writer.Append(offsets.data(), offsets.size());
+    writer.Append(targets.data(), targets.size());
+    writer.Append(content.roadGraph.times.data(), content.roadGraph.times.size());
+    writer.Append(matrix.data(), matrix.size());
+  }
+
+  std::string const temporary = path + ".tmp";
+  {
+    std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+    file.write(writer.GetData().data(), static_cast<std::streamsize>(writer.GetData().size()));
+    if (!file)
+    {
+      error = "cannot write " + temporary;
+      return false;
+    }
+  }
+  if (std::rename(temporary.c_str(), path.c_str()) != 0)
+  {
+    error = "cannot replace " + path;
+    return false;
+  }
+  return true;
+}
+
+bool ModuleSnapshot::Load(std::string const & path, ModuleSnapshotContent & content, std::string & error)
+{
+  MappedFile file;
+  if (!file.Open(path, error))
+    return false;
+
+  Header header;
+  if (file.GetSize() < sizeof(Header) || std::memcmp(file.GetData(), kMagic, sizeof(kMagic)) != 0)
+  {
+    error = path + " is not a module snapshot";
+    return false;
+  }
+  std::memcpy(&header, file.GetData(), sizeof(header));
+
+  //размер файла однозначно следует из заголовка - так отсекаются обрезанные и чужие файлы
+  uint64_t const villages = header.villageCount;
+  bool const countsValid = (header.scoreCount == 0 || header.scoreCount == villages)
+                           && (header.roadOffsetCount == 0 || header.roadOffsetCount > villages)
+                           && header.roadOffsetCount <= file.GetSize() / 8
+                           && header.recordCount <= file.GetSize() / sizeof(RawRecord)
+                           && villages <= file.GetSize() / 8 && header.unweightedCount <= villages
+                           && header.roadEdgeCount <= file.GetSize() / 8
+                           && header.roadMatrixBytes <= file.GetSize();
+  uint64_t const expected = countsValid ? sizeof(Header) + header.recordCount * sizeof(RawRecord) + villages * 32
+                                              + header.unweightedCount * 8 + header.scoreCount * 24 + header.roadOffsetCount * 8
+                                              + header.roadEdgeCount * 16 + Padded(header.roadMatrixBytes)
+                                        : 0;
+  if (!countsValid || expected != file.GetSize())
+  {
+    error = path + " is truncated or corrupted";
+    return false;
+  }
+
+  content = ModuleSnapshotContent();
+  content.generation = header.generation;
+  content.villageSetHash = header.villageSetHash;
+  content.incrementalUpdates = header.incrementalUpdates;
+
+  Reader reader(file.GetData());
+  reader.Skip(sizeof(Header));
+
+  std::vector<RawRecord> records(header.recordCount);
+  reader.Read(records.data(), records.size());
+  content.records.resize(records.size());
+  for (size_t i = 0; i < records.size(); ++i)
+  {
+    RawRecord const & raw = records[i];
+    SnapshotRecord & record = content.records[i];
+    if (raw.status > static_cast<uint64_t>(VillageRecordStatus::Unweighted))
+    {
+      error = path + " has an unknown record status";
+      return false;
+    }
+    record.village = ScAddr(raw.village);
+    record.status = static_cast<VillageRecordStatus>(raw.status);
+    record.x = raw.x;
+    record.y = raw.y;
+    record.population = raw.population;
+    for (size_t k = 0; k < 3; ++k)
+      record.links[k] = ScAddr(raw.links[k]);
+  }
+
+  std::vector<uint64_t> addrs(villages);
+  reader.Read(addrs.data(), addrs.size());
+  content.villages.addrs.reserve(villages);
+  for (uint64_t const hash : addrs)
+    content.villages.addrs.push_back(ScAddr(hash));
+  content.villages.x.resize(villages);
+  content.villages.y.resize(villages);
+  content.villages.population.resize(villages);
+  reader.Read(content.villages.x.data(), villages);
+  reader.Read(content.villages.y.data(), villages);
+  reader.Read(content.villages.population.data(), villages);
+  std::vector<uint64_t> unweighted(header.unweightedCount);
+  reader.Read(unweighted.data(), unweighted.size());
+  for (size_t k = 0; k < unweighted.size(); ++k)
+  {
+    //HasPopulation ищет индекс двоичным поиском
+    if (unweighted[k] >= villages || (k > 0 && unweighted[k - 1] >= unweighted[k]))
+    {
+      error = path + " has malformed village data";
+      return false;
+    }
+  }
+  content.villages.unweighted.assign(unweighted.begin(), unweighted.end());
+
+  if (header.scoreCount > 0)
+  {
+    content.eccentricities.resize(villages);
+    content.farthest.resize(villages);
+    content.scores.resize(villages);
+    reader.Read(content.eccentricities.data(), villages);
+    reader.Read(content.farthest.data(), villages);
+    reader.Read(content.scores.data(), villages);
+  }
+
+  if (header.roadOffsetCount > 0)
+  {
+    std::vector<uint64_t> offsets(header.roadOffsetCount);
+    std::vector<uint64_t> targets(header.roadEdgeCount);
+    reader.Read(offsets.data(), offsets.size());
+    reader.Read(targets.data(), targets.size());
+    content.roadGraph.offsets.assign(offsets.begin(), offsets.end());
+    content.roadGraph.targets.assign(targets.begin(), targets.end());
+    content.roadGraph.times.resize(header.roadEdgeCount);
+    reader.Read(content.roadGraph.times.data(), header.roadEdgeCount);
+
+    //индексы графа потом используются без проверок
+    bool graphValid = offsets.front() == 0 && offsets.back() == header.roadEdgeCount;
+    for (size_t i = 1; graphValid && i < offsets.size(); ++i)
+      graphValid = offsets[i - 1] <= offsets[i];
+    for (size_t i = 0; graphValid && i < targets.size(); ++i)
+      graphValid = targets[i] + 1 < offsets.size();
+    if (!graphValid
+        || !DistanceMatrix::Deserialize(reader.Current(), header.roadMatrixBytes, content.roadMatrix)
+        || content.roadMatrix.GetAddrs() != content.villages.addrs)
+    {
+      error = path + " has malformed road data";
+      return false;
+    }
+    content.hasRoads = true;
+  }
+  return true;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <sc-memory/sc_memory.hpp>
+
+#include "utils/distance_matrix.hpp"
+#include "utils/road_network.hpp"
+#include "utils/village_loader.hpp"
+
+namespace ambulance_module
+{
+
+//запись кэша деревень: и неполные деревни, чтобы после загрузки следить за их ссылками
+struct SnapshotRecord
+{
+  ScAddr village;
+  VillageRecordStatus status = VillageRecordStatus::Incomplete;
+  double x = 0.0;
+  double y = 0.0;
+  double population = 0.0;
+  //ссылки свойств (пустые адреса - свойства нет)
+  ScAddr links[3];
+};
+
+//состояние модуля между запусками
+struct ModuleSnapshotContent
+{
+  //счетчик изменений деревень в базе знаний на момент сохранения и хэш множества деревень
+  uint64_t generation = 0;
+  uint64_t villageSetHash = 0;
+
+  std::vector<SnapshotRecord> records;
+  //опубликованный снимок кэша (массивы по деревням)
+  VillageSnapshot villages;
+
+  //IncrementalState по индексам villages; пусто - не сохранялось
+  std::vector<double> eccentricities;
+  std::vector<uint64_t> farthest;
+  std::vector<double> scores;
+  uint64_t incrementalUpdates = 0;
+
+  //метрика по дорогам над villages.addrs
+  bool hasRoads = false;
+  RoadGraph roadGraph;
+  DistanceMatrix roadMatrix;
+};
+
+//снимок на диске: заголовок и секции по 8 байт, файл читается через отображение в память;
+//пишется во временный файл и переименовывается, поэтому читатель не увидит половину снимка
+class ModuleSnapshot
+{
+public:
+  static constexpr char kMagic[8] = {'A', 'M', 'B', 'S', 'N', 'P', '0', '2'};
+
+  static bool Save(std::string const & path, ModuleSnapshotContent const & content, std::string & error);
+
+  //false и текст ошибки, если файла нет или он не в формате
+  static bool Load(std::string const & path, ModuleSnapshotContent & content, std::string & error);
+
+  //хэш множества деревень, не зависящий от порядка обхода
+  static uint64_t MixVillage(uint64_t hash, ScAddr const & village);
+};
+
+}  // namespace ambulance_module
@@ -0,0 +1,126 @@
+#include "numeric_link.hpp"
+
+#include <charconv>
+#include <cstring>
+
+#include <sc-memory/sc_stream.hpp>
+
+using namespace ambulance_module;
+
+namespace
+{
+
+//нулевой первый байт не встречается в текстовых числах, поэтому формат не путается с .scs
+char const kMagic[] = {'\0', 'N'};
+char const kTypeDouble = 'd';
+char const kTypeInteger = 'i';
+
+//длинные строки числом быть не могут, читаем в буфер на стеке
+size_t const kMaxTextSize = 64;
+
+bool IsSpace(char c)
+{
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+bool WriteEncoded(ScMemoryContext & context, ScAddr const & link, char * buffer, size_t size)
+{
+  ScStreamPtr const stream = std::make_shared<ScStream>(buffer, size, SC_STREAM_FLAG_READ | SC_STREAM_FLAG_SEEK);
+  //бинарные значения не индексируем для поиска по содержимому
+  return context.SetLinkContent(link, stream, false);
+}
+
+}  // namespace
+
+size_t NumericLink::Encode(double value, char * buffer)
+{
+  std::memcpy(buffer, kMagic, sizeof(kMagic));
+  buffer[2] = kTypeDouble;
+  std::memcpy(buffer + 3, &value, sizeof(value));
+  return kEncodedSize;
+}
+
+size_t NumericLink::EncodeInteger(int64_t value, char * buffer)
+{
+  std::memcpy(buffer, kMagic, sizeof(kMagic));
+  buffer[2] = kTypeInteger;
+  std::memcpy(buffer + 3, &value, sizeof(value));
+  return kEncodedSize;
+}
+
+bool NumericLink::Decode(char const * data, size_t size, double & value)
+{
+  if (size == kEncodedSize && std::memcmp(data, kMagic, sizeof(kMagic)) == 0)
+  {
+    if (data[2] == kTypeDouble)
+    {
+      std::memcpy(&value, data + 3, sizeof(value));
+      return true;
+    }
+    if (data[2] == kTypeInteger)
+    {
+      int64_t integer = 0;
+      std::memcpy(&integer, data + 3, sizeof(integer));
+      value = static_cast<double>(integer);
+      return true;
+    }
+    return false;
+  }
+
+  //текст, записанный вручную: "7.5", " 2500 "
+  char const * begin = data;
+  char const * end = data + size;
+  while (begin != end && IsSpace(*begin))
+    ++begin;
+  while (end != begin && IsSpace(*(end - 1)))
+    --end;
+  if (begin != end && *begin == '+')
+    ++begin;
+  if (begin == end)
+    return false;
+
+  double parsed = 0.0;
+  auto const [ptr, error] = std::from_chars(begin, end, parsed);
+  if (error != std::errc() || ptr != end)
+    return false;
+
+  value = parsed;
+  return true;
+}
+
+ScAddr NumericLink::Generate(ScMemoryContext & context, double value)
+{
+  ScAddr const link = context.GenerateLink(ScType::NodeLink);
+  Write(context, link, value);
+  return link;
+}
+
+bool NumericLink::Write(ScMemoryContext & context, ScAddr const & link, double value)
+{
+  char buffer[kEncodedSize];
+  return WriteEncoded(context, link, buffer, Encode(value, buffer));
+}
+
+bool NumericLink::WriteInteger(ScMemoryContext & context, ScAddr const & link, int64_t value)
+{
+  char buffer[kEncodedSize];
+  return WriteEncoded(context, link, buffer, EncodeInteger(value, buffer));
+}
+
+bool NumericLink::Read(ScMemoryContext & context, ScAddr const & link, double & value)
+{
+  ScStreamPtr const stream = context.GetLinkContent(link);
+  if (stream == nullptr || !stream->IsValid())
+    return false;
+
+  size_t const size = stream->Size();
+  if (size == 0 || size > kMaxTextSize)
+    return false;
+
+  char buffer[kMaxTextSize];
+  size_t readBytes = 0;
+  if (!stream->Read(buffer, size, readBytes) || readBytes != size)
+    return false;
+
+  return Decode(buffer, size, value);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <sc-memory/sc_memory.hpp>
+
+namespace ambulance_module
+{
+
+//числовое содержимое ссылок: бинарное (double/int64) с запасным разбором текста из .scs
+class NumericLink
+{
+public:
+  //размер бинарной записи: 3 байта заголовка + 8 байт значения
+  static constexpr size_t kEncodedSize = 11;
+
+  static ScAddr Generate(ScMemoryContext & context, double value);
+
+  static bool Write(ScMemoryContext & context, ScAddr const & link, double value);
+  static bool WriteInteger(ScMemoryContext & context, ScAddr const & link, int64_t value);
+
+  //false если ссылки нет, она пустая или там не число; исключений не бросает
+  static bool Read(ScMemoryContext & context, ScAddr const & link, double & value);
+
+  static size_t Encode(double value, char * buffer);
+  static size_t EncodeInteger(int64_t value, char * buffer);
+  static bool Decode(char const * data, size_t size, double & value);
+};
+
+}  // namespace ambulance_module
@@ -0,0 +1,265 @@
+#include "problem_zones.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+
+#include "keynodes/ambulance_keynodes.hpp"
+#include "utils/coverage.hpp"
+#include "utils/distance_kernel.hpp"
+#include "utils/grid_coreset.hpp"
+#include "utils/numeric_link.hpp"
+#include "utils/thread_pool.hpp"
+
+using namespace ambulance_module;
+
+namespace
+{
+
+//критерий плохой зоны без радиуса выезда - во столько раз дальше среднего
+double const kAverageFactor = 1.5;
+
+}  // namespace
+
+size_t ProblemZones::FindOptimalStation(ScMemoryContext & context, VillageSnapshot const & villages)
+{
+  std::unordered_map<ScAddr::HashType, size_t> index;
+  index.reserve(villages.Size());
+  for (size_t i = 0; i < villages.Size(); ++i)
+    index.emplace(villages.addrs[i].Hash(), i);
+
+  //дуга действие => деревня помечена nrel_optimal_location
+  ScIterator3Ptr const itOpt =
+      context.CreateIterator3(AmbulanceKeynodes::nrel_optimal_location, ScType::ConstPermPosArc, ScType::Unknown);
+  while (itOpt->Next())
+  {
+    auto const [source, target] = context.GetConnectorIncidentElements(itOpt->Get(2));
+    (void)source;
+    auto const it = index.find(target.Hash());
+    if (it != index.end())
+      return it->second;
+  }
+  return kNone;
+}
+
+std::vector<size_t> ProblemZones::CollectStations(
+    ScMemoryContext & context,
+    VillageSnapshot const & villages,
+    size_t first)
+{
+  std::unordered_map<ScAddr::HashType, size_t> index;
+  index.reserve(villages.Size());
+  for (size_t i = 0; i < villages.Size(); ++i)
+    index.emplace(villages.addrs[i].Hash(), i);
+
+  std::vector<size_t> stations;
+  std::vector<char> isStation(villages.Size(), 0);
+  if (first < villages.Size())
+  {
+    isStation[first] = 1;
+    stations.push_back(first);
+  }
+
+  auto const Add = [&](ScAddr const & village)
+  {
+    auto const it = index.find(village.Hash());
+    if (it == index.end() || isStation[it->second])
+      return;
+    isStation[it->second] = 1;
+    stations.push_back(it->second);
+  };
+
+  //только явно отмеченные станции: ответы прошлых действий могли считаться по другой области,
+  //метрике или набору деревень
+  ScIterator3Ptr const itStations = context.CreateIterator3(
+      AmbulanceKeynodes::concept_ambulance_station, ScType::ConstPermPosArc, ScType::ConstNode);
+  while (itStations->Next())
+    Add(itStations->Get(2));
+
+  return stations;
+}
+
+bool ProblemZones::ReadSettings(
+    ActionParameters const & parameters,
+    ProblemZoneSettings & settings,
+    std::string & error)
+{
+  settings = ProblemZoneSettings();
+  settings.coverage = parameters.HasMode(AmbulanceKeynodes::mode_coverage);
+  if (!settings.coverage)
+    return true;
+
+  if (!parameters.ReadNumber(AmbulanceKeynodes::rrel_radius, settings.radius) || !(settings.radius >= 0.0))
+  {
+    error = "Coverage mode needs a non-negative rrel_radius.";
+    return false;
+  }
+  //вместимость станции в жителях, без параметра - без ограничения
+  settings.capacity =
+      parameters.GetNumber(AmbulanceKeynodes::rrel_station_capacity, std::numeric_limits<double>::infinity());
+  if (!(settings.capacity >= 0.0))
+  {
+    error = "Station capacity must be non-negative.";
+    return false;
+  }
+  return true;
+}
+
+ProblemZoneResult ProblemZones::Find(
+    ProblemZoneSettings const & settings,
+    VillageSnapshot const & villages,
+    std::vector<size_t> const & stations,
+    RoadMetric const * roads)
+{
+  ProblemZoneResult result;
+  if (!settings.coverage)
+  {
+    //порог считается от одной станции при любой метрике; остальные станции - дело режима покрытия
+    if (settings.accuracy > 0.0 && roads == nullptr)
+      FindAboveAverageApproximate(villages, stations.front(), settings.accuracy, result);
+    else
+      FindAboveAverage(villages, stations.front(), roads, result);
+    return result;
+  }
+
+  CoverageResult const coverage =
+      roads != nullptr
+          ? Coverage::Assign(*roads, villages, stations, settings.radius, settings.capacity)
+          : Coverage::Assign(*ThreadPool::GetShared(), villages, stations, settings.radius, settings.capacity);
+
+  //деревни вне радиуса (или не поместившиеся ни в одну станцию)
+  result.coverage = true;
+  result.threshold = settings.radius;
+  result.uncoveredPopulation = coverage.uncoveredPopulation;
+  result.zones.reserve(coverage.uncoveredCount);
+  for (size_t i = 0; i < villages.Size(); ++i)
+  {
+    if (coverage.station[i] == CoverageResult::kNone)
+      result.zones.push_back(i);
+  }
+  return result;
+}
+
+void ProblemZones::FindAboveAverage(
+    VillageSnapshot const & villages,
+    size_t station,
+    RoadMetric const * roads,
+    ProblemZoneResult & result)
+{
+  size_t const size = villages.Size();
+  std::vector<double> distances(size);
+  if (roads != nullptr)
+    roads->Row(station, distances.data());
+  else
+    DistanceKernel::Row(
+        villages.x.data(),
+        villages.y.data(),
+        size,
+        villages.x[station],
+        villages.y[station],
+        distances.data(),
+        KernelPrecision::Exact);
+
+  double totalDist = 0.0;
+  size_t reachable = 0;
+  for (size_t i = 0; i < size; ++i)
+  {
+    //недостижимые по дорогам деревни в среднее не входят, но всегда проблемные
+    if (i == station || std::isinf(distances[i]))
+      continue;
+    totalDist += distances[i];
+    ++reachable;
+  }
+
+  double const avgDist = reachable > 0 ? totalDist / reachable : 0.0;
+  result.threshold = avgDist * kAverageFactor;
+  for (size_t i = 0; i < size; ++i)
+  {
+    if (i != station && distances[i] > result.threshold)
+      result.zones.push_back(i);
+  }
+}
+
+void ProblemZones::FindAboveAverageApproximate(
+    VillageSnapshot const & villages,
+    size_t station,
+    double accuracy,
+    ProblemZoneResult & result)
+{
+  size_t const size = villages.Size();
+  auto const ToStation = [&](double px, double py)
+  {
+    return std::hypot(px - villages.x[station], py - villages.y[station]);
+  };
+
+  //расстояние до станции 1-липшицево: у деревни оно отличается от представителя
+  //не больше, чем на расстояние до него; поэтому ошибка среднего - среднее смещение
+  GridCoreset const coreset(villages.x.data(), villages.y.data(), nullptr, size, accuracy);
+  std::vector<size_t> const & members = coreset.GetMembers();
+  std::vector<double> repDistance(coreset.GetCellCount());
+  double totalDist = 0.0;
+  double displacement = 0.0;
+  size_t counted = 0;
+  for (size_t cell = 0; cell < coreset.GetCellCount(); ++cell)
+  {
+    double const repX = coreset.GetRepresentativeX(cell);
+    double const repY = coreset.GetRepresentativeY(cell);
+    repDistance[cell] = ToStation(repX, repY);
+    for (size_t k = coreset.GetMembersBegin(cell); k < coreset.GetMembersEnd(cell); ++k)
+    {
+      size_t const i = members[k];
+      if (i == station)
+        continue;
+      totalDist += repDistance[cell];
+      displacement += std::hypot(villages.x[i] - repX, villages.y[i] - repY);
+      ++counted;
+    }
+  }
+  result.approximate = true;
+  result.threshold = counted > 0 ? totalDist / counted * kAverageFactor : 0.0;
+  result.errorBound = counted > 0 ? displacement / counted * kAverageFactor : 0.0;
+
+  //ячейка целиком выше или ниже порога решается по представителю, точно проверяются только пограничные
+  for (size_t cell = 0; cell < coreset.GetCellCount(); ++cell)
+  {
+    double const radius = coreset.GetRadius(cell);
+    if (repDistance[cell] + radius <= result.threshold)
+      continue;
+    bool const allAbove = repDistance[cell] - radius > result.threshold;
+    for (size_t k = coreset.GetMembersBegin(cell); k < coreset.GetMembersEnd(cell); ++k)
+    {
+      size_t const i = members[k];
+      if (i != station && (allAbove || ToStation(villages.x[i], villages.y[i]) > result.threshold))
+        result.zones.push_back(i);
+    }
+  }
+  std::sort(result.zones.begin(), result.zones.end());
+}
+
+void ProblemZones::Write(
+    ScMemoryContext & context,
+    ScAddr const & action,
+    VillageSnapshot const & villages,
+    ProblemZoneResult const & result,
+    ScStructure & structure)
+{
+  for (size_t const i : result.zones)
+  {
+    //общая дуга между действием и деревней, помеченная как проблемная зона
+    ScAddr const resArc = context.GenerateConnector(ScType::ConstCommonArc, action, villages.addrs[i]);
+    context.GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_problem_zone, resArc);
+    structure << villages.addrs[i] << resArc;
+  }
+  structure << AmbulanceKeynodes::nrel_problem_zone;
+  if (result.approximate)
+    GridCoreset::WriteErrorBound(context, action, result.errorBound, structure);
+
+  if (!result.coverage)
+    return;
+
+  ScAddr const link = NumericLink::Generate(context, result.uncoveredPopulation);
+  ScAddr const linkArc = context.GenerateConnector(ScType::ConstCommonArc, action, link);
+  context.GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_uncovered_population, linkArc);
+  structure << link << linkArc << AmbulanceKeynodes::nrel_uncovered_population;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <sc-memory/sc_memory.hpp>
+
+#include "utils/action_parameters.hpp"
+#include "utils/road_network.hpp"
+#include "utils/village_loader.hpp"
+
+namespace ambulance_module
+{
+
+//параметры действия: mode_coverage, радиус выезда rrel_radius и вместимость rrel_station_capacity
+struct ProblemZoneSettings
+{
+  bool coverage = false;
+  double radius = 0.0;
+  double capacity = std::numeric_limits<double>::infinity();
+  //> 0 - порог по представителям ячеек GridCoreset (только без покрытия и дорог)
+  double accuracy = 0.0;
+};
+
+struct ProblemZoneResult
+{
+  //индексы проблемных деревень в снимке
+  std::vector<size_t> zones;
+  //mode_coverage: зоны - деревни вне радиуса выезда, иначе - дальше порога
+  bool coverage = false;
+  double threshold = 0.0;
+  double uncoveredPopulation = 0.0;
+  //приближенный порог отличается от точного не более чем на errorBound
+  bool approximate = false;
+  double errorBound = 0.0;
+};
+
+//поиск проблемных зон, общий для FindProblemZonesAgent и конвейера
+class ProblemZones
+{
+public:
+  static constexpr size_t kNone = static_cast<size_t>(-1);
+
+  //индекс первой найденной деревни снимка с дугой nrel_optimal_location или kNone
+  static size_t FindOptimalStation(ScMemoryContext & context, VillageSnapshot const & villages);
+
+  //индексы станций в снимке для mode_coverage: first (если задан), затем элементы concept_ambulance_station;
+  //без повторов
+  static std::vector<size_t> CollectStations(
+      ScMemoryContext & context,
+      VillageSnapshot const & villages,
+      size_t first = kNone);
+
+  //false и error при неверных параметрах; читается до записи результатов
+  static bool ReadSettings(ActionParameters const & parameters, ProblemZoneSettings & settings, std::string & error);
+
+  //в режиме покрытия - деревни, не обслуженные ни одной станцией в радиусе,
+  //иначе - деревни дальше 1.5 среднего расстояния до первой станции (оптимальной);
+  //с settings.accuracy среднее считается по ячейкам, точно проверяются только деревни ячеек у порога;
+  //roads - метрика при mode_road_metric или nullptr, stations не пуст
+  static ProblemZoneResult Find(
+      ProblemZoneSettings const & settings,
+      VillageSnapshot const & villages,
+      std::vector<size_t> const & stations,
+      RoadMetric const * roads);
+
+  //action => nrel_problem_zone: деревня; в режиме покрытия еще action => nrel_uncovered_population: [число],
+  //приближенно - action => nrel_error_bound: [граница порога]
+  static void Write(
+      ScMemoryContext & context,
+      ScAddr const & action,
+      VillageSnapshot const & villages,
+      ProblemZoneResult const & result,
+      ScStructure & structure);
+
+  //сколько sc-элементов создает Write
+  static size_t CountWritten(ProblemZoneResult const & result)
+  {
+    return result.zones.size() * 2 + (result.coverage ? 3 : 0) + (result.approximate ? 3 : 0);
+  }
+
+private:
+  static void FindAboveAverage(
+      VillageSnapshot const & villages,
+      size_t station,
+      RoadMetric const * roads,
+      ProblemZoneResult & result);
+
+  static void FindAboveAverageApproximate(
+      VillageSnapshot const & villages,
+      size_t station,
+      double accuracy,
+      ProblemZoneResult & result);
+};
+
+}  // namespace ambulance_module
@@ -0,0 +1,105 @@
+#include "result_links.hpp"
+
+#include <utility>
+#include <vector>
+
+#include "keynodes/ambulance_keynodes.hpp"
+#include "utils/numeric_link.hpp"
+
+using namespace ambulance_module;
+
+ScAddr ResultLinks::FindProperty(
+    ScMemoryContext & context,
+    ScAddr const & element,
+    ScAddr const & relation,
+    ScAddr * arc,
+    size_t * erased)
+{
+  ScAddr found;
+  std::vector<ScAddr> duplicates;
+  ScIterator5Ptr const it5 = context.CreateIterator5(
+      element, ScType::ConstCommonArc, ScType::NodeLink, ScType::ConstPermPosArc, relation);
+  while (it5->Next())
+  {
+    if (!found.IsValid())
+    {
+      found = it5->Get(2);
+      if (arc != nullptr)
+        *arc = it5->Get(1);
+    }
+    else
+      duplicates.push_back(it5->Get(2));
+  }
+
+  //удаление после обхода: итератор не должен видеть изменений
+  for (ScAddr const & link : duplicates)
+    context.EraseElement(link);
+  if (erased != nullptr)
+    *erased += duplicates.size();
+  return found;
+}
+
+bool ResultLinks::UpsertProperty(
+    ScMemoryContext & context,
+    ScAddr const & element,
+    ScAddr const & relation,
+    double value,
+    ScAddr & link,
+    ScAddr & arc)
+{
+  link = FindProperty(context, element, relation, &arc);
+  if (link.IsValid())
+  {
+    NumericLink::Write(context, link, value);
+    return false;
+  }
+
+  link = NumericLink::Generate(context, value);
+  arc = context.GenerateConnector(ScType::ConstCommonArc, element, link);
+  context.GenerateConnector(ScType::ConstPermPosArc, relation, arc);
+  return true;
+}
+
+std::unordered_map<ScAddr::HashType, ScAddr> ResultLinks::CollectDistances(
+    ScMemoryContext & context,
+    ScAddr const & village,
+    size_t * erased)
+{
+  std::unordered_map<ScAddr::HashType, ScAddr> links;
+  std::vector<ScAddr> duplicates;
+
+  ScIterator5Ptr const itOut = context.CreateIterator5(
+      village, ScType::ConstCommonArc, ScType::Unknown, ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_distance);
+  ScIterator5Ptr const itIn = context.CreateIterator5(
+      ScType::Unknown, ScType::ConstCommonArc, village, ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_distance);
+  for (auto const & [it, partnerPosition] : {std::make_pair(itOut, 2), std::make_pair(itIn, 0)})
+  {
+    while (it->Next())
+    {
+      ScAddr const arc = it->Get(1);
+      ScAddr const link = FindDistanceLink(context, arc);
+      if (!link.IsValid() || !links.emplace(it->Get(partnerPosition).Hash(), link).second)
+        duplicates.push_back(arc);
+    }
+  }
+
+  for (ScAddr const & arc : duplicates)
+    EraseDistance(context, arc);
+  if (erased != nullptr)
+    *erased += duplicates.size();
+  return links;
+}
+
+ScAddr ResultLinks::FindDistanceLink(ScMemoryContext & context, ScAddr const & distanceArc)
+{
+  ScIterator3Ptr const it3 = context.CreateIterator3(ScType::NodeLink, ScType::ConstPermPosArc, distanceArc);
+  return it3->Next() ? it3->Get(0) : ScAddr::Empty;
+}
+
+void ResultLinks::EraseDistance(ScMemoryContext & context, ScAddr const & distanceArc)
+{
+  ScAddr const link = FindDistanceLink(context, distanceArc);
+  if (link.IsValid())
+    context.EraseElement(link);
+  context.EraseElement(distanceArc);
+}
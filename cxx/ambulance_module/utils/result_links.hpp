@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <unordered_map>
+
+#include <sc-memory/sc_memory.hpp>
+
+namespace ambulance_module
+{
+
+//поиск ранее записанных результатов, чтобы обновлять их на месте, а не плодить дубликаты
+class ResultLinks
+{
+public:
+  //ссылка свойства: element => relation: [число]; лишние копии удаляются и считаются в erased
+  static ScAddr FindProperty(
+      ScMemoryContext & context,
+      ScAddr const & element,
+      ScAddr const & relation,
+      ScAddr * arc = nullptr,
+      size_t * erased = nullptr);
+
+  //записывает значение в существующую ссылку свойства или создает ее; true - ссылка создана
+  static bool UpsertProperty(
+      ScMemoryContext & context,
+      ScAddr const & element,
+      ScAddr const & relation,
+      double value,
+      ScAddr & link,
+      ScAddr & arc);
+
+  //ссылки nrel_distance деревни в обе стороны по хэшу второй деревни;
+  //если у пары несколько дуг, остается первая, остальные удаляются
+  static std::unordered_map<ScAddr::HashType, ScAddr> CollectDistances(
+      ScMemoryContext & context,
+      ScAddr const & village,
+      size_t * erased = nullptr);
+
+  //ссылка, хранящая расстояние дуги nrel_distance (link -> дуга)
+  static ScAddr FindDistanceLink(ScMemoryContext & context, ScAddr const & distanceArc);
+
+  //удаляет дугу nrel_distance вместе со ссылкой
+  static void EraseDistance(ScMemoryContext & context, ScAddr const & distanceArc);
+};
+
+}  // namespace ambulance_module
@@ -0,0 +1,286 @@
+#include "road_network.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <tuple>
+#include <unordered_map>
+
+#include "keynodes/ambulance_keynodes.hpp"
+#include "utils/numeric_link.hpp"
+
+using namespace ambulance_module;
+
+namespace
+{
+
+double const kUnreachable = std::numeric_limits<double>::infinity();
+
+//источники маршрутов, которые поток забирает за раз
+size_t const kSourceGrain = 4;
+
+std::mutex cacheMutex;
+std::shared_ptr<RoadMetric const> cachedMetric;
+
+}  // namespace
+
+bool RoadGraph::operator==(RoadGraph const & other) const
+{
+  return offsets == other.offsets && targets == other.targets && times == other.times;
+}
+
+RoadGraph RoadNetwork::Load(ScMemoryContext & context, VillageSnapshot const & villages, size_t * skipped)
+{
+  std::unordered_map<ScAddr::HashType, size_t> index;
+  index.reserve(villages.Size());
+  for (size_t i = 0; i < villages.Size(); ++i)
+    index.emplace(villages.addrs[i].Hash(), i);
+
+  //концы дорог вне снимка: координаты читаются, только если у дороги нет времени проезда
+  std::vector<ScAddr> extra;
+  std::vector<std::pair<double, double>> extraPoints;
+  std::vector<char> extraState;  //0 - не читались, 1 - есть, 2 - нет
+  auto const Vertex = [&](ScAddr const & node)
+  {
+    auto const [it, inserted] = index.emplace(node.Hash(), villages.Size() + extra.size());
+    if (inserted)
+    {
+      extra.push_back(node);
+      extraPoints.emplace_back(0.0, 0.0);
+      extraState.push_back(0);
+    }
+    return it->second;
+  };
+  auto const Point = [&](size_t vertex, double & x, double & y)
+  {
+    if (vertex < villages.Size())
+    {
+      x = villages.x[vertex];
+      y = villages.y[vertex];
+      return true;
+    }
+    size_t const k = vertex - villages.Size();
+    if (extraState[k] == 0)
+    {
+      ScAddr const relations[] = {AmbulanceKeynodes::nrel_coordinate_x, AmbulanceKeynodes::nrel_coordinate_y};
+      double values[2] = {0.0, 0.0};
+      VillageRecordStatus statuses[2];
+      VillageLoader::ReadProperties(context, extra[k], relations, 2, values, statuses);
+      bool const found = statuses[0] == VillageRecordStatus::Ok && statuses[1] == VillageRecordStatus::Ok;
+      extraPoints[k] = {values[0], values[1]};
+      extraState[k] = found ? 1 : 2;
+    }
+    std::tie(x, y) = extraPoints[k];
+    return extraState[k] == 1;
+  };
+
+  //ребро в обе стороны: (откуда, куда, время)
+  std::vector<std::tuple<size_t, size_t, double>> edges;
+  size_t skippedRoads = 0;
+
+  ScIterator3Ptr const itRoad =
+      context.CreateIterator3(AmbulanceKeynodes::nrel_road, ScType::ConstPermPosArc, ScType::ConstCommonArc);
+  while (itRoad->Next())
+  {
+    ScAddr const road = itRoad->Get(2);
+    auto const [from, to] = context.GetConnectorIncidentElements(road);
+    size_t const i = Vertex(from);
+    size_t const j = Vertex(to);
+    if (i == j)
+      continue;
+
+    double time = -1.0;
+    ScIterator5Ptr const itTime = context.CreateIterator5(
+        road, ScType::ConstCommonArc, ScType::NodeLink, ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_travel_time);
+    if (!itTime->Next() || !NumericLink::Read(context, itTime->Get(2), time) || !(time >= 0.0) || std::isinf(time))
+    {
+      double fromX = 0.0, fromY = 0.0, toX = 0.0, toY = 0.0;
+      if (!Point(i, fromX, fromY) || !Point(j, toX, toY))
+      {
+        ++skippedRoads;
+        continue;
+      }
+      time = std::hypot(fromX - toX, fromY - toY);
+    }
+
+    edges.emplace_back(i, j, time);
+    edges.emplace_back(j, i, time);
+  }
+
+  //порядок обхода базы знаний не задан - сортировка делает граф сравнимым между загрузками;
+  //номера вершин вне снимка тоже зависят от обхода, поэтому они перенумеровываются по хэшу адреса
+  std::vector<size_t> order(extra.size());
+  for (size_t k = 0; k < order.size(); ++k)
+    order[k] = k;
+  std::sort(
+      order.begin(),
+      order.end(),
+      [&](size_t a, size_t b)
+      {
+        return extra[a].Hash() < extra[b].Hash();
+      });
+  std::vector<size_t> renumber(extra.size());
+  for (size_t k = 0; k < order.size(); ++k)
+    renumber[order[k]] = villages.Size() + k;
+  for (auto & [from, to, time] : edges)
+  {
+    if (from >= villages.Size())
+      from = renumber[from - villages.Size()];
+    if (to >= villages.Size())
+      to = renumber[to - villages.Size()];
+  }
+  std::sort(edges.begin(), edges.end());
+
+  RoadGraph graph;
+  graph.offsets.assign(villages.Size() + extra.size() + 1, 0);
+  graph.targets.reserve(edges.size());
+  graph.times.reserve(edges.size());
+  for (auto const & [from, to, time] : edges)
+  {
+    ++graph.offsets[from + 1];
+    graph.targets.push_back(to);
+    graph.times.push_back(time);
+  }
+  for (size_t i = 0; i + 1 < graph.offsets.size(); ++i)
+    graph.offsets[i + 1] += graph.offsets[i];
+
+  if (skipped != nullptr)
+    *skipped = skippedRoads;
+  return graph;
+}
+
+void RoadNetwork::ShortestPaths(
+    RoadGraph const & graph,
+    size_t source,
+    double * out,
+    std::vector<std::pair<double, size_t>> & heap)
+{
+  size_t const size = graph.Size();
+  std::fill(out, out + size, kUnreachable);
+  out[source] = 0.0;
+
+  //ленивое удаление: устаревшие записи кучи пропускаются при извлечении
+  auto const Later = std::greater<std::pair<double, size_t>>();
+  heap.clear();
+  heap.emplace_back(0.0, source);
+  while (!heap.empty())
+  {
+    std::pop_heap(heap.begin(), heap.end(), Later);
+    auto const [distance, vertex] = heap.back();
+    heap.pop_back();
+    if (distance > out[vertex])
+      continue;
+
+    for (size_t e = graph.offsets[vertex]; e < graph.offsets[vertex + 1]; ++e)
+    {
+      double const candidate = distance + graph.times[e];
+      size_t const target = graph.targets[e];
+      if (candidate < out[target])
+      {
+        out[target] = candidate;
+        heap.emplace_back(candidate, target);
+        std::push_heap(heap.begin(), heap.end(), Later);
+      }
+    }
+  }
+}
+
+DistanceMatrix RoadNetwork::AllPairs(ThreadPool & pool, RoadGraph const & graph, std::vector<ScAddr> const & addrs)
+{
+  DistanceMatrix matrix(addrs, MatrixPrecision::Double);
+  size_t const size = addrs.size();
+
+  struct Scratch
+  {
+    std::vector<double> row;
+    std::vector<std::pair<double, size_t>> heap;
+  };
+  std::vector<Scratch> scratch(pool.GetThreadCount());
+
+  //дороги двусторонние, поэтому из источника i пишется только правая часть строки (j > i);
+  //пары разных источников не пересекаются, запись без блокировок
+  pool.ParallelFor(
+      size,
+      kSourceGrain,
+      [&](size_t begin, size_t end, size_t worker)
+      {
+        Scratch & local = scratch[worker];
+        local.row.resize(graph.Size());
+        for (size_t source = begin; source < end; ++source)
+        {
+          ShortestPaths(graph, source, local.row.data(), local.heap);
+          for (size_t target = source + 1; target < size; ++target)
+            matrix.Set(source, target, local.row[target]);
+        }
+      });
+
+  return matrix;
+}
+
+RoadMetric::RoadMetric(RoadGraph graph, DistanceMatrix matrix)
+  : m_graph(std::move(graph))
+  , m_matrix(std::move(matrix))
+{
+  for (size_t i = 0; m_connected && i + 1 < m_matrix.Size(); ++i)
+    m_connected = !std::isinf(m_matrix.At(0, i + 1));
+}
+
+double RoadMetric::At(size_t i, size_t j) const
+{
+  return i == j ? 0.0 : m_matrix.At(i, j);
+}
+
+void RoadMetric::Row(size_t i, double * out) const
+{
+  for (size_t j = 0; j < Size(); ++j)
+    out[j] = At(i, j);
+}
+
+double RoadMetric::RowMax(size_t i) const
+{
+  double result = 0.0;
+  for (size_t j = 0; j < Size(); ++j)
+    result = std::max(result, At(i, j));
+  return result;
+}
+
+double RoadMetric::RowWeightedSum(size_t i, double const * weights) const
+{
+  double result = 0.0;
+  for (size_t j = 0; j < Size(); ++j)
+  {
+    //нулевой вес недостижимой деревни дал бы 0 * inf = NaN
+    if (j != i && weights[j] != 0.0)
+      result += weights[j] * At(i, j);
+  }
+  return result;
+}
+
+std::shared_ptr<RoadMetric const> RoadMetric::Acquire(ScMemoryContext & context, VillageSnapshot const & villages)
+{
+  //граф читается каждый раз (O(дорог)), маршруты пересчитываются только при изменениях
+  RoadGraph graph = RoadNetwork::Load(context, villages);
+
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  if (cachedMetric != nullptr && cachedMetric->GetMatrix().GetAddrs() == villages.addrs
+      && cachedMetric->GetGraph() == graph)
+    return cachedMetric;
+
+  DistanceMatrix matrix = RoadNetwork::AllPairs(*ThreadPool::GetShared(), graph, villages.addrs);
+  cachedMetric = std::make_shared<RoadMetric const>(std::move(graph), std::move(matrix));
+  return cachedMetric;
+}
+
+std::shared_ptr<RoadMetric const> RoadMetric::GetCached()
+{
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  return cachedMetric;
+}
+
+void RoadMetric::Restore(RoadGraph graph, DistanceMatrix matrix)
+{
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  cachedMetric = std::make_shared<RoadMetric const>(std::move(graph), std::move(matrix));
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <sc-memory/sc_memory.hpp>
+
+#include "utils/distance_matrix.hpp"
+#include "utils/thread_pool.hpp"
+#include "utils/village_loader.hpp"
+
+namespace ambulance_module
+{
+
+//дорожный граф в формате CSR: вершины 0..n-1 - деревни снимка, дальше - остальные концы дорог
+//(деревни вне области действия, неполные деревни, перекрестки);
+//соседи вершины i - targets[offsets[i], offsets[i + 1]), время проезда - в times
+struct RoadGraph
+{
+  std::vector<size_t> offsets;
+  std::vector<size_t> targets;
+  std::vector<double> times;
+
+  size_t Size() const
+  {
+    return offsets.empty() ? 0 : offsets.size() - 1;
+  }
+
+  size_t GetEdgeCount() const
+  {
+    return targets.size();
+  }
+
+  bool operator==(RoadGraph const & other) const;
+};
+
+class RoadNetwork
+{
+public:
+  //дороги: деревня => nrel_road: деревня, движение в обе стороны;
+  //время проезда: дуга дороги => nrel_travel_time: [число], без него - длина отрезка;
+  //маршруты идут и через концы дорог вне снимка, поэтому читаются все дороги;
+  //дорога без времени, у конца которой нет координат, пропускается и считается в skipped
+  static RoadGraph Load(ScMemoryContext & context, VillageSnapshot const & villages, size_t * skipped = nullptr);
+
+  //кратчайшие времена от source до всех деревень (Дейкстра на двоичной куче),
+  //недостижимые - бесконечность; heap - переиспользуемый буфер
+  static void ShortestPaths(
+      RoadGraph const & graph,
+      size_t source,
+      double * out,
+      std::vector<std::pair<double, size_t>> & heap);
+
+  //все пары деревень снимка (первые addrs.size() вершин), источники обрабатываются параллельно
+  static DistanceMatrix AllPairs(ThreadPool & pool, RoadGraph const & graph, std::vector<ScAddr> const & addrs);
+};
+
+//метрика по дорогам для снимка: матрица считается один раз и переиспользуется,
+//пока не изменились деревни или дороги
+class RoadMetric
+{
+public:
+  RoadMetric(RoadGraph graph, DistanceMatrix matrix);
+
+  size_t Size() const
+  {
+    return m_matrix.Size();
+  }
+
+  DistanceMatrix const & GetMatrix() const
+  {
+    return m_matrix;
+  }
+
+  RoadGraph const & GetGraph() const
+  {
+    return m_graph;
+  }
+
+  //все деревни достижимы друг из друга
+  bool IsConnected() const
+  {
+    return m_connected;
+  }
+
+  double At(size_t i, size_t j) const;
+  void Row(size_t i, double * out) const;
+  double RowMax(size_t i) const;
+  double RowWeightedSum(size_t i, double const * weights) const;
+
+  //метрика из кэша или новая, если снимок или дороги изменились
+  static std::shared_ptr<RoadMetric const> Acquire(ScMemoryContext & context, VillageSnapshot const & villages);
+
+  //кэшированная метрика (nullptr - еще не считалась) и ее восстановление из снимка модуля;
+  //Acquire все равно сверяет ее с текущими деревнями и дорогами
+  static std::shared_ptr<RoadMetric const> GetCached();
+  static void Restore(RoadGraph graph, DistanceMatrix matrix);
+
+private:
+  RoadGraph m_graph;
+  DistanceMatrix m_matrix;
+  bool m_connected = true;
+};
+
+}  // namespace ambulance_module
@@ -0,0 +1,28 @@
+#include "spatial_index.hpp"
+
+#include <mutex>
+#include <utility>
+
+using namespace ambulance_module;
+
+namespace
+{
+
+std::mutex cacheMutex;
+std::shared_ptr<SpatialIndex const> cachedIndex;
+
+}  // namespace
+
+SpatialIndex::SpatialIndex(std::shared_ptr<VillageSnapshot const> snapshot)
+  : m_snapshot(std::move(snapshot))
+  , m_tree(m_snapshot->x.data(), m_snapshot->y.data(), m_snapshot->Size())
+{
+}
+
+std::shared_ptr<SpatialIndex const> SpatialIndex::Acquire(std::shared_ptr<VillageSnapshot const> const & snapshot)
+{
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  if (cachedIndex == nullptr || &cachedIndex->GetVillages() != snapshot.get())
+    cachedIndex = std::make_shared<SpatialIndex const>(snapshot);
+  return cachedIndex;
+}
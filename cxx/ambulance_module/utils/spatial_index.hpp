@@ -0,0 +1,35 @@
+#pragma once
+
+#include <memory>
+
+#include "utils/kd_tree.hpp"
+#include "utils/village_loader.hpp"
+
+namespace ambulance_module
+{
+
+//k-d дерево по координатам снимка; держит снимок, чтобы массивы x/y жили вместе с деревом
+class SpatialIndex
+{
+public:
+  explicit SpatialIndex(std::shared_ptr<VillageSnapshot const> snapshot);
+
+  VillageSnapshot const & GetVillages() const
+  {
+    return *m_snapshot;
+  }
+
+  KdTree const & GetTree() const
+  {
+    return m_tree;
+  }
+
+  //индекс последнего снимка переиспользуется, пока кэш деревень отдает тот же снимок
+  static std::shared_ptr<SpatialIndex const> Acquire(std::shared_ptr<VillageSnapshot const> const & snapshot);
+
+private:
+  std::shared_ptr<VillageSnapshot const> m_snapshot;
+  KdTree m_tree;
+};
+
+}  // namespace ambulance_module
@@ -0,0 +1,401 @@
+#include "station_placement.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <utility>
+
+#include "utils/distance_kernel.hpp"
+
+using namespace ambulance_module;
+
+namespace
+{
+
+double const kInfinity = std::numeric_limits<double>::infinity();
+
+//сколько кандидатов на обмен поток забирает за раз
+size_t const kSwapGrain = 16;
+
+size_t const kRelocateRounds = 16;
+
+struct SwapMove
+{
+  double delta = 0.0;
+  //вторичный критерий для p-центра: приращение суммы с весом населения,
+  //позволяет двигаться по "плато", где максимум не меняется
+  double tieDelta = 0.0;
+  size_t candidate = std::numeric_limits<size_t>::max();
+  size_t slot = std::numeric_limits<size_t>::max();
+
+  //меньшее приращение лучше, при равенстве - меньшие индексы; не зависит от числа потоков
+  bool IsBetterThan(SwapMove const & other) const
+  {
+    if (delta != other.delta)
+      return delta < other.delta;
+    if (tieDelta != other.tieDelta)
+      return tieDelta < other.tieDelta;
+    if (candidate != other.candidate)
+      return candidate < other.candidate;
+    return slot < other.slot;
+  }
+};
+
+}  // namespace
+
+StationPlacement::StationPlacement(
+    double const * xs,
+    double const * ys,
+    double const * weights,
+    size_t count,
+    PlacementObjective objective)
+  : m_xs(xs)
+  , m_ys(ys)
+  , m_weights(weights)
+  , m_count(count)
+  , m_objective(objective)
+{
+}
+
+std::vector<size_t> StationPlacement::Seed(size_t stationCount, uint64_t seed) const
+{
+  std::mt19937_64 random(seed);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+  //выбор индекса с вероятностью, пропорциональной весу; при нулевой сумме - самый тяжелый
+  auto const Pick = [&](std::vector<double> const & weights)
+  {
+    double total = 0.0;
+    for (double const weight : weights)
+      total += weight;
+    if (!(total > 0.0))
+      return size_t(std::max_element(weights.begin(), weights.end()) - weights.begin());
+
+    double target = unit(random) * total;
+    for (size_t i = 0; i < weights.size(); ++i)
+    {
+      target -= weights[i];
+      if (target < 0.0 && weights[i] > 0.0)
+        return i;
+    }
+    //ошибка округления - последний ненулевой
+    size_t last = weights.size() - 1;
+    while (last > 0 && weights[last] <= 0.0)
+      --last;
+    return last;
+  };
+
+  std::vector<size_t> stations;
+  stations.reserve(stationCount);
+  stations.push_back(Pick(std::vector<double>(m_weights, m_weights + m_count)));
+
+  std::vector<double> nearest(m_count, kInfinity);
+  std::vector<double> row(m_count);
+  std::vector<double> chance(m_count);
+  std::vector<char> isStation(m_count, 0);
+  isStation[stations.front()] = 1;
+  while (stations.size() < stationCount)
+  {
+    size_t const last = stations.back();
+    DistanceKernel::Row(m_xs, m_ys, m_count, m_xs[last], m_ys[last], row.data());
+    for (size_t i = 0; i < m_count; ++i)
+      nearest[i] = std::min(nearest[i], row[i]);
+
+    if (m_objective == PlacementObjective::Center)
+    {
+      //для p-центра - самая дальняя деревня (2-приближение Гонзалеса) среди еще не выбранных
+      size_t farthest = m_count;
+      for (size_t i = 0; i < m_count; ++i)
+      {
+        if (!isStation[i] && (farthest == m_count || nearest[i] > nearest[farthest]))
+          farthest = i;
+      }
+      //остальные деревни совпадают со станциями - новая станция ничего не улучшит
+      if (farthest == m_count || !(nearest[farthest] > 0.0))
+        break;
+      isStation[farthest] = 1;
+      stations.push_back(farthest);
+      continue;
+    }
+
+    //k-means++: вероятность пропорциональна населению на квадрат расстояния
+    for (size_t i = 0; i < m_count; ++i)
+      chance[i] = m_weights[i] * nearest[i] * nearest[i];
+    size_t next = Pick(chance);
+    //совпавшие точки дают нулевой шанс; если выбирать больше не из чего, берем первую свободную
+    if (isStation[next])
+    {
+      next = 0;
+      while (isStation[next])
+        ++next;
+    }
+    isStation[next] = 1;
+    stations.push_back(next);
+  }
+  return stations;
+}
+
+void StationPlacement::Assign(std::vector<size_t> const & stations, Assignment & assignment) const
+{
+  assignment.nearest.assign(m_count, kInfinity);
+  assignment.second.assign(m_count, kInfinity);
+  assignment.owner.assign(m_count, 0);
+
+  std::vector<double> row(m_count);
+  for (size_t slot = 0; slot < stations.size(); ++slot)
+  {
+    size_t const station = stations[slot];
+    DistanceKernel::Row(m_xs, m_ys, m_count, m_xs[station], m_ys[station], row.data());
+    for (size_t i = 0; i < m_count; ++i)
+    {
+      if (row[i] < assignment.nearest[i])
+      {
+        assignment.second[i] = assignment.nearest[i];
+        assignment.nearest[i] = row[i];
+        assignment.owner[i] = slot;
+      }
+      else if (row[i] < assignment.second[i])
+        assignment.second[i] = row[i];
+    }
+  }
+}
+
+bool StationPlacement::Relocate(std::vector<size_t> & stations, Assignment const & assignment, size_t & pairs) const
+{
+  std::vector<std::vector<size_t>> clusters(stations.size());
+  for (size_t i = 0; i < m_count; ++i)
+    clusters[assignment.owner[i]].push_back(i);
+
+  bool changed = false;
+  std::vector<double> xs;
+  std::vector<double> ys;
+  std::vector<double> weights;
+  for (size_t slot = 0; slot < stations.size(); ++slot)
+  {
+    std::vector<size_t> const & members = clusters[slot];
+    if (members.size() < 2)
+      continue;
+
+    xs.clear();
+    ys.clear();
+    weights.clear();
+    for (size_t const i : members)
+    {
+      xs.push_back(m_xs[i]);
+      ys.push_back(m_ys[i]);
+      weights.push_back(m_weights[i]);
+    }
+
+    //лучшая деревня кластера для него самого; текущая станция побеждает при равенстве
+    pairs += members.size() * members.size();
+    size_t bestIndex = stations[slot];
+    double bestCost = kInfinity;
+    for (size_t k = 0; k < members.size(); ++k)
+    {
+      double const cost = m_objective == PlacementObjective::Median
+                              ? DistanceKernel::RowWeightedSum(
+                                    xs.data(), ys.data(), weights.data(), xs.size(), xs[k], ys[k])
+                              : DistanceKernel::RowMax(xs.data(), ys.data(), xs.size(), xs[k], ys[k]);
+      if (cost < bestCost || (cost == bestCost && members[k] == stations[slot]))
+      {
+        bestCost = cost;
+        bestIndex = members[k];
+      }
+    }
+    if (bestIndex != stations[slot])
+    {
+      stations[slot] = bestIndex;
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+double StationPlacement::Cost(Assignment const & assignment) const
+{
+  double cost = 0.0;
+  for (size_t i = 0; i < m_count; ++i)
+  {
+    if (m_objective == PlacementObjective::Median)
+      cost += m_weights[i] * assignment.nearest[i];
+    else
+      cost = std::max(cost, assignment.nearest[i]);
+  }
+  return cost;
+}
+
+PlacementResult StationPlacement::Solve(
+    ThreadPool & pool,
+    size_t stationCount,
+    size_t maxSwaps,
+    uint64_t seed,
+    std::function<bool(size_t)> const & proceed) const
+{
+  PlacementResult result;
+  stationCount = std::min(stationCount, m_count);
+  if (stationCount == 0)
+    return result;
+
+  result.stations = Seed(stationCount, seed);
+  //p-центр не ставит станции в деревни, совпадающие с уже выбранными
+  stationCount = result.stations.size();
+  Assignment assignment;
+  Assign(result.stations, assignment);
+  //строки затравки и назначения станций
+  result.pairsEvaluated = 2 * stationCount * m_count;
+  result.cost = Cost(assignment);
+
+  //размещение-распределение (Купер): станция переезжает в лучшую деревню своего кластера;
+  //дешево и убирает большую часть обменов; принимается только улучшение
+  for (size_t round = 0; round < kRelocateRounds; ++round)
+  {
+    std::vector<size_t> moved = result.stations;
+    if (!Relocate(moved, assignment, result.pairsEvaluated))
+      break;
+
+    Assignment candidate;
+    Assign(moved, candidate);
+    result.pairsEvaluated += stationCount * m_count;
+    double const cost = Cost(candidate);
+    if (!(cost < result.cost))
+      break;
+    result.stations = std::move(moved);
+    assignment = std::move(candidate);
+    result.cost = cost;
+  }
+
+  std::vector<char> isStation(m_count, 0);
+  for (size_t const station : result.stations)
+    isStation[station] = 1;
+
+  struct Scratch
+  {
+    std::vector<double> row;
+    std::vector<double> sumLoss;
+    std::vector<double> maxKept;
+    std::vector<double> maxRemoved;
+  };
+  std::vector<Scratch> scratch(pool.GetThreadCount());
+  std::vector<SwapMove> bestPerWorker(pool.GetThreadCount());
+
+  while (result.swaps < maxSwaps && stationCount < m_count)
+  {
+    if (proceed != nullptr && !proceed(result.swaps))
+    {
+      result.complete = false;
+      break;
+    }
+    std::fill(bestPerWorker.begin(), bestPerWorker.end(), SwapMove());
+
+    pool.ParallelFor(
+        m_count,
+        kSwapGrain,
+        [&](size_t begin, size_t end, size_t worker)
+        {
+          Scratch & local = scratch[worker];
+          local.row.resize(m_count);
+          SwapMove & best = bestPerWorker[worker];
+
+          for (size_t candidate = begin; candidate < end; ++candidate)
+          {
+            if (isStation[candidate])
+              continue;
+
+            DistanceKernel::Row(m_xs, m_ys, m_count, m_xs[candidate], m_ys[candidate], local.row.data());
+
+            //сумма с весом: gain - выигрыш от добавления кандидата,
+            //sumLoss[f] - потери деревень станции f, если ее убрать (они уходят ко второй станции или к кандидату)
+            local.sumLoss.assign(stationCount, 0.0);
+            double gain = 0.0;
+            for (size_t i = 0; i < m_count; ++i)
+            {
+              double const d = local.row[i];
+              if (d < assignment.nearest[i])
+                gain += m_weights[i] * (assignment.nearest[i] - d);
+              else
+                local.sumLoss[assignment.owner[i]] +=
+                    m_weights[i] * (std::min(assignment.second[i], d) - assignment.nearest[i]);
+            }
+
+            if (m_objective == PlacementObjective::Median)
+            {
+              for (size_t slot = 0; slot < stationCount; ++slot)
+              {
+                SwapMove const move{local.sumLoss[slot] - gain, 0.0, candidate, slot};
+                if (move.IsBetterThan(best))
+                  best = move;
+              }
+              continue;
+            }
+
+            //максимум: maxKept[f] - по деревням станции f, если f остается, maxRemoved[f] - если f убрать;
+            //итог для f - максимум по остальным станциям и maxRemoved[f]
+            local.maxKept.assign(stationCount, 0.0);
+            local.maxRemoved.assign(stationCount, 0.0);
+            for (size_t i = 0; i < m_count; ++i)
+            {
+              double const d = local.row[i];
+              size_t const owner = assignment.owner[i];
+              local.maxKept[owner] = std::max(local.maxKept[owner], std::min(assignment.nearest[i], d));
+              local.maxRemoved[owner] = std::max(local.maxRemoved[owner], std::min(assignment.second[i], d));
+            }
+
+            //два наибольших maxKept, чтобы исключать удаляемую станцию за O(1)
+            double top = 0.0;
+            double runnerUp = 0.0;
+            size_t topSlot = 0;
+            for (size_t slot = 0; slot < stationCount; ++slot)
+            {
+              if (local.maxKept[slot] > top)
+              {
+                runnerUp = top;
+                top = local.maxKept[slot];
+                topSlot = slot;
+              }
+              else if (local.maxKept[slot] > runnerUp)
+                runnerUp = local.maxKept[slot];
+            }
+
+            for (size_t slot = 0; slot < stationCount; ++slot)
+            {
+              double const others = slot == topSlot ? runnerUp : top;
+              SwapMove const move{
+                  std::max(others, local.maxRemoved[slot]) - result.cost, local.sumLoss[slot] - gain, candidate, slot};
+              if (move.IsBetterThan(best))
+                best = move;
+            }
+          }
+        });
+
+    //строка каждого кандидата
+    result.pairsEvaluated += (m_count - stationCount) * m_count;
+
+    SwapMove best;
+    for (SwapMove const & move : bestPerWorker)
+    {
+      if (move.IsBetterThan(best))
+        best = move;
+    }
+
+    //останавливаемся, когда ни один обмен не улучшает стоимость заметнее погрешности;
+    //для p-центра при неизменном максимуме достаточно уменьшить сумму
+    double const tolerance = 1e-12 * std::max(1.0, std::fabs(result.cost));
+    bool const improves = best.delta < -tolerance
+                          || (m_objective == PlacementObjective::Center && best.delta <= tolerance
+                              && best.tieDelta < -1e-12 * std::max(1.0, std::fabs(best.tieDelta)));
+    if (best.candidate == std::numeric_limits<size_t>::max() || !improves)
+      break;
+
+    isStation[result.stations[best.slot]] = 0;
+    isStation[best.candidate] = 1;
+    result.stations[best.slot] = best.candidate;
+    Assign(result.stations, assignment);
+    result.pairsEvaluated += stationCount * m_count;
+    result.cost = Cost(assignment);
+    ++result.swaps;
+  }
+
+  result.assignment = std::move(assignment.owner);
+  return result;
+}
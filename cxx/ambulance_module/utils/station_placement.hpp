@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "utils/thread_pool.hpp"
+
+namespace ambulance_module
+{
+
+enum class PlacementObjective
+{
+  Median,  //сумма расстояний с весом населения до ближайшей станции (p-медиана)
+  Center,  //наибольшее расстояние до ближайшей станции (p-центр)
+};
+
+struct PlacementResult
+{
+  //индексы деревень-станций
+  std::vector<size_t> stations;
+  //для каждой деревни - позиция ближайшей станции в stations
+  std::vector<size_t> assignment;
+  double cost = 0.0;
+  size_t swaps = 0;
+  //false - остановлено через proceed до схождения
+  bool complete = true;
+  //вычисленных расстояний деревня-деревня
+  size_t pairsEvaluated = 0;
+};
+
+//размещение p станций среди деревень: затравка k-means++ (для p-центра - самая дальняя точка),
+//переезд станций внутри своих кластеров, затем обмены Тейца-Барта "станция <-> деревня"
+//с приращениями стоимости за O(n + p) на кандидата
+class StationPlacement
+{
+public:
+  static constexpr size_t kDefaultMaxSwaps = 1000;
+  static constexpr uint64_t kDefaultSeed = 0x5eed;
+
+  //массивы должны жить дольше объекта
+  StationPlacement(
+      double const * xs,
+      double const * ys,
+      double const * weights,
+      size_t count,
+      PlacementObjective objective);
+
+  //proceed(сделано обменов) вызывается перед каждым раундом обменов; false - остановиться
+  //с текущим размещением, оно допустимо после любого раунда;
+  //для p-центра станций меньше stationCount, если остальные деревни совпадают с выбранными
+  PlacementResult Solve(
+      ThreadPool & pool,
+      size_t stationCount,
+      size_t maxSwaps = kDefaultMaxSwaps,
+      uint64_t seed = kDefaultSeed,
+      std::function<bool(size_t)> const & proceed = nullptr) const;
+
+private:
+  struct Assignment
+  {
+    std::vector<double> nearest;
+    std::vector<double> second;
+    std::vector<size_t> owner;
+  };
+
+  std::vector<size_t> Seed(size_t stationCount, uint64_t seed) const;
+  void Assign(std::vector<size_t> const & stations, Assignment & assignment) const;
+  //pairs увеличивается на число вычисленных расстояний
+  bool Relocate(std::vector<size_t> & stations, Assignment const & assignment, size_t & pairs) const;
+  double Cost(Assignment const & assignment) const;
+
+  double const * m_xs;
+  double const * m_ys;
+  double const * m_weights;
+  size_t m_count;
+  PlacementObjective m_objective;
+};
+
+}  // namespace ambulance_module
@@ -0,0 +1,166 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+
+using namespace ambulance_module;
+
+namespace
+{
+
+std::mutex sharedMutex;
+std::shared_ptr<ThreadPool> sharedPool;
+size_t sharedThreadCount = 0;
+
+}  // namespace
+
+ThreadPool::ThreadPool(size_t threadCount)
+{
+  threadCount = std::max<size_t>(threadCount, 1);
+  m_queues.reserve(threadCount);
+  for (size_t i = 0; i < threadCount; ++i)
+    m_queues.push_back(std::make_unique<WorkerQueue>());
+
+  //последняя очередь принадлежит вызывающему потоку
+  m_threads.reserve(threadCount - 1);
+  for (size_t i = 0; i + 1 < threadCount; ++i)
+    m_threads.emplace_back(&ThreadPool::WorkerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_stateMutex);
+    m_stopping = true;
+  }
+  m_wakeUp.notify_all();
+  for (std::thread & thread : m_threads)
+    thread.join();
+}
+
+void ThreadPool::ParallelFor(size_t count, size_t grain, RangeBody const & body)
+{
+  if (count == 0)
+    return;
+
+  size_t const workers = GetThreadCount();
+  grain = std::max<size_t>(grain, 1);
+  if (workers == 1 || count <= grain)
+  {
+    body(0, count, 0);
+    return;
+  }
+
+  std::lock_guard<std::mutex> runLock(m_runMutex);
+
+  //соседние куски попадают в одну очередь, чтобы поток шел по памяти подряд
+  size_t const chunkCount = (count + grain - 1) / grain;
+  size_t const chunksPerWorker = (chunkCount + workers - 1) / workers;
+  for (size_t chunk = 0; chunk < chunkCount; ++chunk)
+  {
+    size_t const begin = chunk * grain;
+    size_t const end = std::min(count, begin + grain);
+    WorkerQueue & queue = *m_queues[std::min(chunk / chunksPerWorker, workers - 1)];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.chunks.emplace_back(begin, end);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_stateMutex);
+    m_body = &body;
+    m_remainingChunks.store(chunkCount);
+    m_activeWorkers = m_threads.size();
+    ++m_generation;
+  }
+  m_wakeUp.notify_all();
+
+  RunChunks(workers - 1);
+
+  //ждем, пока все потоки вернутся, чтобы body не использовался после выхода
+  std::unique_lock<std::mutex> lock(m_stateMutex);
+  m_finished.wait(lock, [this] { return m_activeWorkers == 0; });
+  m_body = nullptr;
+}
+
+void ThreadPool::WorkerLoop(size_t worker)
+{
+  uint64_t seenGeneration = 0;
+  while (true)
+  {
+    {
+      std::unique_lock<std::mutex> lock(m_stateMutex);
+      m_wakeUp.wait(lock, [&] { return m_stopping || m_generation != seenGeneration; });
+      if (m_stopping)
+        return;
+      seenGeneration = m_generation;
+    }
+
+    RunChunks(worker);
+
+    std::lock_guard<std::mutex> lock(m_stateMutex);
+    if (--m_activeWorkers == 0)
+      m_finished.notify_all();
+  }
+}
+
+void ThreadPool::RunChunks(size_t worker)
+{
+  std::pair<size_t, size_t> chunk;
+  while (m_remainingChunks.load() > 0)
+  {
+    if (!PopOwn(worker, chunk) && !Steal(worker, chunk))
+      break;
+
+    (*m_body)(chunk.first, chunk.second, worker);
+    m_remainingChunks.fetch_sub(1);
+  }
+}
+
+bool ThreadPool::PopOwn(size_t worker, std::pair<size_t, size_t> & chunk)
+{
+  WorkerQueue & queue = *m_queues[worker];
+  std::lock_guard<std::mutex> lock(queue.mutex);
+  if (queue.chunks.empty())
+    return false;
+
+  chunk = queue.chunks.front();
+  queue.chunks.pop_front();
+  return true;
+}
+
+bool ThreadPool::Steal(size_t worker, std::pair<size_t, size_t> & chunk)
+{
+  size_t const workers = GetThreadCount();
+  for (size_t offset = 1; offset < workers; ++offset)
+  {
+    WorkerQueue & victim = *m_queues[(worker + offset) % workers];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (victim.chunks.empty())
+      continue;
+
+    chunk = victim.chunks.back();
+    victim.chunks.pop_back();
+    return true;
+  }
+  return false;
+}
+
+size_t ThreadPool::GetDefaultThreadCount()
+{
+  return std::max<size_t>(std::thread::hardware_concurrency(), 1);
+}
+
+std::shared_ptr<ThreadPool> ThreadPool::GetShared()
+{
+  std::lock_guard<std::mutex> lock(sharedMutex);
+  if (sharedPool == nullptr)
+    sharedPool = std::make_shared<ThreadPool>(sharedThreadCount == 0 ? GetDefaultThreadCount() : sharedThreadCount);
+  return sharedPool;
+}
+
+void ThreadPool::SetSharedThreadCount(size_t threadCount)
+{
+  std::lock_guard<std::mutex> lock(sharedMutex);
+  sharedThreadCount = threadCount;
+  //агенты, уже взявшие старый пул, доработают на нем
+  sharedPool.reset();
+}
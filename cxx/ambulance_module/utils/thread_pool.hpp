@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace ambulance_module
+{
+
+//пул потоков с кражей работы: диапазон делится на куски, каждый поток берет куски
+//из своей очереди, а закончив - ворует с хвоста чужих очередей
+class ThreadPool
+{
+public:
+  //body(begin, end, worker): worker в [0, GetThreadCount())
+  using RangeBody = std::function<void(size_t, size_t, size_t)>;
+
+  explicit ThreadPool(size_t threadCount);
+  ~ThreadPool();
+
+  ThreadPool(ThreadPool const &) = delete;
+  ThreadPool & operator=(ThreadPool const &) = delete;
+
+  //число потоков вместе с вызывающим
+  size_t GetThreadCount() const
+  {
+    return m_queues.size();
+  }
+
+  //вызывающий поток тоже выполняет куски; вложенные вызовы не поддерживаются
+  void ParallelFor(size_t count, size_t grain, RangeBody const & body);
+
+  //общий пул модуля; число потоков задает AmbulanceModule
+  static std::shared_ptr<ThreadPool> GetShared();
+  static void SetSharedThreadCount(size_t threadCount);
+  static size_t GetDefaultThreadCount();
+
+private:
+  struct WorkerQueue
+  {
+    std::mutex mutex;
+    std::deque<std::pair<size_t, size_t>> chunks;
+  };
+
+  void WorkerLoop(size_t worker);
+  void RunChunks(size_t worker);
+  bool PopOwn(size_t worker, std::pair<size_t, size_t> & chunk);
+  bool Steal(size_t worker, std::pair<size_t, size_t> & chunk);
+
+  std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+  std::vector<std::thread> m_threads;
+
+  //один ParallelFor за раз
+  std::mutex m_runMutex;
+
+  std::mutex m_stateMutex;
+  std::condition_variable m_wakeUp;
+  std::condition_variable m_finished;
+  uint64_t m_generation = 0;
+  bool m_stopping = false;
+  RangeBody const * m_body = nullptr;
+  std::atomic<size_t> m_remainingChunks{0};
+  size_t m_activeWorkers = 0;
+};
+
+}  // namespace ambulance_module
@@ -0,0 +1,396 @@
+#include "village_cache.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#include "keynodes/ambulance_keynodes.hpp"
+#include "utils/numeric_link.hpp"
+
+using namespace ambulance_module;
+
+namespace
+{
+
+std::mutex activeMutex;
+std::shared_ptr<VillageCache> activeCache;
+
+}  // namespace
+
+VillageCache::VillageCache()
+  : m_snapshot(std::make_shared<VillageSnapshot>())
+{
+}
+
+VillageCache::~VillageCache()
+{
+  Shutdown();
+}
+
+bool VillageCache::Initialize(ModuleSnapshotContent const * restored, std::string * rejection)
+{
+  using AddArcEvent = ScEventAfterGenerateOutgoingArc<ScType::ConstPermPosArc>;
+  using EraseArcEvent = ScEventBeforeEraseOutgoingArc<ScType::ConstPermPosArc>;
+
+  //деревня добавлена в класс или удалена из него
+  m_subscriptions.push_back(m_context.CreateElementaryEventSubscription<AddArcEvent>(
+      AmbulanceKeynodes::concept_village,
+      [this](AddArcEvent const & event)
+      {
+        MarkDirty(event.GetArcTargetElement());
+      }));
+  m_subscriptions.push_back(m_context.CreateElementaryEventSubscription<EraseArcEvent>(
+      AmbulanceKeynodes::concept_village,
+      [this](EraseArcEvent const & event)
+      {
+        MarkDirty(event.GetArcTargetElement());
+      }));
+
+  //у деревни появилось или пропало свойство
+  for (ScAddr const & relation :
+       {AmbulanceKeynodes::nrel_coordinate_x, AmbulanceKeynodes::nrel_coordinate_y, AmbulanceKeynodes::nrel_population})
+  {
+    m_subscriptions.push_back(m_context.CreateElementaryEventSubscription<AddArcEvent>(
+        relation,
+        [this](AddArcEvent const & event)
+        {
+          MarkPropertyDirty(event.GetArcTargetElement());
+        }));
+    m_subscriptions.push_back(m_context.CreateElementaryEventSubscription<EraseArcEvent>(
+        relation,
+        [this](EraseArcEvent const & event)
+        {
+          MarkPropertyDirty(event.GetArcTargetElement());
+        }));
+  }
+
+  std::lock_guard<std::mutex> lock(m_refreshMutex);
+  ScIterator5Ptr const itGeneration = m_context.CreateIterator5(
+      AmbulanceKeynodes::concept_village,
+      ScType::ConstCommonArc,
+      ScType::NodeLink,
+      ScType::ConstPermPosArc,
+      AmbulanceKeynodes::nrel_data_generation);
+  double generation = 0.0;
+  if (itGeneration->Next())
+  {
+    m_generationLink = itGeneration->Get(2);
+    if (NumericLink::Read(m_context, m_generationLink, generation) && generation >= 0.0)
+      m_generation = static_cast<uint64_t>(generation);
+  }
+
+  if (restored != nullptr)
+  {
+    std::string reason;
+    if (Restore(*restored, reason))
+      return true;
+    if (rejection != nullptr)
+      *rejection = reason;
+  }
+
+  //первичное заполнение: все деревни считаются измененными
+  ScIterator3Ptr const it3 = m_context.CreateIterator3(
+      AmbulanceKeynodes::concept_village, ScType::ConstPermPosArc, ScType::Unknown);
+  while (it3->Next())
+    MarkDirty(it3->Get(2));
+
+  Refresh(false);
+  return false;
+}
+
+bool VillageCache::Restore(ModuleSnapshotContent const & restored, std::string & rejection)
+{
+  //счетчик не видит изменений, сделанных без модуля, поэтому сверяется еще и множество деревень
+  if (restored.generation != m_generation)
+  {
+    rejection = "data generation " + std::to_string(m_generation) + " differs from saved "
+                + std::to_string(restored.generation);
+    return false;
+  }
+  uint64_t villageSetHash = 0;
+  size_t villageCount = 0;
+  ScIterator3Ptr const it3 = m_context.CreateIterator3(
+      AmbulanceKeynodes::concept_village, ScType::ConstPermPosArc, ScType::Unknown);
+  while (it3->Next())
+  {
+    villageSetHash = ModuleSnapshot::MixVillage(villageSetHash, it3->Get(2));
+    ++villageCount;
+  }
+  if (villageSetHash != restored.villageSetHash || villageCount != restored.records.size())
+  {
+    rejection = "set of villages changed";
+    return false;
+  }
+
+  //опубликованный снимок должен состоять ровно из записей с координатами; сверка без обращений к базе
+  std::unordered_map<ScAddr::HashType, size_t> published;
+  published.reserve(restored.villages.Size());
+  for (size_t i = 0; i < restored.villages.Size(); ++i)
+    published.emplace(restored.villages.addrs[i].Hash(), i);
+
+  size_t publishedCount = 0;
+  for (SnapshotRecord const & saved : restored.records)
+  {
+    bool const weighted = saved.status == VillageRecordStatus::Ok;
+    if (!weighted && saved.status != VillageRecordStatus::Unweighted)
+      continue;
+    ++publishedCount;
+    auto const it = published.find(saved.village.Hash());
+    if (it == published.cend() || restored.villages.x[it->second] != saved.x
+        || restored.villages.y[it->second] != saved.y
+        || restored.villages.population[it->second] != saved.population
+        || restored.villages.HasPopulation(it->second) != weighted)
+    {
+      rejection = "village snapshot does not match its records";
+      return false;
+    }
+  }
+  if (publishedCount != restored.villages.Size())
+  {
+    rejection = "village snapshot does not match its records";
+    return false;
+  }
+
+  //свойства могли измениться без модуля: у записи проверяются только ее ссылки по сохраненным адресам,
+  //а деревни с расхождением и неполные записи перечитываются при первом Refresh
+  VillageLoadReport report;
+  std::vector<ScAddr> changed;
+  for (SnapshotRecord const & saved : restored.records)
+  {
+    Record record;
+    record.status = saved.status;
+    record.x = saved.x;
+    record.y = saved.y;
+    record.population = saved.population;
+    ++report.total;
+    if (saved.status == VillageRecordStatus::Incomplete)
+      ++report.incomplete;
+    else if (saved.status == VillageRecordStatus::Malformed)
+      ++report.malformed;
+    else if (saved.status == VillageRecordStatus::Unweighted)
+      ++report.unweighted;
+
+    if (LinksMatch(saved))
+    {
+      record.links.assign(saved.links, saved.links + 3);
+      SubscribeLinks(saved.village, record.links);
+    }
+    else
+      changed.push_back(saved.village);
+    m_records.emplace(saved.village.Hash(), std::move(record));
+  }
+
+  auto snapshot = std::make_shared<VillageSnapshot>(restored.villages);
+  snapshot->version = ++m_version;
+  m_report = report;
+  m_snapshot = std::move(snapshot);
+
+  for (ScAddr const & village : changed)
+    MarkDirty(village);
+  return true;
+}
+
+bool VillageCache::LinksMatch(SnapshotRecord const & saved)
+{
+  if (saved.status != VillageRecordStatus::Ok)
+    return false;
+
+  //ссылки полной записи сохранены в порядке x, y, население
+  double const expected[] = {saved.x, saved.y, saved.population};
+  for (size_t k = 0; k < 3; ++k)
+  {
+    double value = 0.0;
+    if (!m_context.IsElement(saved.links[k]) || !NumericLink::Read(m_context, saved.links[k], value)
+        || value != expected[k])
+      return false;
+  }
+  return true;
+}
+
+void VillageCache::Export(ModuleSnapshotContent & content)
+{
+  std::lock_guard<std::mutex> lock(m_refreshMutex);
+  Refresh();
+
+  content.generation = m_generation;
+  content.villageSetHash = 0;
+  content.records.clear();
+  content.records.reserve(m_records.size());
+  for (auto const & [hash, record] : m_records)
+  {
+    SnapshotRecord saved;
+    saved.village = ScAddr(hash);
+    saved.status = record.status;
+    saved.x = record.x;
+    saved.y = record.y;
+    saved.population = record.population;
+    for (size_t k = 0; k < record.links.size() && k < 3; ++k)
+      saved.links[k] = record.links[k];
+    content.records.push_back(saved);
+    content.villageSetHash = ModuleSnapshot::MixVillage(content.villageSetHash, saved.village);
+  }
+  content.villages = *m_snapshot;
+}
+
+void VillageCache::WriteGeneration()
+{
+  if (!m_generationLink.IsValid() || !m_context.IsElement(m_generationLink))
+  {
+    m_generationLink = m_context.GenerateLink(ScType::ConstNodeLink);
+    ScAddr const arc =
+        m_context.GenerateConnector(ScType::ConstCommonArc, AmbulanceKeynodes::concept_village, m_generationLink);
+    m_context.GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::nrel_data_generation, arc);
+  }
+  NumericLink::WriteInteger(m_context, m_generationLink, static_cast<int64_t>(m_generation));
+}
+
+void VillageCache::Shutdown()
+{
+  m_subscriptions.clear();
+
+  std::lock_guard<std::mutex> lock(m_refreshMutex);
+  m_linkSubscriptions.clear();
+  m_records.clear();
+}
+
+void VillageCache::MarkDirty(ScAddr const & village)
+{
+  std::lock_guard<std::mutex> lock(m_dirtyMutex);
+  m_dirty.insert(village.Hash());
+}
+
+void VillageCache::MarkPropertyDirty(ScAddr const & propertyArc)
+{
+  //propertyArc - дуга общего вида от деревни к ссылке
+  if (!m_context.IsElement(propertyArc) || !m_context.GetElementType(propertyArc).IsConnector())
+    return;
+
+  MarkDirty(m_context.GetArcSourceElement(propertyArc));
+}
+
+void VillageCache::SubscribeLinks(ScAddr const & village, ScAddrVector const & links)
+{
+  for (ScAddr const & link : links)
+  {
+    m_linkSubscriptions[link.Hash()] = m_context.CreateElementaryEventSubscription<ScEventBeforeChangeLinkContent>(
+        link,
+        [this, village](ScEventBeforeChangeLinkContent const &)
+        {
+          MarkDirty(village);
+        });
+  }
+}
+
+void VillageCache::UnsubscribeLinks(ScAddrVector const & links)
+{
+  for (ScAddr const & link : links)
+    m_linkSubscriptions.erase(link.Hash());
+}
+
+void VillageCache::Refresh(bool countGeneration)
+{
+  std::unordered_set<ScAddr::HashType> dirty;
+  {
+    std::lock_guard<std::mutex> lock(m_dirtyMutex);
+    dirty.swap(m_dirty);
+  }
+  if (dirty.empty())
+    return;
+
+  //сохраненные снимки модуля с прежним счетчиком больше не подходят
+  if (countGeneration)
+  {
+    ++m_generation;
+    WriteGeneration();
+  }
+
+  for (ScAddr::HashType const hash : dirty)
+  {
+    ScAddr const village(hash);
+
+    auto const found = m_records.find(hash);
+    if (found != m_records.cend())
+    {
+      UnsubscribeLinks(found->second.links);
+      m_records.erase(found);
+    }
+
+    bool const isVillage = m_context.IsElement(village)
+                           && m_context.CheckConnector(
+                               AmbulanceKeynodes::concept_village, village, ScType::ConstPermPosArc);
+    if (!isVillage)
+      continue;
+
+    Record record;
+    record.status =
+        VillageLoader::ReadVillage(m_context, village, record.x, record.y, record.population, &record.links);
+    SubscribeLinks(village, record.links);
+    m_records.emplace(hash, std::move(record));
+  }
+
+  //порядок деревень - по хэшу адреса, а не по обходу m_records: он не меняется от посторонних вставок
+  //и удалений, и кэши маршрутов и матрицы, сверяющие addrs по позициям, остаются действительными
+  std::vector<ScAddr::HashType> order;
+  order.reserve(m_records.size());
+  for (auto const & [hash, record] : m_records)
+    order.push_back(hash);
+  std::sort(order.begin(), order.end());
+
+  //публикуем новый неизменяемый снимок, старый остается у тех, кто его уже взял
+  auto snapshot = std::make_shared<VillageSnapshot>();
+  snapshot->Reserve(m_records.size());
+  VillageLoadReport report;
+  for (ScAddr::HashType const hash : order)
+  {
+    Record const & record = m_records.at(hash);
+    ++report.total;
+    switch (record.status)
+    {
+    case VillageRecordStatus::Ok:
+      snapshot->Append(ScAddr(hash), record.x, record.y, record.population);
+      break;
+    case VillageRecordStatus::Unweighted:
+      snapshot->AppendUnweighted(ScAddr(hash), record.x, record.y);
+      ++report.unweighted;
+      break;
+    case VillageRecordStatus::Incomplete:
+      ++report.incomplete;
+      break;
+    case VillageRecordStatus::Malformed:
+      ++report.malformed;
+      break;
+    }
+  }
+  snapshot->version = ++m_version;
+
+  m_report = report;
+  m_snapshot = std::move(snapshot);
+}
+
+std::shared_ptr<VillageSnapshot const> VillageCache::GetSnapshot(VillageLoadReport & report)
+{
+  std::lock_guard<std::mutex> lock(m_refreshMutex);
+  Refresh();
+  report = m_report;
+  return m_snapshot;
+}
+
+std::shared_ptr<VillageCache> VillageCache::GetActive()
+{
+  std::lock_guard<std::mutex> lock(activeMutex);
+  return activeCache;
+}
+
+void VillageCache::SetActive(std::shared_ptr<VillageCache> const & cache)
+{
+  std::lock_guard<std::mutex> lock(activeMutex);
+  activeCache = cache;
+}
+
+std::shared_ptr<VillageSnapshot const> VillageCache::Acquire(ScMemoryContext & context, VillageLoadReport & report)
+{
+  std::shared_ptr<VillageCache> const cache = GetActive();
+  if (cache != nullptr)
+    return cache->GetSnapshot(report);
+
+  return std::make_shared<VillageSnapshot const>(VillageLoader::Load(context, report));
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <sc-memory/sc_agent.hpp>
+
+#include "utils/module_snapshot.hpp"
+#include "utils/village_loader.hpp"
+
+namespace ambulance_module
+{
+
+//кэш деревень модуля: заполняется при старте и обновляется по событиям sc-памяти;
+//каждое примененное изменение увеличивает счетчик concept_village => nrel_data_generation: [число] в базе знаний,
+//по нему сохраненный снимок модуля сверяется с базой при следующем запуске
+class VillageCache
+{
+public:
+  VillageCache();
+  ~VillageCache();
+
+  //подписки на concept_village и отношения свойств, первичное заполнение;
+  //restored - снимок прошлого запуска: принимается, если совпадают счетчик и множество деревень;
+  //деревни, чьи ссылки свойств изменились без модуля, перечитываются при первом обращении;
+  //возвращает true, если снимок принят, иначе причина отказа в rejection
+  bool Initialize(ModuleSnapshotContent const * restored = nullptr, std::string * rejection = nullptr);
+  void Shutdown();
+
+  //применяет накопленные изменения и выгружает записи, снимок и счетчик в content
+  void Export(ModuleSnapshotContent & content);
+
+  //текущий снимок; изменения, пришедшие по событиям, применяются здесь
+  std::shared_ptr<VillageSnapshot const> GetSnapshot(VillageLoadReport & report);
+
+  //кэш, созданный модулем (nullptr если модуль не загружен)
+  static std::shared_ptr<VillageCache> GetActive();
+  static void SetActive(std::shared_ptr<VillageCache> const & cache);
+
+  //снимок из активного кэша или прямая загрузка из базы знаний
+  static std::shared_ptr<VillageSnapshot const> Acquire(ScMemoryContext & context, VillageLoadReport & report);
+
+private:
+  struct Record
+  {
+    VillageRecordStatus status = VillageRecordStatus::Incomplete;
+    double x = 0.0;
+    double y = 0.0;
+    double population = 0.0;
+    ScAddrVector links;
+  };
+
+  void MarkDirty(ScAddr const & village);
+  void MarkPropertyDirty(ScAddr const & propertyArc);
+  void SubscribeLinks(ScAddr const & village, ScAddrVector const & links);
+  void UnsubscribeLinks(ScAddrVector const & links);
+  //countGeneration = false - первичное заполнение, база не менялась
+  void Refresh(bool countGeneration = true);
+  bool Restore(ModuleSnapshotContent const & restored, std::string & rejection);
+  //ссылки полной записи на месте и хранят сохраненные значения
+  bool LinksMatch(SnapshotRecord const & saved);
+  void WriteGeneration();
+
+  ScAgentContext m_context;
+
+  //события только помечают деревни; чтение из базы выполняется в Refresh
+  std::mutex m_dirtyMutex;
+  std::unordered_set<ScAddr::HashType> m_dirty;
+
+  std::mutex m_refreshMutex;
+  std::unordered_map<ScAddr::HashType, Record> m_records;
+  std::unordered_map<ScAddr::HashType, std::shared_ptr<ScEventSubscription>> m_linkSubscriptions;
+  std::shared_ptr<VillageSnapshot const> m_snapshot;
+  VillageLoadReport m_report;
+  uint64_t m_version = 0;
+
+  uint64_t m_generation = 0;
+  ScAddr m_generationLink;
+
+  std::vector<std::shared_ptr<ScEventSubscription>> m_subscriptions;
+};
+
+}  // namespace ambulance_module
@@ -0,0 +1,255 @@
+#include "village_import.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "keynodes/ambulance_keynodes.hpp"
+#include "utils/mapped_file.hpp"
+#include "utils/numeric_link.hpp"
+
+using namespace ambulance_module;
+
+namespace
+{
+
+size_t const kBinaryHeaderSize = sizeof(VillageImport::kBinaryMagic) + sizeof(uint64_t);
+static_assert(sizeof(VillageImport::BinaryRecord) == 32, "binary record layout must not have padding");
+
+bool IsSpace(char c)
+{
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+bool IsFiniteRecord(ImportedVillage const & village)
+{
+  return std::isfinite(village.x) && std::isfinite(village.y) && std::isfinite(village.population);
+}
+
+//поля строки без пробелов по краям; false, если их не ровно count
+bool SplitLine(char const * begin, char const * end, std::pair<char const *, char const *> * fields, size_t count)
+{
+  char const separator = std::find(begin, end, ';') != end ? ';' : ',';
+  size_t field = 0;
+  char const * start = begin;
+  for (char const * it = begin;; ++it)
+  {
+    if (it != end && *it != separator)
+      continue;
+    if (field == count)
+      return false;
+
+    char const * first = start;
+    char const * last = it;
+    while (first != last && IsSpace(*first))
+      ++first;
+    while (last != first && IsSpace(*(last - 1)))
+      --last;
+    fields[field++] = {first, last};
+
+    if (it == end)
+      break;
+    start = it + 1;
+  }
+  return field == count;
+}
+
+bool ParseCsv(char const * data, size_t size, std::vector<ImportedVillage> & villages, VillageImportReport & report)
+{
+  char const * const end = data + size;
+  //строк не больше, чем переводов строки плюс одна - память выделяется один раз
+  villages.reserve(villages.size() + static_cast<size_t>(std::count(data, end, '\n')) + 1);
+
+  bool firstLine = true;
+  for (char const * line = data; line < end;)
+  {
+    char const * lineEnd = static_cast<char const *>(std::memchr(line, '\n', static_cast<size_t>(end - line)));
+    if (lineEnd == nullptr)
+      lineEnd = end;
+    char const * const next = lineEnd == end ? end : lineEnd + 1;
+
+    char const * first = line;
+    while (first != lineEnd && IsSpace(*first))
+      ++first;
+    line = next;
+    if (first == lineEnd || *first == '#')
+      continue;
+
+    std::pair<char const *, char const *> fields[4];
+    ImportedVillage village;
+    bool const split = SplitLine(first, lineEnd, fields, 4);
+    bool const hasX = split
+                      && NumericLink::Decode(
+                          fields[1].first, static_cast<size_t>(fields[1].second - fields[1].first), village.x);
+
+    //заголовок "id,x,y,population" не запись
+    bool const header = firstLine && split && !hasX;
+    firstLine = false;
+    if (header)
+      continue;
+
+    ++report.records;
+    bool const parsed =
+        hasX
+        && NumericLink::Decode(fields[2].first, static_cast<size_t>(fields[2].second - fields[2].first), village.y)
+        && NumericLink::Decode(
+            fields[3].first, static_cast<size_t>(fields[3].second - fields[3].first), village.population);
+    if (parsed)
+      village.id.assign(fields[0].first, fields[0].second);
+    if (!parsed || !IsFiniteRecord(village) || !VillageImport::IsValidId(village.id))
+    {
+      ++report.malformed;
+      continue;
+    }
+    villages.push_back(std::move(village));
+  }
+  return true;
+}
+
+bool ParseBinary(
+    char const * data,
+    size_t size,
+    std::vector<ImportedVillage> & villages,
+    VillageImportReport & report,
+    std::string & error)
+{
+  uint64_t count = 0;
+  std::memcpy(&count, data + sizeof(VillageImport::kBinaryMagic), sizeof(count));
+  size_t const payload = size - kBinaryHeaderSize;
+  if (payload % sizeof(VillageImport::BinaryRecord) != 0 || payload / sizeof(VillageImport::BinaryRecord) != count)
+  {
+    error = "binary file size does not match its record count";
+    return false;
+  }
+
+  villages.reserve(villages.size() + count);
+  char const * record = data + kBinaryHeaderSize;
+  for (uint64_t i = 0; i < count; ++i, record += sizeof(VillageImport::BinaryRecord))
+  {
+    //отображение не обязано быть выровнено под double, поэтому копией
+    VillageImport::BinaryRecord raw;
+    std::memcpy(&raw, record, sizeof(raw));
+    ++report.records;
+
+    ImportedVillage village{"village_" + std::to_string(raw.id), raw.x, raw.y, raw.population};
+    if (!IsFiniteRecord(village))
+    {
+      ++report.malformed;
+      continue;
+    }
+    villages.push_back(std::move(village));
+  }
+  return true;
+}
+
+}  // namespace
+
+std::string VillageImportReport::ToString() const
+{
+  return "records: " + std::to_string(records) + ", imported: " + std::to_string(imported)
+         + ", existing: " + std::to_string(existing) + ", conflicting: " + std::to_string(conflicting.size())
+         + ", malformed: " + std::to_string(malformed);
+}
+
+bool VillageImport::IsValidId(std::string const & id)
+{
+  if (id.empty())
+    return false;
+  return std::all_of(
+      id.begin(),
+      id.end(),
+      [](char c)
+      {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+      });
+}
+
+bool VillageImport::Parse(
+    char const * data,
+    size_t size,
+    std::vector<ImportedVillage> & villages,
+    VillageImportReport & report,
+    std::string & error)
+{
+  if (size >= kBinaryHeaderSize && std::memcmp(data, kBinaryMagic, sizeof(kBinaryMagic)) == 0)
+    return ParseBinary(data, size, villages, report, error);
+  return ParseCsv(data, size, villages, report);
+}
+
+bool VillageImport::ParseFile(
+    std::string const & path,
+    std::vector<ImportedVillage> & villages,
+    VillageImportReport & report,
+    std::string & error)
+{
+  MappedFile file;
+  if (!file.Open(path, error))
+    return false;
+  return Parse(file.GetData(), file.GetSize(), villages, report, error);
+}
+
+void VillageImport::Write(
+    ScMemoryContext & context,
+    std::vector<ImportedVillage> const & villages,
+    VillageImportReport & report,
+    ScAddrVector * created,
+    size_t batchSize)
+{
+  if (batchSize == 0)
+    batchSize = kDefaultBatchSize;
+  if (created != nullptr)
+    created->reserve(created->size() + villages.size());
+
+  ScAddr const relations[] = {
+      AmbulanceKeynodes::nrel_coordinate_x, AmbulanceKeynodes::nrel_coordinate_y, AmbulanceKeynodes::nrel_population};
+
+  for (size_t begin = 0; begin < villages.size(); begin += batchSize)
+  {
+    size_t const end = std::min(villages.size(), begin + batchSize);
+
+    //события по всем элементам пакета уходят одним блоком в EndEventsPending
+    context.BeginEventsPending();
+    for (size_t i = begin; i < end; ++i)
+    {
+      ImportedVillage const & village = villages[i];
+      //повторный импорт того же файла не создает дублей; чужой элемент с тем же идентификатором - конфликт
+      ScAddr const found = context.SearchElementBySystemIdentifier(village.id);
+      if (found.IsValid())
+      {
+        if (context.CheckConnector(AmbulanceKeynodes::concept_village, found, ScType::ConstPermPosArc))
+          ++report.existing;
+        else
+          report.conflicting.push_back(village.id);
+        continue;
+      }
+
+      ScAddr const node = context.GenerateNode(ScType::ConstNode);
+      context.SetElementSystemIdentifier(village.id, node);
+      context.GenerateConnector(ScType::ConstPermPosArc, AmbulanceKeynodes::concept_village, node);
+
+      double const values[] = {village.x, village.y, village.population};
+      for (size_t k = 0; k < 3; ++k)
+      {
+        ScAddr const link = NumericLink::Generate(context, values[k]);
+        ScAddr const arc = context.GenerateConnector(ScType::ConstCommonArc, node, link);
+        context.GenerateConnector(ScType::ConstPermPosArc, relations[k], arc);
+      }
+
+      ++report.imported;
+      if (created != nullptr)
+        created->push_back(node);
+    }
+    context.EndEventsPending();
+  }
+}
+
+std::string VillageImport::EncodeBinary(std::vector<BinaryRecord> const & records)
+{
+  std::string data(kBinaryHeaderSize + records.size() * sizeof(BinaryRecord), '\0');
+  uint64_t const count = records.size();
+  std::memcpy(data.data(), kBinaryMagic, sizeof(kBinaryMagic));
+  std::memcpy(data.data() + sizeof(kBinaryMagic), &count, sizeof(count));
+  if (!records.empty())
+    std::memcpy(data.data() + kBinaryHeaderSize, records.data(), records.size() * sizeof(BinaryRecord));
+  return data;
+}
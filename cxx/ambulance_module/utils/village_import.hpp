@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <sc-memory/sc_memory.hpp>
+
+namespace ambulance_module
+{
+
+//запись файла импорта: id становится системным идентификатором деревни
+struct ImportedVillage
+{
+  std::string id;
+  double x = 0.0;
+  double y = 0.0;
+  double population = 0.0;
+};
+
+struct VillageImportReport
+{
+  size_t records = 0;
+  size_t imported = 0;
+  //деревня с таким идентификатором уже есть в базе
+  size_t existing = 0;
+  //идентификатор занят элементом, который не является деревней: запись пропущена
+  std::vector<std::string> conflicting;
+  //строка не разобрана или идентификатор недопустим
+  size_t malformed = 0;
+
+  std::string ToString() const;
+};
+
+//массовая загрузка деревень из файла, отображенного в память:
+//  CSV    - строки "id,x,y,population" (или через ';'), пустые строки и строки с '#' пропускаются,
+//           первая строка без числа в x считается заголовком;
+//  бинарь - kBinaryMagic, uint64 число записей, затем записи BinaryRecord;
+//деревни получают ту же структуру, что и в .scs: класс concept_village и ссылки nrel_coordinate_x/y, nrel_population
+class VillageImport
+{
+public:
+  static constexpr char kBinaryMagic[8] = {'A', 'M', 'B', 'V', 'I', 'L', '0', '1'};
+  static constexpr size_t kDefaultBatchSize = 4096;
+  //узел, дуга класса и по три элемента на каждое из трех свойств
+  static constexpr size_t kElementsPerVillage = 11;
+
+  //бинарная запись: идентификатор деревни - "village_<id>"
+  struct BinaryRecord
+  {
+    uint64_t id;
+    double x;
+    double y;
+    double population;
+  };
+
+  //разбирает содержимое; false и текст ошибки, если файл целиком не в формате
+  static bool Parse(
+      char const * data,
+      size_t size,
+      std::vector<ImportedVillage> & villages,
+      VillageImportReport & report,
+      std::string & error);
+
+  static bool ParseFile(
+      std::string const & path,
+      std::vector<ImportedVillage> & villages,
+      VillageImportReport & report,
+      std::string & error);
+
+  //пакетами с отложенной рассылкой событий; деревни с уже занятым идентификатором пропускаются
+  //(existing, если это деревня, иначе conflicting);
+  //созданные узлы деревень (если задан created) добавляются в created
+  static void Write(
+      ScMemoryContext & context,
+      std::vector<ImportedVillage> const & villages,
+      VillageImportReport & report,
+      ScAddrVector * created = nullptr,
+      size_t batchSize = kDefaultBatchSize);
+
+  static std::string EncodeBinary(std::vector<BinaryRecord> const & records);
+
+  //допустимый системный идентификатор: латиница, цифры и '_'
+  static bool IsValidId(std::string const & id);
+};
+
+}  // namespace ambulance_module
@@ -0,0 +1,220 @@
+#include "village_loader.hpp"
+
+#include <algorithm>
+
+#include "keynodes/ambulance_keynodes.hpp"
+#include "utils/agent_metrics.hpp"
+#include "utils/numeric_link.hpp"
+
+using namespace ambulance_module;
+
+void VillageSnapshot::Reserve(size_t count)
+{
+  addrs.reserve(count);
+  x.reserve(count);
+  y.reserve(count);
+  population.reserve(count);
+}
+
+void VillageSnapshot::Append(ScAddr const & addr, double valX, double valY, double valPopulation)
+{
+  addrs.push_back(addr);
+  x.push_back(valX);
+  y.push_back(valY);
+  population.push_back(valPopulation);
+}
+
+void VillageSnapshot::AppendUnweighted(ScAddr const & addr, double valX, double valY)
+{
+  unweighted.push_back(addrs.size());
+  Append(addr, valX, valY, 0.0);
+}
+
+void VillageSnapshot::AppendFrom(VillageSnapshot const & other, size_t i)
+{
+  if (other.HasPopulation(i))
+    Append(other.addrs[i], other.x[i], other.y[i], other.population[i]);
+  else
+    AppendUnweighted(other.addrs[i], other.x[i], other.y[i]);
+}
+
+bool VillageSnapshot::HasPopulation(size_t i) const
+{
+  return !std::binary_search(unweighted.cbegin(), unweighted.cend(), i);
+}
+
+VillageSnapshot VillageSnapshot::Weighted() const
+{
+  VillageSnapshot result;
+  result.Reserve(Size() - unweighted.size());
+  size_t next = 0;
+  for (size_t i = 0; i < Size(); ++i)
+  {
+    if (next < unweighted.size() && unweighted[next] == i)
+    {
+      ++next;
+      continue;
+    }
+    result.Append(addrs[i], x[i], y[i], population[i]);
+  }
+  return result;
+}
+
+size_t VillageSnapshot::IndexOf(ScAddr const & addr) const
+{
+  for (size_t i = 0; i < addrs.size(); ++i)
+  {
+    if (addrs[i] == addr)
+      return i;
+  }
+  return addrs.size();
+}
+
+std::string VillageLoadReport::ToString() const
+{
+  return "villages: " + std::to_string(total) + ", incomplete: " + std::to_string(incomplete)
+         + ", malformed: " + std::to_string(malformed) + ", without population: " + std::to_string(unweighted);
+}
+
+void VillageLoader::ReadProperties(
+    ScMemoryContext & context,
+    ScAddr const & village,
+    ScAddr const * relations,
+    size_t count,
+    double * values,
+    VillageRecordStatus * statuses,
+    ScAddr * links)
+{
+  ScAddr found[kMaxProperties];
+  size_t remaining = count;
+
+  //отношение не фиксируется: одна выборка отдает все свойства деревни, разбираем их по отношению
+  ScIterator5Ptr const it5 = context.CreateIterator5(
+      village,//деревня
+      ScType::ConstCommonArc,//дуга общего вида
+      ScType::NodeLink,//ссылка где число
+      ScType::ConstPermPosArc,//принадлежности
+      ScType::ConstNodeNonRole);//любое неролевое отношение
+
+  while (remaining > 0 && it5->Next())
+  {
+    ScAddr const relation = it5->Get(4);
+    for (size_t i = 0; i < count; ++i)
+    {
+      if (relations[i] != relation || found[i].IsValid())
+        continue;
+      found[i] = it5->Get(2);
+      --remaining;
+      break;
+    }
+  }
+
+  for (size_t i = 0; i < count; ++i)
+  {
+    if (links != nullptr)
+      links[i] = found[i];
+    if (!found[i].IsValid())
+    {
+      statuses[i] = VillageRecordStatus::Incomplete;
+      continue;
+    }
+
+    bool const parsed = NumericLink::Read(context, found[i], values[i]);
+    AgentMetrics::CountParsedLink(parsed);
+    statuses[i] = parsed ? VillageRecordStatus::Ok : VillageRecordStatus::Malformed;
+  }
+}
+
+VillageRecordStatus VillageLoader::ReadProperty(
+    ScMemoryContext & context,
+    ScAddr const & village,
+    ScAddr const & relation,
+    double & value,
+    ScAddr * link)
+{
+  VillageRecordStatus status = VillageRecordStatus::Incomplete;
+  ReadProperties(context, village, &relation, 1, &value, &status, link);
+  return status;
+}
+
+VillageRecordStatus VillageLoader::ReadVillage(
+    ScMemoryContext & context,
+    ScAddr const & village,
+    double & x,
+    double & y,
+    double & population,
+    ScAddrVector * links)
+{
+  ScAddr const relations[] = {
+      AmbulanceKeynodes::nrel_coordinate_x,
+      AmbulanceKeynodes::nrel_coordinate_y,
+      AmbulanceKeynodes::nrel_population};
+  double values[3] = {0.0, 0.0, 0.0};
+  VillageRecordStatus statuses[3];
+  ScAddr found[3];
+  ReadProperties(context, village, relations, 3, values, statuses, found);
+  x = values[0];
+  y = values[1];
+  population = values[2];
+
+  //отсутствие поля важнее битого значения: такую запись нельзя исправить парсером
+  VillageRecordStatus result = VillageRecordStatus::Ok;
+  for (size_t i = 0; i < 3; ++i)
+  {
+    if (links != nullptr && found[i].IsValid())
+      links->push_back(found[i]);
+  }
+  for (size_t i = 0; i < 2; ++i)
+  {
+    if (statuses[i] == VillageRecordStatus::Incomplete)
+      result = VillageRecordStatus::Incomplete;
+    else if (statuses[i] == VillageRecordStatus::Malformed && result == VillageRecordStatus::Ok)
+      result = VillageRecordStatus::Malformed;
+  }
+
+  //население нужно только взвешенным агентам; расстояниям и центру хватает координат
+  if (result == VillageRecordStatus::Ok && statuses[2] != VillageRecordStatus::Ok)
+  {
+    population = 0.0;
+    result = VillageRecordStatus::Unweighted;
+  }
+  return result;
+}
+
+VillageSnapshot VillageLoader::Load(ScMemoryContext & context, VillageLoadReport & report)
+{
+  report = VillageLoadReport();
+  VillageSnapshot snapshot;
+
+  //ищем деревни
+  ScIterator3Ptr const it3 = context.CreateIterator3(
+      AmbulanceKeynodes::concept_village, ScType::ConstPermPosArc, ScType::Unknown);
+
+  while (it3->Next())
+  {
+    ScAddr const village = it3->Get(2);
+    ++report.total;
+
+    double x = 0.0;
+    double y = 0.0;
+    double population = 0.0;
+    switch (ReadVillage(context, village, x, y, population))
+    {
+    case VillageRecordStatus::Ok:
+      snapshot.Append(village, x, y, population);
+      break;
+    case VillageRecordStatus::Unweighted:
+      snapshot.AppendUnweighted(village, x, y);
+      ++report.unweighted;
+      break;
+    case VillageRecordStatus::Incomplete:
+      ++report.incomplete;
+      break;
+    case VillageRecordStatus::Malformed:
+      ++report.malformed;
+      break;
+    }
+  }
+
+  return snapshot;
+}
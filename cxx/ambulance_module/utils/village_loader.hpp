@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <sc-memory/sc_memory.hpp>
+
+namespace ambulance_module
+{
+
+//снимок деревень в виде структуры массивов (индекс i общий для всех массивов)
+struct VillageSnapshot
+{
+  std::vector<ScAddr> addrs;
+  std::vector<double> x;
+  std::vector<double> y;
+  std::vector<double> population;
+  //деревни без населения (индексы по возрастанию): годятся для расстояний и центра, население у них 0
+  std::vector<size_t> unweighted;
+
+  //номер версии кэша, из которого взят снимок (0 - загружен напрямую)
+  uint64_t version = 0;
+
+  size_t Size() const
+  {
+    return addrs.size();
+  }
+
+  bool Empty() const
+  {
+    return addrs.empty();
+  }
+
+  void Reserve(size_t count);
+  void Append(ScAddr const & addr, double valX, double valY, double valPopulation);
+  void AppendUnweighted(ScAddr const & addr, double valX, double valY);
+  //копирует деревню i другого снимка вместе с признаком населения
+  void AppendFrom(VillageSnapshot const & other, size_t i);
+
+  bool HasPopulation(size_t i) const;
+  //только деревни с населением - для агентов, взвешивающих расстояния (version = 0)
+  VillageSnapshot Weighted() const;
+
+  //индекс деревни в снимке или Size(), если ее нет
+  size_t IndexOf(ScAddr const & addr) const;
+};
+
+//итог чтения одной деревни
+enum class VillageRecordStatus
+{
+  Ok,
+  Incomplete,  //нет x или y
+  Malformed,   //x или y есть, но это не число
+  Unweighted   //координаты в порядке, но населения нет или оно не число
+};
+
+//сколько записей пропущено при загрузке и почему
+struct VillageLoadReport
+{
+  size_t total = 0;
+  size_t incomplete = 0;
+  size_t malformed = 0;
+  //в снимке с населением 0; взвешенные агенты считают их неполными
+  size_t unweighted = 0;
+
+  size_t Skipped() const
+  {
+    return incomplete + malformed;
+  }
+
+  std::string ToString() const;
+};
+
+class VillageLoader
+{
+public:
+  //наибольшее число отношений, читаемых за один обход
+  static constexpr size_t kMaxProperties = 8;
+
+  //один проход по concept_village; неполные и битые записи пропускаются и считаются в report,
+  //деревни без населения входят в снимок как unweighted
+  static VillageSnapshot Load(ScMemoryContext & context, VillageLoadReport & report);
+
+  //links (если задан) получает найденные ссылки свойств
+  static VillageRecordStatus ReadVillage(
+      ScMemoryContext & context,
+      ScAddr const & village,
+      double & x,
+      double & y,
+      double & population,
+      ScAddrVector * links = nullptr);
+
+  //числа по отношениям relations[0..count), count <= kMaxProperties, за один обход исходящих дуг общего вида деревни
+  //(берется первая ссылка каждого отношения, прочие дуги пропускаются); statuses[i] - итог по relations[i],
+  //links[i] (если задан) - найденная ссылка или пустой адрес
+  static void ReadProperties(
+      ScMemoryContext & context,
+      ScAddr const & village,
+      ScAddr const * relations,
+      size_t count,
+      double * values,
+      VillageRecordStatus * statuses,
+      ScAddr * links = nullptr);
+
+  //число из ссылки без исключений
+  static VillageRecordStatus ReadProperty(
+      ScMemoryContext & context,
+      ScAddr const & village,
+      ScAddr const & relation,
+      double & value,
+      ScAddr * link = nullptr);
+};
+
+}  // namespace ambulance_module
@@ -0,0 +1,138 @@
+#include "village_scope.hpp"
+
+#include <cmath>
+#include <unordered_set>
+
+#include "keynodes/ambulance_keynodes.hpp"
+#include "utils/village_cache.hpp"
+
+using namespace ambulance_module;
+
+bool VillageScope::Read(ScMemoryContext & context, ActionParameters const & parameters, std::string & error)
+{
+  *this = VillageScope();
+
+  m_set = parameters.GetElement(AmbulanceKeynodes::rrel_villages);
+  if (m_set.IsValid() && !context.GetElementType(m_set).IsNode())
+  {
+    error = "rrel_villages must point to a set or structure of villages.";
+    return false;
+  }
+
+  std::pair<ScAddr, double *> const bounds[] = {
+      {AmbulanceKeynodes::rrel_min_x, &m_minX},
+      {AmbulanceKeynodes::rrel_max_x, &m_maxX},
+      {AmbulanceKeynodes::rrel_min_y, &m_minY},
+      {AmbulanceKeynodes::rrel_max_y, &m_maxY}};
+  for (auto const & [role, value] : bounds)
+  {
+    //роли нет - сторона не ограничена; роль есть, но ссылка не число - ошибка, а не весь набор деревень
+    if (!parameters.GetElement(role).IsValid())
+      continue;
+    double bound = 0.0;
+    if (!parameters.ReadNumber(role, bound) || std::isnan(bound))
+    {
+      error = "Bounding box limits must be numbers.";
+      return false;
+    }
+    *value = bound;
+    m_hasBox = true;
+  }
+
+  if (m_minX > m_maxX || m_minY > m_maxY)
+  {
+    error = "Bounding box minimum is greater than its maximum.";
+    return false;
+  }
+  return true;
+}
+
+std::shared_ptr<VillageSnapshot const> VillageScope::Acquire(ScMemoryContext & context, VillageLoadReport & report)
+    const
+{
+  if (!m_set.IsValid())
+  {
+    std::shared_ptr<VillageSnapshot const> const all = VillageCache::Acquire(context, report);
+    if (!m_hasBox)
+      return all;
+
+    //прямоугольник по снимку кэша: O(n) без обращений к базе
+    auto snapshot = std::make_shared<VillageSnapshot>();
+    for (size_t i = 0; i < all->Size(); ++i)
+    {
+      if (Contains(all->x[i], all->y[i]))
+        snapshot->AppendFrom(*all, i);
+    }
+    return snapshot;
+  }
+
+  //множество: читаются только его элементы, которые являются деревнями
+  report = VillageLoadReport();
+  auto snapshot = std::make_shared<VillageSnapshot>();
+  std::unordered_set<ScAddr::HashType> seen;
+  ScIterator3Ptr const it3 = context.CreateIterator3(m_set, ScType::ConstPermPosArc, ScType::ConstNode);
+  while (it3->Next())
+  {
+    ScAddr const village = it3->Get(2);
+    if (!seen.insert(village.Hash()).second
+        || !context.CheckConnector(AmbulanceKeynodes::concept_village, village, ScType::ConstPermPosArc))
+      continue;
+    ++report.total;
+
+    double x = 0.0;
+    double y = 0.0;
+    double population = 0.0;
+    switch (VillageLoader::ReadVillage(context, village, x, y, population))
+    {
+    case VillageRecordStatus::Ok:
+      if (Contains(x, y))
+        snapshot->Append(village, x, y, population);
+      break;
+    case VillageRecordStatus::Unweighted:
+      if (Contains(x, y))
+        snapshot->AppendUnweighted(village, x, y);
+      ++report.unweighted;
+      break;
+    case VillageRecordStatus::Incomplete:
+      ++report.incomplete;
+      break;
+    case VillageRecordStatus::Malformed:
+      ++report.malformed;
+      break;
+    }
+  }
+  return snapshot;
+}
+
+std::shared_ptr<VillageSnapshot const> VillageScope::AcquireWeighted(
+    ScMemoryContext & context,
+    VillageLoadReport & report,
+    std::shared_ptr<VillageSnapshot const> * all) const
+{
+  std::shared_ptr<VillageSnapshot const> const villages = Acquire(context, report);
+  if (all != nullptr)
+    *all = villages;
+  //для взвешенных агентов деревня без населения неполна
+  report.incomplete += report.unweighted;
+  report.unweighted = 0;
+  if (villages->unweighted.empty())
+    return villages;
+  return std::make_shared<VillageSnapshot const>(villages->Weighted());
+}
+
+std::string VillageScope::ToString() const
+{
+  if (!IsRestricted())
+    return "all villages";
+
+  std::string text;
+  if (m_set.IsValid())
+    text = "village set";
+  if (m_hasBox)
+  {
+    text += text.empty() ? "" : ", ";
+    text += "x in [" + std::to_string(m_minX) + ", " + std::to_string(m_maxX) + "], y in [" + std::to_string(m_minY)
+            + ", " + std::to_string(m_maxY) + "]";
+  }
+  return text;
+}
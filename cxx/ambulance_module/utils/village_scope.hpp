@@ -0,0 +1,56 @@
+#pragma once
+
+#include <limits>
+#include <memory>
+#include <string>
+
+#include <sc-memory/sc_memory.hpp>
+
+#include "utils/action_parameters.hpp"
+#include "utils/village_loader.hpp"
+
+namespace ambulance_module
+{
+
+//часть деревень, которой ограничено действие:
+//  action -> rrel_villages: множество или структура деревень (читаются только они, без общего кэша);
+//  action -> rrel_min_x, rrel_max_x, rrel_min_y, rrel_max_y: [число] - прямоугольник, границы включаются,
+//  незаданная граница не ограничивает;
+//без аргументов действие работает со всеми деревнями concept_village
+class VillageScope
+{
+public:
+  //false и текст ошибки, если множество не узел или границы противоречат друг другу
+  bool Read(ScMemoryContext & context, ActionParameters const & parameters, std::string & error);
+
+  bool IsRestricted() const
+  {
+    return m_set.IsValid() || m_hasBox;
+  }
+
+  bool Contains(double x, double y) const
+  {
+    return x >= m_minX && x <= m_maxX && y >= m_minY && y <= m_maxY;
+  }
+
+  //снимок деревень действия: без ограничений - общий снимок кэша, иначе новый (version = 0)
+  std::shared_ptr<VillageSnapshot const> Acquire(ScMemoryContext & context, VillageLoadReport & report) const;
+  //то же без деревень, у которых нет населения (они считаются в report как неполные);
+  //all получает полный снимок, из которого отобраны деревни
+  std::shared_ptr<VillageSnapshot const> AcquireWeighted(
+      ScMemoryContext & context,
+      VillageLoadReport & report,
+      std::shared_ptr<VillageSnapshot const> * all = nullptr) const;
+
+  std::string ToString() const;
+
+private:
+  ScAddr m_set;
+  bool m_hasBox = false;
+  double m_minX = -std::numeric_limits<double>::infinity();
+  double m_maxX = std::numeric_limits<double>::infinity();
+  double m_minY = -std::numeric_limits<double>::infinity();
+  double m_maxY = std::numeric_limits<double>::infinity();
+};
+
+}  // namespace ambulance_module
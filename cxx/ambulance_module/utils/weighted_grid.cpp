@@ -0,0 +1,74 @@
+#include "weighted_grid.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace ambulance_module;
+
+WeightedGrid::WeightedGrid(
+    double const * xs,
+    double const * ys,
+    double const * weights,
+    size_t count,
+    size_t cellsPerAxis)
+{
+  if (count == 0)
+    return;
+
+  cellsPerAxis = std::max<size_t>(cellsPerAxis, 1);
+  auto const [minXIt, maxXIt] = std::minmax_element(xs, xs + count);
+  auto const [minYIt, maxYIt] = std::minmax_element(ys, ys + count);
+  double const originX = *minXIt;
+  double const originY = *minYIt;
+  double const cellWidth = std::max(*maxXIt - originX, 1e-12) / cellsPerAxis;
+  double const cellHeight = std::max(*maxYIt - originY, 1e-12) / cellsPerAxis;
+
+  size_t const cells = cellsPerAxis * cellsPerAxis;
+  double const inf = std::numeric_limits<double>::infinity();
+  std::vector<double> weight(cells, 0.0);
+  std::vector<double> minX(cells, inf), minY(cells, inf), maxX(cells, -inf), maxY(cells, -inf);
+  std::vector<bool> used(cells, false);
+
+  for (size_t i = 0; i < count; ++i)
+  {
+    size_t const cx = std::min(cellsPerAxis - 1, static_cast<size_t>((xs[i] - originX) / cellWidth));
+    size_t const cy = std::min(cellsPerAxis - 1, static_cast<size_t>((ys[i] - originY) / cellHeight));
+    size_t const cell = cy * cellsPerAxis + cx;
+    used[cell] = true;
+    weight[cell] += weights[i];
+    minX[cell] = std::min(minX[cell], xs[i]);
+    minY[cell] = std::min(minY[cell], ys[i]);
+    maxX[cell] = std::max(maxX[cell], xs[i]);
+    maxY[cell] = std::max(maxY[cell], ys[i]);
+  }
+
+  //пустые ячейки не храним
+  for (size_t cell = 0; cell < cells; ++cell)
+  {
+    if (!used[cell])
+      continue;
+    m_weights.push_back(weight[cell]);
+    m_minX.push_back(minX[cell]);
+    m_minY.push_back(minY[cell]);
+    m_maxX.push_back(maxX[cell]);
+    m_maxY.push_back(maxY[cell]);
+  }
+}
+
+size_t WeightedGrid::SuggestCellsPerAxis(size_t count)
+{
+  return std::max<size_t>(1, static_cast<size_t>(std::ceil(std::pow(static_cast<double>(count), 0.25))));
+}
+
+double WeightedGrid::LowerBound(double px, double py) const
+{
+  double result = 0.0;
+  for (size_t cell = 0; cell < m_weights.size(); ++cell)
+  {
+    double const dx = std::max({m_minX[cell] - px, 0.0, px - m_maxX[cell]});
+    double const dy = std::max({m_minY[cell] - py, 0.0, py - m_maxY[cell]});
+    result += m_weights[cell] * std::sqrt(dx * dx + dy * dy);
+  }
+  return result;
+}
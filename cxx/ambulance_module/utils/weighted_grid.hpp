@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace ambulance_module
+{
+
+//грубое разбиение деревень на ячейки с суммарным весом и плотной рамкой точек;
+//дает нижнюю границу взвешенной суммы расстояний за O(число ячеек) вместо O(n)
+class WeightedGrid
+{
+public:
+  WeightedGrid(double const * xs, double const * ys, double const * weights, size_t count, size_t cellsPerAxis);
+
+  //число ячеек на ось, при котором граница считается примерно за sqrt(n)
+  static size_t SuggestCellsPerAxis(size_t count);
+
+  size_t GetCellCount() const
+  {
+    return m_weights.size();
+  }
+
+  //сумма вес_ячейки * расстояние до ее рамки <= сумма вес * расстояние до каждой точки
+  double LowerBound(double px, double py) const;
+
+private:
+  std::vector<double> m_weights;
+  std::vector<double> m_minX;
+  std::vector<double> m_minY;
+  std::vector<double> m_maxX;
+  std::vector<double> m_maxY;
+};
+
+}  // namespace ambulance_module